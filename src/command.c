@@ -36,6 +36,7 @@
 #include "serialno.h"
 #include "jtagtap.h"
 #include "jtag_scan.h"
+#include "stats.h"
 
 #ifdef ENABLE_RTT
 #include "rtt.h"
@@ -45,6 +46,10 @@
 #include "traceswo.h"
 #endif
 
+#if PC_HOSTED == 1
+#include "swo.h"
+#endif
+
 #if defined(_WIN32)
 #include <malloc.h>
 #else
@@ -71,6 +76,7 @@ static bool cmd_target_power(target_s *t, int argc, const char **argv);
 static bool cmd_traceswo(target_s *t, int argc, const char **argv);
 #endif
 static bool cmd_heapinfo(target_s *t, int argc, const char **argv);
+static bool cmd_stats(target_s *t, int argc, const char **argv);
 #ifdef ENABLE_RTT
 static bool cmd_rtt(target_s *t, int argc, const char **argv);
 #endif
@@ -79,6 +85,7 @@ static bool cmd_debug_bmp(target_s *t, int argc, const char **argv);
 #endif
 #if PC_HOSTED == 1
 static bool cmd_shutdown_bmda(target_s *t, int argc, const char **argv);
+static bool cmd_traceswo_bmda(target_s *t, int argc, const char **argv);
 #endif
 
 const command_s cmd_list[] = {
@@ -105,17 +112,21 @@ const command_s cmd_list[] = {
 #endif
 #ifdef PLATFORM_HAS_TRACESWO
 #if defined TRACESWO_PROTOCOL && TRACESWO_PROTOCOL == 2
-	{"traceswo", cmd_traceswo, "Start trace capture, NRZ mode: [BAUDRATE] [decode [CHANNEL_NR ...]]"},
+	{"traceswo", cmd_traceswo, "Start trace capture, NRZ mode: [status|[BAUDRATE] [decode [CHANNEL_NR ...]]]"},
 #else
-	{"traceswo", cmd_traceswo, "Start trace capture, Manchester mode: [decode [CHANNEL_NR ...]]"},
+	{"traceswo", cmd_traceswo, "Start trace capture, Manchester mode: [status|decode [CHANNEL_NR ...]]"},
 #endif
 #endif
 	{"heapinfo", cmd_heapinfo, "Set semihosting heapinfo: HEAPINFO HEAP_BASE HEAP_LIMIT STACK_BASE STACK_LIMIT"},
+	{"stats", cmd_stats, "Display debug link performance counters: [reset]"},
 #if defined(PLATFORM_HAS_DEBUG) && PC_HOSTED == 0
 	{"debug_bmp", cmd_debug_bmp, "Output BMP \"debug\" strings to the second vcom: [enable|disable]"},
 #endif
 #if PC_HOSTED == 1
 	{"shutdown_bmda", cmd_shutdown_bmda, "Tell the BMDA server to shut down when the GDB connection closes"},
+	{"traceswo", cmd_traceswo_bmda,
+		"Start host-side trace capture: [disable|status|[manchester|BAUDRATE] [decode [CHANNEL_NR ...]] [output "
+		"PATH|unix:SOCKET]]"},
 #endif
 	{NULL, NULL, NULL},
 };
@@ -594,6 +605,15 @@ static bool cmd_traceswo(target_s *t, int argc, const char **argv)
 #endif
 	uint32_t swo_channelmask = 0; /* swo decoding off */
 	uint8_t decode_arg = 1;
+	if (argc == 2 && !strcmp(argv[1], "status")) {
+		gdb_outf("Syncs: %" PRIu32 ", overflows: %" PRIu32 ", timestamps: %" PRIu32 ", hardware packets: %" PRIu32
+				 ", errors: %" PRIu32 "\n",
+			traceswo_stats.syncs, traceswo_stats.overflows, traceswo_stats.timestamps, traceswo_stats.hardware_packets,
+			traceswo_stats.errors);
+		gdb_outf("Dropped: %" PRIu32 " captured bytes, %" PRIu32 " decoded bytes\n", traceswo_stats.capture_dropped,
+			traceswo_stats.decode_dropped);
+		return true;
+	}
 #if TRACESWO_PROTOCOL == 2
 	/* argument: optional baud rate for async mode */
 	if (argc > 1 && argv[1][0] >= '0' && argv[1][0] <= '9') {
@@ -664,6 +684,59 @@ static bool cmd_shutdown_bmda(target_s *t, int argc, const char **argv)
 	shutdown_bmda = true;
 	return true;
 }
+
+static bool cmd_traceswo_bmda(target_s *t, int argc, const char **argv)
+{
+	(void)t;
+	if (argc == 2 && !strcmp(argv[1], "disable")) {
+		bmda_swo_deinit();
+		return true;
+	}
+	if (argc == 2 && !strcmp(argv[1], "status")) {
+		bmda_swo_status();
+		return true;
+	}
+
+	swo_coding_e coding = SWO_CODING_NRZ;
+	uint32_t baudrate = BMDA_SWO_DEFAULT_BAUD;
+	bool decode = false;
+	uint32_t channel_mask = 0U;
+	const char *output = NULL;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "manchester"))
+			coding = SWO_CODING_MANCHESTER;
+		else if (!strcmp(argv[i], "decode")) {
+			decode = true;
+			channel_mask = 0xffffffffU; /* decoding all channels */
+			/* Any numbers following are the channels to decode */
+			if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9')
+				channel_mask = 0U;
+			for (; i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9'; ++i) {
+				const uint32_t channel = strtoul(argv[i + 1], NULL, 0);
+				if (channel < 32U)
+					channel_mask |= 1U << channel;
+			}
+		} else if (!strcmp(argv[i], "output") && i + 1 < argc)
+			output = argv[++i];
+		else if (!decode && argv[i][0] >= '0' && argv[i][0] <= '9') {
+			baudrate = strtoul(argv[i], NULL, 0);
+			if (baudrate == 0)
+				baudrate = BMDA_SWO_DEFAULT_BAUD;
+		} else {
+			gdb_out("usage: monitor traceswo [disable|status|[manchester|BAUDRATE] [decode [CHANNEL_NR ...]] "
+					"[output PATH|unix:SOCKET]]\n");
+			return false;
+		}
+	}
+
+	if (!bmda_swo_init(coding, baudrate, decode, channel_mask, output))
+		return false;
+	if (coding == SWO_CODING_NRZ)
+		gdb_outf("Baudrate: %" PRIu32 " ", baudrate);
+	gdb_outf("Channel mask: %08" PRIx32 "\n", channel_mask);
+	gdb_outf("Trace capture running, output to %s\n", output ? output : "stdout");
+	return true;
+}
 #endif
 
 static bool cmd_heapinfo(target_s *t, int argc, const char **argv)
@@ -682,3 +755,47 @@ static bool cmd_heapinfo(target_s *t, int argc, const char **argv)
 		gdb_outf("heapinfo heap_base heap_limit stack_base stack_limit\n");
 	return true;
 }
+
+static bool cmd_stats(target_s *t, int argc, const char **argv)
+{
+	if (argc == 2 && !strcmp(argv[1], "reset")) {
+		stats_reset();
+		for (target_flash_s *flash = t ? t->flash : NULL; flash; flash = flash->next) {
+			flash->erase_time = 0;
+			flash->write_time = 0;
+		}
+		return true;
+	}
+	if (argc != 1) {
+		gdb_out("usage: monitor stats [reset]\n");
+		return false;
+	}
+
+	for (size_t counter = 0; counter < STATS_COUNTERS; ++counter)
+		gdb_outf("%s: %" PRIu32 "\n", stats_counter_name(counter), stats_counters[counter]);
+
+	for (size_t histogram = 0; histogram < STATS_HISTOGRAMS; ++histogram) {
+		gdb_outf("%s (%s):\n", stats_histogram_name(histogram), stats_histogram_unit(histogram));
+		const uint32_t *const buckets = stats_histogram_buckets(histogram);
+		uint32_t lower = 0;
+		for (uint8_t bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; ++bucket) {
+			const uint32_t upper = stats_bucket_limit(bucket);
+			/* Only display buckets that have seen any values to keep this short */
+			if (buckets[bucket]) {
+				if (upper == UINT32_MAX)
+					gdb_outf("\t%" PRIu32 "+: %" PRIu32 "\n", lower, buckets[bucket]);
+				else if (upper == lower)
+					gdb_outf("\t%" PRIu32 ": %" PRIu32 "\n", lower, buckets[bucket]);
+				else
+					gdb_outf("\t%" PRIu32 "-%" PRIu32 ": %" PRIu32 "\n", lower, upper, buckets[bucket]);
+			}
+			lower = upper + 1U;
+		}
+	}
+
+	/* If we're attached to something, break the Flash timings down per Flash region too */
+	for (target_flash_s *flash = t ? t->flash : NULL; flash; flash = flash->next)
+		gdb_outf("flash 0x%08" PRIx32 ": erase %" PRIu32 "ms, write %" PRIu32 "ms\n", flash->start, flash->erase_time,
+			flash->write_time);
+	return true;
+}
@@ -35,7 +35,6 @@
 #include "target.h"
 #include "target_internal.h"
 #include "command.h"
-#include "crc32.h"
 #include "morse.h"
 #ifdef ENABLE_RTT
 #include "rtt.h"
@@ -57,6 +56,15 @@ typedef enum gdb_signal {
 
 #define GDB_MAX_PACKET_SIZE 1024U
 
+/* Both the ARMv7-M and ARMv7-A/R target descriptions number the program counter as register 15 */
+#define GDB_REG_PC 15
+
+/*
+ * Registers expedited in stop replies so GDB need not follow every stop with a 'g' packet:
+ * the frame pointer (r7 in Thumb code, r11 in ARM code), sp, lr, pc and xPSR/CPSR
+ */
+static const uint8_t gdb_expedited_regs[] = {7U, 11U, 13U, 14U, GDB_REG_PC, 16U};
+
 #define ERROR_IF_NO_TARGET()   \
 	if (!cur_target) {         \
 		gdb_putpacketz("EFF"); \
@@ -73,6 +81,14 @@ target_s *last_target;
 bool gdb_target_running = false;
 static bool gdb_needs_detach_notify = false;
 
+/*
+ * State for a 'vCont;r' range step - while this is active, step halts that leave the PC inside
+ * [start, end) are resumed again by gdb_poll_target() rather than being reported to GDB
+ */
+static bool gdb_range_stepping = false;
+static uint32_t gdb_range_start = 0;
+static uint32_t gdb_range_end = 0;
+
 static void handle_q_packet(char *packet, size_t len);
 static void handle_v_packet(char *packet, size_t len);
 static void handle_z_packet(char *packet, size_t len);
@@ -206,6 +222,7 @@ int gdb_main_loop(target_controller_s *tc, char *pbuf, size_t pbuf_size, size_t
 			break;
 		}
 
+		gdb_range_stepping = false;
 		target_halt_resume(cur_target, single_step);
 		SET_RUN_STATE(true);
 		single_step = false;
@@ -467,7 +484,7 @@ static void exec_q_crc(const char *packet, const size_t length)
 			return;
 		}
 		uint32_t crc;
-		if (!generic_crc32(cur_target, &crc, addr, addr_length))
+		if (!target_mem_crc32(cur_target, &crc, addr, addr_length))
 			gdb_putpacketz("E03");
 		else
 			gdb_putpacket_f("C%lx", crc);
@@ -531,6 +548,51 @@ static void handle_q_packet(char *packet, const size_t length)
 	gdb_putpacket("", 0);
 }
 
+static void exec_v_cont(const char *const actions)
+{
+	if (!cur_target) {
+		gdb_putpacketz("X1D");
+		return;
+	}
+
+	/*
+	 * We only present a single thread to GDB, so the first action in the list is
+	 * always the one that applies to it and any thread-id suffix can be ignored.
+	 */
+	bool step = false;
+	gdb_range_stepping = false;
+	switch (actions[0]) {
+	case 'c': /* 'c'/'C sig': Continue */
+	case 'C':
+		break;
+	case 's': /* 's'/'S sig': Single step */
+	case 'S':
+		step = true;
+		break;
+	case 'r': /* 'r start,end': Step until the PC leaves [start, end) */
+		if (sscanf(actions, "r%" SCNx32 ",%" SCNx32, &gdb_range_start, &gdb_range_end) != 2) {
+			gdb_putpacketz("E01");
+			return;
+		}
+		gdb_range_stepping = gdb_range_start < gdb_range_end;
+		step = true;
+		break;
+	case 't': /* 't': Stop - the halt is then reported by gdb_poll_target() */
+		target_halt_request(cur_target);
+		/* Poll quickly so the halt gets reported promptly */
+		platform_pace_restart();
+		gdb_target_running = true;
+		return;
+	default:
+		gdb_putpacketz("E01");
+		return;
+	}
+
+	target_halt_resume(cur_target, step);
+	SET_RUN_STATE(true);
+	gdb_target_running = true;
+}
+
 static void handle_v_packet(char *packet, const size_t plen)
 {
 	uint32_t addr = 0;
@@ -647,6 +709,13 @@ static void handle_v_packet(char *packet, const size_t plen)
 		else
 			gdb_putpacketz("EFF");
 
+	} else if (!strcmp(packet, "vCont?")) {
+		/* Report the vCont actions we support, including range stepping */
+		gdb_putpacketz("vCont;c;C;s;S;t;r");
+
+	} else if (!strncmp(packet, "vCont;", 6U)) {
+		exec_v_cont(packet + 6U);
+
 	} else if (!strcmp(packet, "vStopped")) {
 		if (gdb_needs_detach_notify) {
 			gdb_putpacketz("W00");
@@ -694,6 +763,8 @@ void gdb_main(char *pbuf, size_t pbuf_size, size_t size)
 /* halt target */
 void gdb_halt_target(void)
 {
+	/* An interrupt from GDB must end any range step in progress, or it would just be stepped over */
+	gdb_range_stepping = false;
 	if (cur_target)
 		target_halt_request(cur_target);
 	else
@@ -701,6 +772,31 @@ void gdb_halt_target(void)
 		gdb_putpacketz("W00");
 }
 
+/*
+ * Send a 'T' stop reply for the current target, appending the expedited registers
+ * collected with a single batched register file read
+ */
+static void gdb_put_stop_reply(const gdb_signal_e signal, const char *const info)
+{
+	char reply[128U];
+	size_t offset = (size_t)snprintf(reply, sizeof(reply), "T%02X%s", signal, info);
+
+	/* Only targets with an ARM-style core register file (r0-r15 followed by the status register) qualify */
+	const size_t reg_size = target_regs_size(cur_target);
+	if (reg_size >= (GDB_REG_PC + 2U) * sizeof(uint32_t)) {
+		uint32_t regs[reg_size / sizeof(uint32_t)];
+		target_regs_read(cur_target, regs);
+		for (size_t i = 0; i < ARRAY_LENGTH(gdb_expedited_regs); ++i) {
+			const uint8_t reg = gdb_expedited_regs[i];
+			offset += (size_t)snprintf(reply + offset, sizeof(reply) - offset, "%02X:", reg);
+			hexify(reply + offset, &regs[reg], sizeof(uint32_t));
+			offset += sizeof(uint32_t) * 2U;
+			reply[offset++] = ';';
+		}
+	}
+	gdb_putpacket(reply, offset);
+}
+
 /* poll running target */
 void gdb_poll_target(void)
 {
@@ -716,6 +812,21 @@ void gdb_poll_target(void)
 	if (!reason)
 		return;
 
+	/*
+	 * If we're range stepping and the step landed back inside the range, step again without
+	 * bothering GDB - this turns a whole 'next' over a line into a single round trip.
+	 */
+	if (gdb_range_stepping) {
+		uint32_t pc = 0;
+		if (reason == TARGET_HALT_STEPPING &&
+			target_reg_read(cur_target, GDB_REG_PC, &pc, sizeof(pc)) == (ssize_t)sizeof(pc) && pc >= gdb_range_start &&
+			pc < gdb_range_end) {
+			target_halt_resume(cur_target, true);
+			return;
+		}
+		gdb_range_stepping = false;
+	}
+
 	/* switch polling off */
 	gdb_target_running = false;
 	SET_RUN_STATE(0);
@@ -727,15 +838,18 @@ void gdb_poll_target(void)
 		morse("TARGET LOST.", true);
 		break;
 	case TARGET_HALT_REQUEST:
-		gdb_putpacket_f("T%02X", GDB_SIGINT);
+		gdb_put_stop_reply(GDB_SIGINT, "");
 		break;
-	case TARGET_HALT_WATCHPOINT:
-		gdb_putpacket_f("T%02Xwatch:%08X;", GDB_SIGTRAP, watch);
+	case TARGET_HALT_WATCHPOINT: {
+		char info[16U];
+		snprintf(info, sizeof(info), "watch:%08" PRIX32 ";", watch);
+		gdb_put_stop_reply(GDB_SIGTRAP, info);
 		break;
+	}
 	case TARGET_HALT_FAULT:
-		gdb_putpacket_f("T%02X", GDB_SIGSEGV);
+		gdb_put_stop_reply(GDB_SIGSEGV, "");
 		break;
 	default:
-		gdb_putpacket_f("T%02X", GDB_SIGTRAP);
+		gdb_put_stop_reply(GDB_SIGTRAP, "");
 	}
 }
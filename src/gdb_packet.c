@@ -233,9 +233,8 @@ void gdb_putpacket_f(const char *const fmt, ...)
 	va_end(ap);
 }
 
-void gdb_out(const char *const buf)
+void gdb_out_buf(const char *const buf, const size_t buf_len)
 {
-	const size_t buf_len = strlen(buf);
 	char *hexdata = calloc(1, 2U * buf_len + 1U);
 	if (!hexdata)
 		return;
@@ -245,6 +244,11 @@ void gdb_out(const char *const buf)
 	free(hexdata);
 }
 
+void gdb_out(const char *const buf)
+{
+	gdb_out_buf(buf, strlen(buf));
+}
+
 void gdb_voutf(const char *const fmt, va_list ap)
 {
 	char *buf;
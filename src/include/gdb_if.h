@@ -24,6 +24,10 @@
 #if PC_HOSTED == 0
 #include <libopencm3/usb/usbd.h>
 void gdb_usb_out_cb(usbd_device *dev, uint8_t ep);
+void gdb_usb_in_cb(usbd_device *dev, uint8_t ep);
+#else
+/* Wait up to timeout ms for data from GDB without consuming it, returning whether there is any */
+bool gdb_if_wait(uint32_t timeout);
 #endif
 
 int gdb_if_init(void);
@@ -29,6 +29,7 @@ extern bool gdb_target_running;
 extern target_s *cur_target;
 
 void gdb_poll_target(void);
+void gdb_halt_target(void);
 void gdb_main(char *pbuf, size_t pbuf_size, size_t size);
 int gdb_main_loop(target_controller_s *tc, char *pbuf, size_t pbuf_size, size_t size, bool in_syscall);
 char *gdb_packet_buffer();
@@ -32,11 +32,16 @@
 
 #if PC_HOSTED == 1
 void platform_init(int argc, char **argv);
+void platform_pace_restart(void);
 void platform_pace_poll(void);
 #else
 void platform_init(void);
 
-inline void platform_pace_poll(void)
+static inline void platform_pace_restart(void)
+{
+}
+
+static inline void platform_pace_poll(void)
 {
 }
 #endif
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef INCLUDE_PROFILE_H
+#define INCLUDE_PROFILE_H
+
+#include "target.h"
+
+/*
+ * PC sampling profiler - a target supplies a way to read the PC of the running core
+ * and samples are aggregated into a histogram of fixed size bins over [low_pc, high_pc)
+ */
+
+/* Reads a sample of the running PC, returns false if the core had no PC to offer (halted, sleeping) */
+typedef bool (*profile_sample_fn)(target_s *target, uint32_t *pc);
+
+typedef struct profile_info {
+	uint32_t low_pc;
+	uint32_t high_pc;
+	uint32_t bin_size;
+	uint32_t bins;
+	uint32_t rate; /* Requested samples per second, at most one per poll, 0 for one every poll */
+	uint32_t samples;
+	uint32_t idle;    /* Samples where the core had no PC to offer */
+	uint32_t outside; /* Samples outside [low_pc, high_pc) */
+	uint32_t elapsed_ms;
+	bool running;
+} profile_info_s;
+
+bool profile_start(target_s *target, profile_sample_fn sample, uint32_t rate, uint32_t low_pc, uint32_t high_pc);
+void profile_stop(void);
+void profile_poll(target_s *target);
+
+const profile_info_s *profile_info(void);
+/* Print the hottest bins as a flat profile */
+void profile_report_flat(uint32_t count);
+#if PC_HOSTED == 1
+/* Write the histogram out in gprof's gmon.out format */
+bool profile_write_gmon(const char *path);
+#endif
+
+#endif /* INCLUDE_PROFILE_H */
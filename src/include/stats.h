@@ -0,0 +1,87 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INCLUDE_STATS_H
+#define INCLUDE_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Lightweight counters and histograms for the hot paths of the debug link,
+ * reported by `monitor stats` so link performance can be tuned and compared
+ */
+
+typedef enum stats_counter {
+	STATS_SWD_TRANSACTIONS,
+	STATS_SWD_WAIT_RETRIES,
+	STATS_SWD_FAULT_RETRIES,
+	STATS_DP_SELECT_WRITES,
+	STATS_AP_CSW_WRITES,
+	STATS_USB_TX_PACKETS,
+	STATS_USB_RX_PACKETS,
+	STATS_USB_TX_TRANSFERS,
+	STATS_USB_RX_TRANSFERS,
+	STATS_HALT_POLLS,
+	STATS_FLASH_ERASES,
+	STATS_FLASH_WRITES,
+	STATS_COUNTERS,
+} stats_counter_e;
+
+typedef enum stats_histogram {
+	STATS_FLASH_ERASE_TIME,
+	STATS_FLASH_WRITE_TIME,
+	STATS_HISTOGRAMS,
+} stats_histogram_e;
+
+/*
+ * Histogram buckets are power-of-two sized: bucket 0 counts values of 0,
+ * bucket n values from 2^(n-1) to 2^n - 1, and the last bucket everything above that
+ */
+#define STATS_HISTOGRAM_BUCKETS 12U
+
+extern uint32_t stats_counters[STATS_COUNTERS];
+
+static inline void stats_increment(const stats_counter_e counter)
+{
+	++stats_counters[counter];
+}
+
+void stats_record(stats_histogram_e histogram, uint32_t value);
+void stats_reset(void);
+
+const char *stats_counter_name(stats_counter_e counter);
+const char *stats_histogram_name(stats_histogram_e histogram);
+const char *stats_histogram_unit(stats_histogram_e histogram);
+const uint32_t *stats_histogram_buckets(stats_histogram_e histogram);
+uint32_t stats_bucket_limit(uint8_t bucket);
+
+#endif /* INCLUDE_STATS_H */
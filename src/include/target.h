@@ -59,6 +59,7 @@ bool target_mem_map(target_s *target, char *buf, size_t len);
 int target_mem_read(target_s *target, void *dest, target_addr_t src, size_t len);
 int target_mem_write(target_s *target, target_addr_t dest, const void *src, size_t len);
 bool target_mem_access_needs_halt(target_s *target);
+bool target_mem_crc32(target_s *target, uint32_t *crc, target_addr_t base, size_t len);
 /* Flash memory access functions */
 bool target_flash_erase(target_s *target, target_addr_t addr, size_t len);
 bool target_flash_write(target_s *target, target_addr_t dest, const void *src, size_t len);
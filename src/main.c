@@ -29,6 +29,7 @@
 #include "gdb_packet.h"
 #include "morse.h"
 #include "command.h"
+#include "profile.h"
 #ifdef ENABLE_RTT
 #include "rtt.h"
 #endif
@@ -51,9 +52,10 @@ static void bmp_poll_loop(void)
 		// alter these variables.
 		if (!gdb_target_running || !cur_target)
 			break;
+		profile_poll(cur_target);
 		char c = gdb_if_getchar_to(0);
 		if (c == '\x03' || c == '\x04')
-			target_halt_request(cur_target);
+			gdb_halt_target();
 		platform_pace_poll();
 #ifdef ENABLE_RTT
 		if (rtt_enabled)
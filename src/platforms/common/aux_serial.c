@@ -40,14 +40,14 @@ static uint32_t aux_serial_active_baud_rate;
 
 static char aux_serial_receive_buffer[AUX_UART_BUFFER_SIZE];
 /* Fifo in pointer, writes assumed to be atomic, should be only incremented within RX ISR */
-static uint8_t aux_serial_receive_write_index = 0;
+static uint16_t aux_serial_receive_write_index = 0;
 /* Fifo out pointer, writes assumed to be atomic, should be only incremented outside RX ISR */
-static uint8_t aux_serial_receive_read_index = 0;
+static uint16_t aux_serial_receive_read_index = 0;
 
 #if defined(STM32F0) || defined(STM32F1) || defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
-static char aux_serial_transmit_buffer[2U][AUX_UART_BUFFER_SIZE];
+static char aux_serial_transmit_buffer[2U][AUX_UART_TX_BUFFER_SIZE];
 static uint8_t aux_serial_transmit_buffer_index = 0;
-static uint8_t aux_serial_transmit_buffer_consumed = 0;
+static uint16_t aux_serial_transmit_buffer_consumed = 0;
 static bool aux_serial_transmit_complete = true;
 
 static volatile uint8_t aux_serial_led_state = 0;
@@ -90,7 +90,24 @@ static char aux_serial_transmit_buffer[AUX_UART_BUFFER_SIZE];
 
 static void aux_serial_set_baudrate(const uint32_t baud_rate)
 {
+#if defined(USART_CR1_OVER8)
+	/*
+	 * With 16x oversampling the USART tops out at its clock / 16, so switch to 8x oversampling
+	 * for anything faster, which gets the multi-Mbaud rates targets commonly log at.
+	 * This must only be called with the USART disabled.
+	 */
+	const uint32_t clock = rcc_get_usart_clk_freq(USBUSART);
+	if (baud_rate > clock / 16U) {
+		const uint32_t divider = MAX((2U * clock + baud_rate / 2U) / baud_rate, 16U);
+		USART_CR1(USBUSART) |= USART_CR1_OVER8;
+		USART_BRR(USBUSART) = (divider & 0xfff0U) | ((divider & 0x000fU) >> 1U);
+	} else {
+		USART_CR1(USBUSART) &= ~USART_CR1_OVER8;
+		usart_set_baudrate(USBUSART, baud_rate);
+	}
+#else
 	usart_set_baudrate(USBUSART, baud_rate);
+#endif
 	aux_serial_active_baud_rate = baud_rate;
 }
 
@@ -110,6 +127,10 @@ void aux_serial_init(void)
 	usart_set_parity(USBUSART, USART_PARITY_NONE);
 	usart_set_flow_control(USBUSART, USART_FLOWCONTROL_NONE);
 	USART_CR1(USBUSART) |= USART_CR1_IDLEIE;
+#if defined(USART_CR3_OVRDIS)
+	/* Let an overrun drop a byte rather than stall reception until software clears it */
+	USART_CR3(USBUSART) |= USART_CR3_OVRDIS;
+#endif
 
 	/* Setup USART TX DMA */
 #if !defined(USBUSART_TDR) && defined(USBUSART_DR)
@@ -573,7 +594,7 @@ void USBUART_ISR(void)
 
 		char packet_buf[CDCACM_PACKET_SIZE];
 		uint8_t packet_size = 0;
-		uint8_t buf_out = aux_serial_receive_read_index;
+		uint16_t buf_out = aux_serial_receive_read_index;
 
 		/* copy from uart FIFO into local usb packet buffer */
 		while (aux_serial_receive_write_index != buf_out && packet_size < CDCACM_PACKET_SIZE) {
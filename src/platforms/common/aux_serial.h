@@ -26,16 +26,28 @@
 #include "usb_types.h"
 
 #if defined(STM32F0) || defined(STM32F1) || defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
-/* XXX: Does the st_usbfs_v2_usb_driver work on F3 with 128 byte buffers? */
-#if defined(STM32F1) || defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
-#define USART_DMA_BUF_SHIFT 7U
-#elif defined(STM32F0)
-/* The st_usbfs_v2_usb_driver only works with up to 64-byte buffers on the F0 parts */
-#define USART_DMA_BUF_SHIFT 6U
+/*
+ * The receive ring is filled by circular DMA and drained to USB as the line goes idle or the
+ * ring passes half and full, while the transmit side is a pair of buffers that alternate
+ * between being filled from USB and being sent by DMA. Both need to cover several USB frames'
+ * worth of data at multi-Mbaud rates. Platforms can override these.
+ */
+#ifndef AUX_UART_BUFFER_SIZE
+#if defined(STM32F0)
+/* The F072 only has 16KiB of SRAM, and the st_usbfs_v2_usb_driver only works with up to 64-byte buffers */
+#define AUX_UART_BUFFER_SIZE    64U
+#define AUX_UART_TX_BUFFER_SIZE 64U
+#elif defined(STM32F1)
+/* The F1 based probes (native, stlink, swlink) only have 20KiB of SRAM, so keep to the original buffers */
+#define AUX_UART_BUFFER_SIZE    128U
+#define AUX_UART_TX_BUFFER_SIZE 128U
+#else
+#define AUX_UART_BUFFER_SIZE 4096U
+#endif
+#endif
+#ifndef AUX_UART_TX_BUFFER_SIZE
+#define AUX_UART_TX_BUFFER_SIZE (AUX_UART_BUFFER_SIZE / 2U)
 #endif
-
-#define USART_DMA_BUF_SIZE   (1U << USART_DMA_BUF_SHIFT)
-#define AUX_UART_BUFFER_SIZE (USART_DMA_BUF_SIZE)
 #elif defined(LM4F)
 #define AUX_UART_BUFFER_SIZE 128U
 #endif
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Split the ITM/DWT packet stream carried on SWO into packets, shared by the
+ * firmware's serial decoder and BMDA's trace capture.
+ *
+ * ARM DDI 0403E - ARMv7-M Architecture Reference Manual, Appendix D4 (Debug ITM and DWT Packet Protocol)
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "itm_decoder.h"
+
+void itm_decoder_init(
+	itm_decoder_s *const decoder, itm_packet_fn source_packet, itm_packet_fn protocol_packet, void *const context)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->source_packet = source_packet;
+	decoder->protocol_packet = protocol_packet;
+	decoder->context = context;
+}
+
+void itm_decoder_reset(itm_decoder_s *const decoder)
+{
+	decoder->state = ITM_DECODER_HEADER;
+	decoder->sync_zeros = 0U;
+	decoder->syncs = 0U;
+	decoder->overflows = 0U;
+	decoder->errors = 0U;
+}
+
+static void itm_protocol_packet(itm_decoder_s *const decoder)
+{
+	decoder->payload_length = decoder->payload_offset;
+	if (decoder->protocol_packet)
+		decoder->protocol_packet(decoder);
+}
+
+static void itm_header(itm_decoder_s *const decoder, const uint8_t header)
+{
+	/* Synchronisation is at least 47 zero bits followed by a one, so count the zero bytes */
+	if (header == 0U) {
+		if (decoder->sync_zeros < UINT8_MAX)
+			++decoder->sync_zeros;
+		return;
+	}
+	const bool sync = header == ITM_SYNC_END && decoder->sync_zeros >= ITM_SYNC_ZEROS;
+	decoder->sync_zeros = 0U;
+	if (sync) {
+		++decoder->syncs;
+		return;
+	}
+
+	decoder->header = header;
+	decoder->payload_offset = 0U;
+	if (header == ITM_OVERFLOW)
+		++decoder->overflows;
+	else if (header & ITM_SOURCE_SIZE_MASK) {
+		/* Instrumentation and hardware source packets carry 1, 2 or 4 bytes */
+		const uint8_t size = header & ITM_SOURCE_SIZE_MASK;
+		decoder->payload_length = size == 3U ? 4U : size;
+		decoder->state = ITM_DECODER_SOURCE_PAYLOAD;
+	} else if (!(header & ITM_TIMESTAMP_MASK) || header == ITM_GLOBAL_TIMESTAMP_1 ||
+		header == ITM_GLOBAL_TIMESTAMP_2 || (header & ITM_EXTENSION_MASK) == ITM_EXTENSION) {
+		/* Local timestamp format 2 and short extensions live in the header, everything else has continuation bytes */
+		if (header & ITM_CONTINUATION) {
+			decoder->payload_length = header == ITM_GLOBAL_TIMESTAMP_2 ? 6U : 4U;
+			decoder->state = ITM_DECODER_PROTOCOL_PAYLOAD;
+		} else
+			itm_protocol_packet(decoder);
+	} else
+		++decoder->errors;
+}
+
+void itm_decode(itm_decoder_s *const decoder, const uint8_t *const data, const size_t length)
+{
+	for (size_t offset = 0; offset < length; ++offset) {
+		const uint8_t byte = data[offset];
+		switch (decoder->state) {
+		case ITM_DECODER_HEADER:
+			itm_header(decoder, byte);
+			break;
+		case ITM_DECODER_SOURCE_PAYLOAD:
+			decoder->payload[decoder->payload_offset++] = byte;
+			if (decoder->payload_offset == decoder->payload_length) {
+				decoder->state = ITM_DECODER_HEADER;
+				if (decoder->source_packet)
+					decoder->source_packet(decoder);
+			}
+			break;
+		case ITM_DECODER_PROTOCOL_PAYLOAD:
+			decoder->payload[decoder->payload_offset++] = byte;
+			if (!(byte & ITM_CONTINUATION) || decoder->payload_offset == decoder->payload_length) {
+				decoder->state = ITM_DECODER_HEADER;
+				itm_protocol_packet(decoder);
+			}
+			break;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_COMMON_ITM_DECODER_H
+#define PLATFORMS_COMMON_ITM_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* ITM packet headers (ARMv7-M ARM, Appendix D4) */
+#define ITM_SYNC_ZEROS         5U
+#define ITM_SYNC_END           0x80U
+#define ITM_OVERFLOW           0x70U
+#define ITM_SOURCE_SIZE_MASK   0x03U
+#define ITM_SOURCE_HARDWARE    0x04U
+#define ITM_SOURCE_ADDRESS(h)  ((h) >> 3U)
+#define ITM_CONTINUATION       0x80U
+#define ITM_TIMESTAMP_MASK     0x0fU
+#define ITM_GLOBAL_TIMESTAMP_1 0x94U
+#define ITM_GLOBAL_TIMESTAMP_2 0xb4U
+#define ITM_EXTENSION_MASK     0x0bU
+#define ITM_EXTENSION          0x08U
+
+typedef struct itm_decoder itm_decoder_s;
+
+/* Called with the decoder holding a complete packet in header, payload and payload_length */
+typedef void (*itm_packet_fn)(itm_decoder_s *decoder);
+
+typedef enum itm_decoder_state {
+	ITM_DECODER_HEADER,
+	ITM_DECODER_SOURCE_PAYLOAD,
+	ITM_DECODER_PROTOCOL_PAYLOAD,
+} itm_decoder_state_e;
+
+struct itm_decoder {
+	itm_decoder_state_e state;
+	uint8_t header;
+	uint8_t payload_offset;
+	/* Expected payload size while collecting, the size actually received once a packet is handed out */
+	uint8_t payload_length;
+	uint8_t payload[7];
+	uint8_t sync_zeros;
+
+	uint32_t syncs;
+	uint32_t overflows;
+	uint32_t errors;
+
+	/* Instrumentation and hardware source packets */
+	itm_packet_fn source_packet;
+	/* Timestamp and extension packets, including those carried entirely in their header */
+	itm_packet_fn protocol_packet;
+	void *context;
+};
+
+void itm_decoder_init(
+	itm_decoder_s *decoder, itm_packet_fn source_packet, itm_packet_fn protocol_packet, void *context);
+void itm_decoder_reset(itm_decoder_s *decoder);
+void itm_decode(itm_decoder_s *decoder, const uint8_t *data, size_t length);
+
+#endif /* PLATFORMS_COMMON_ITM_DECODER_H */
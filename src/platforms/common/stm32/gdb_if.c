@@ -30,75 +30,162 @@
 #include "platform.h"
 #include "usb_serial.h"
 #include "gdb_if.h"
+#include "stats.h"
 
+/*
+ * Both directions are buffered a whole packet per slot in rings driven from the endpoint callbacks.
+ * Received packets queue up until the GDB server gets to them, and the host is NAKed only once every
+ * slot is taken. Replies are queued a packet at a time and sent back to back as each transfer
+ * completes, so building the next packet overlaps sending the last and gdb_if_putchar() only has to
+ * wait when the transmit ring is full.
+ *
+ * Each ring holds one packet fewer than it has slots, as head == tail means empty.
+ */
+#ifndef GDB_IF_RX_PACKETS
+#define GDB_IF_RX_PACKETS 4U
+#endif
+#ifndef GDB_IF_TX_PACKETS
+#define GDB_IF_TX_PACKETS 4U
+#endif
+
+/* The receive ring - the head is only moved by the OUT callback, the tail only by the GDB server */
+static char rx_buffer[GDB_IF_RX_PACKETS][CDCACM_PACKET_SIZE];
+static uint16_t rx_length[GDB_IF_RX_PACKETS];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+static volatile bool rx_nak;
+/* Length of and read offset into the packet at rx_tail while it is being consumed */
 static uint32_t count_out;
-static uint32_t count_in;
 static uint32_t out_ptr;
-static char buffer_out[CDCACM_PACKET_SIZE];
-static char buffer_in[CDCACM_PACKET_SIZE];
-#if defined(STM32F4) || defined(STM32F7)
-static volatile uint32_t count_new;
-static char double_buffer_out[CDCACM_PACKET_SIZE];
-#endif
+
+/* The transmit ring - the head is only moved by gdb_if_putchar(), the tail only by the IN callback */
+static char tx_buffer[GDB_IF_TX_PACKETS][CDCACM_PACKET_SIZE];
+static uint16_t tx_length[GDB_IF_TX_PACKETS];
+static bool tx_zlp[GDB_IF_TX_PACKETS];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+/* Whether the packet at tx_tail (or the ZLP that follows it) is in the hands of the USB peripheral */
+static volatile bool tx_active;
+static uint32_t count_in;
+
+static inline void gdb_if_lock(void)
+{
+	__asm__ volatile("cpsid i; isb");
+}
+
+static inline void gdb_if_unlock(void)
+{
+	__asm__ volatile("cpsie i; isb");
+}
+
+/* Start sending the packet at the tail of the transmit ring if the endpoint is idle, call with USB locked out */
+static void gdb_if_tx_start(usbd_device *const dev)
+{
+	if (tx_active || tx_tail == tx_head)
+		return;
+	/* If a stale transfer still holds the endpoint this fails, and the next call tries again */
+	if (usbd_ep_write_packet(dev, CDCACM_GDB_ENDPOINT, tx_buffer[tx_tail], tx_length[tx_tail]) == 0)
+		return;
+	tx_active = true;
+	stats_increment(STATS_USB_TX_PACKETS);
+}
+
+void gdb_usb_in_cb(usbd_device *const dev, const uint8_t ep)
+{
+	(void)ep;
+	if (!tx_active)
+		return;
+	if (tx_zlp[tx_tail]) {
+		/*
+		 * A reply that ends on a full packet needs an empty packet after it
+		 * for the host to accept it as a complete transfer.
+		 */
+		tx_zlp[tx_tail] = false;
+		usbd_ep_write_packet(dev, CDCACM_GDB_ENDPOINT, NULL, 0);
+		return;
+	}
+	tx_tail = (tx_tail + 1U) % GDB_IF_TX_PACKETS;
+	tx_active = false;
+	gdb_if_tx_start(dev);
+}
 
 void gdb_if_putchar(const char c, const int flush)
 {
-	buffer_in[count_in++] = c;
+	tx_buffer[tx_head][count_in++] = c;
 	if (flush || count_in == CDCACM_PACKET_SIZE) {
+		const uint8_t next = (tx_head + 1U) % GDB_IF_TX_PACKETS;
+		/* Wait for a slot to free up, unless nobody's going to take the data */
+		while (next == tx_tail && usb_get_config() == 1 && gdb_serial_get_dtr()) {
+			gdb_if_lock();
+			gdb_if_tx_start(usbdev);
+			gdb_if_unlock();
+		}
 		/* Refuse to send if USB isn't configured, and
 		 * don't bother if nobody's listening */
 		if (usb_get_config() != 1 || !gdb_serial_get_dtr()) {
+			gdb_if_lock();
+			tx_tail = tx_head;
+			tx_active = false;
+			gdb_if_unlock();
 			count_in = 0;
 			return;
 		}
-		while (usbd_ep_write_packet(usbdev, CDCACM_GDB_ENDPOINT, buffer_in, count_in) <= 0)
-			continue;
-
-		if (flush && count_in == CDCACM_PACKET_SIZE) {
-			/* We need to send an empty packet for some hosts
-			 * to accept this as a complete transfer. */
-			/* libopencm3 needs a change for us to confirm when
-			 * that transfer is complete, so we just send a packet
-			 * containing a null byte for now.
-			 */
-			while (usbd_ep_write_packet(usbdev, CDCACM_GDB_ENDPOINT, "\0", 1) <= 0)
-				continue;
-		}
 
+		tx_length[tx_head] = count_in;
+		tx_zlp[tx_head] = flush && count_in == CDCACM_PACKET_SIZE;
 		count_in = 0;
+		gdb_if_lock();
+		tx_head = next;
+		gdb_if_tx_start(usbdev);
+		gdb_if_unlock();
 	}
 }
 
-#if defined(STM32F4) || defined(STM32F7)
-void gdb_usb_out_cb(usbd_device *dev, uint8_t ep)
+void gdb_usb_out_cb(usbd_device *const dev, const uint8_t ep)
 {
 	(void)ep;
-	usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 1);
-	count_new = usbd_ep_read_packet(dev, CDCACM_GDB_ENDPOINT, double_buffer_out, CDCACM_PACKET_SIZE);
-	if (!count_new)
-		usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 0);
+	const uint8_t next = (rx_head + 1U) % GDB_IF_RX_PACKETS;
+	/* We only get here with the ring full if the host ignored a NAK, so leave the packet where it is */
+	if (next == rx_tail) {
+		usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 1);
+		rx_nak = true;
+		return;
+	}
+	/* If this packet takes the last free slot, hold the host off until the GDB server catches up */
+	const bool fills_ring = (next + 1U) % GDB_IF_RX_PACKETS == rx_tail;
+	if (fills_ring)
+		usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 1);
+	const uint16_t count = usbd_ep_read_packet(dev, CDCACM_GDB_ENDPOINT, rx_buffer[rx_head], CDCACM_PACKET_SIZE);
+	if (!count) {
+		if (fills_ring)
+			usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 0);
+		return;
+	}
+	rx_length[rx_head] = count;
+	rx_head = next;
+	rx_nak = fills_ring;
+	stats_increment(STATS_USB_RX_PACKETS);
 }
-#endif
 
 static void gdb_if_update_buf(void)
 {
 	while (usb_get_config() != 1)
 		continue;
-#if !defined(STM32F4) && !defined(STM32F7)
-	count_out = usbd_ep_read_packet(usbdev, CDCACM_GDB_ENDPOINT, buffer_out, CDCACM_PACKET_SIZE);
-	out_ptr = 0;
-#else
-	__asm__ volatile("cpsid i; isb");
-	if (count_new) {
-		memcpy(buffer_out, double_buffer_out, count_new);
-		count_out = count_new;
-		count_new = 0;
-		out_ptr = 0;
-		usbd_ep_nak_set(usbdev, CDCACM_GDB_ENDPOINT, 0);
+	/* Hand the packet we've finished with back to the ring, letting the host send more if it was held off */
+	if (count_out) {
+		gdb_if_lock();
+		rx_tail = (rx_tail + 1U) % GDB_IF_RX_PACKETS;
+		if (rx_nak) {
+			rx_nak = false;
+			usbd_ep_nak_set(usbdev, CDCACM_GDB_ENDPOINT, 0);
+		}
+		gdb_if_unlock();
+		count_out = 0;
 	}
-	__asm__ volatile("cpsie i; isb");
-#endif
-	if (!count_out)
+	out_ptr = 0;
+	if (rx_tail != rx_head)
+		count_out = rx_length[rx_tail];
+	else
 		__WFI();
 }
 
@@ -119,7 +206,7 @@ char gdb_if_getchar(void)
 		gdb_if_update_buf();
 	}
 
-	return buffer_out[out_ptr++];
+	return rx_buffer[rx_tail][out_ptr++];
 }
 
 char gdb_if_getchar_to(const uint32_t timeout)
@@ -143,7 +230,7 @@ char gdb_if_getchar_to(const uint32_t timeout)
 	}
 
 	if (out_ptr < count_out)
-		return buffer_out[out_ptr++];
+		return rx_buffer[rx_tail][out_ptr++];
 	/* XXX: Need to find a better way to error return than this. This provides '\xff' characters. */
 	return -1;
 }
@@ -19,6 +19,9 @@
 #include "general.h"
 #include "platform.h"
 #include "morse.h"
+#ifdef PLATFORM_HAS_TRACESWO
+#include "traceswo.h"
+#endif
 
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/cm3/nvic.h>
@@ -61,6 +64,11 @@ void sys_tick_handler(void)
 		morse_tick = 0;
 	} else
 		++morse_tick;
+
+#ifdef PLATFORM_HAS_TRACESWO
+	/* Flush out trace data left waiting */
+	traceswo_tick();
+#endif
 }
 
 uint32_t platform_time_ms(void)
@@ -43,9 +43,6 @@
 /* SWO decoding */
 static bool decoding = false;
 
-static uint8_t trace_usb_buf[64];
-static uint8_t trace_usb_buf_size;
-
 void traceswo_init(uint32_t swo_chan_bitmask)
 {
 	TRACE_TIM_CLK_EN();
@@ -82,35 +79,21 @@ void traceswo_init(uint32_t swo_chan_bitmask)
 	timer_enable_counter(TRACE_TIM);
 
 	traceswo_setmask(swo_chan_bitmask);
+	traceswo_buffer_reset();
 	decoding = (swo_chan_bitmask != 0);
 }
 
-void trace_buf_push(uint8_t *buf, int len)
+static void trace_buf_push(const uint8_t *const buf, const uint16_t len)
 {
 	if (decoding)
 		traceswo_decode(usbdev, CDCACM_UART_ENDPOINT, buf, len);
-	else if (usbd_ep_write_packet(usbdev, USB_REQ_TYPE_IN | TRACE_ENDPOINT, buf, len) != len) {
-		if (trace_usb_buf_size + len > 64) {
-			/* Stall if upstream to too slow. */
-			usbd_ep_stall_set(usbdev, USB_REQ_TYPE_IN | TRACE_ENDPOINT, 1);
-			trace_usb_buf_size = 0;
-			return;
-		}
-		memcpy(trace_usb_buf + trace_usb_buf_size, buf, len);
-		trace_usb_buf_size += len;
-	}
+	else
+		traceswo_buffer_push(buf, len);
 }
 
-void trace_buf_drain(usbd_device *dev, uint8_t ep)
+void traceswo_tick(void)
 {
-	if (!trace_usb_buf_size)
-		return;
-
-	if (decoding)
-		traceswo_decode(dev, CDCACM_UART_ENDPOINT, trace_usb_buf, trace_usb_buf_size);
-	else
-		usbd_ep_write_packet(dev, ep, trace_usb_buf, trace_usb_buf_size);
-	trace_usb_buf_size = 0;
+	traceswo_buffer_flush();
 }
 
 #define ALLOWED_DUTY_ERROR 5
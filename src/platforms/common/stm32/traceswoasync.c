@@ -28,7 +28,6 @@
 
 /* TDO/TRACESWO signal comes into the SWOUSART RX pin. */
 
-#include <stdatomic.h>
 #include "general.h"
 #include "platform.h"
 #include "usb.h"
@@ -41,41 +40,60 @@
 #include <libopencm3/stm32/usart.h>
 #include <libopencm3/stm32/dma.h>
 
-static volatile uint32_t write_index; /* Packet currently received via UART */
-static volatile uint32_t read_index;  /* Packet currently waiting to transmit to USB */
-/* Packets arrived from the SWO interface */
-static uint8_t trace_rx_buf[NUM_TRACE_PACKETS * TRACE_ENDPOINT_SIZE];
-/* Packet pingpong buffer used for receiving packets */
-static uint8_t pingpong_buf[2 * TRACE_ENDPOINT_SIZE];
+/* Circular DMA buffer the UART receives into, and how far into it we have consumed */
+static uint8_t trace_dma_buf[2U * TRACE_ENDPOINT_SIZE];
+static uint16_t trace_dma_read_pos;
+static bool capturing = false;
 /* SWO decoding */
 static bool decoding = false;
 
-void trace_buf_drain(usbd_device *dev, uint8_t ep)
+/*
+ * Move everything the DMA has written since we last looked on to the host. This is run from the
+ * half and full transfer interrupts, and from systick so a trickle of data doesn't wait for the
+ * DMA to reach a half buffer boundary.
+ */
+static uint16_t traceswo_dma_write_pos(void)
 {
-	static atomic_flag reentry_flag = ATOMIC_FLAG_INIT;
+	return (sizeof(trace_dma_buf) - dma_get_number_of_data(SWO_DMA_BUS, SWO_DMA_CHAN)) % sizeof(trace_dma_buf);
+}
 
-	/* If we are already in this routine then we don't need to come in again */
-	if (atomic_flag_test_and_set_explicit(&reentry_flag, memory_order_relaxed))
-		return;
-	/* Attempt to write everything we buffered */
-	if (write_index != read_index) {
-		uint16_t result;
+static void traceswo_harvest(void)
+{
+	const uint16_t write_pos = traceswo_dma_write_pos();
+	while (trace_dma_read_pos != write_pos) {
+		const uint16_t end = write_pos > trace_dma_read_pos ? write_pos : sizeof(trace_dma_buf);
+		const uint16_t length = end - trace_dma_read_pos;
 		if (decoding)
-			/* write decoded swo packets to the uart port */
-			result = traceswo_decode(
-				dev, CDCACM_UART_ENDPOINT, &trace_rx_buf[read_index * TRACE_ENDPOINT_SIZE], TRACE_ENDPOINT_SIZE);
+			traceswo_decode(usbdev, CDCACM_UART_ENDPOINT, trace_dma_buf + trace_dma_read_pos, length);
 		else
-			/* write raw swo packets to the trace port */
-			result =
-				usbd_ep_write_packet(dev, ep, &trace_rx_buf[read_index * TRACE_ENDPOINT_SIZE], TRACE_ENDPOINT_SIZE);
-		if (result)
-			read_index = (read_index + 1U) % NUM_TRACE_PACKETS;
+			traceswo_buffer_push(trace_dma_buf + trace_dma_read_pos, length);
+		trace_dma_read_pos = end % sizeof(trace_dma_buf);
+	}
+}
+
+void traceswo_tick(void)
+{
+	if (!capturing)
+		return;
+	if (traceswo_dma_write_pos() != trace_dma_read_pos) {
+		/*
+		 * Keep the DMA interrupt from harvesting underneath us, and as systick is below USB,
+		 * USB from draining underneath the harvest unless whatever we interrupted already has
+		 */
+		const bool usb_irq_enabled = nvic_get_irq_enabled(USB_IRQ);
+		nvic_disable_irq(USB_IRQ);
+		nvic_disable_irq(SWO_DMA_IRQ);
+		traceswo_harvest();
+		nvic_enable_irq(SWO_DMA_IRQ);
+		if (usb_irq_enabled)
+			nvic_enable_irq(USB_IRQ);
 	}
-	atomic_flag_clear_explicit(&reentry_flag, memory_order_relaxed);
+	traceswo_buffer_flush();
 }
 
 void traceswo_setspeed(uint32_t baudrate)
 {
+	capturing = false;
 	dma_disable_channel(SWO_DMA_BUS, SWO_DMA_CHAN);
 	usart_disable(SWO_UART);
 	usart_set_baudrate(SWO_UART, baudrate);
@@ -99,26 +117,22 @@ void traceswo_setspeed(uint32_t baudrate)
 
 	usart_enable(SWO_UART);
 	nvic_enable_irq(SWO_DMA_IRQ);
-	write_index = read_index = 0;
-	dma_set_memory_address(SWO_DMA_BUS, SWO_DMA_CHAN, (uint32_t)pingpong_buf);
-	dma_set_number_of_data(SWO_DMA_BUS, SWO_DMA_CHAN, 2 * TRACE_ENDPOINT_SIZE);
+	trace_dma_read_pos = 0;
+	traceswo_buffer_reset();
+	dma_set_memory_address(SWO_DMA_BUS, SWO_DMA_CHAN, (uint32_t)trace_dma_buf);
+	dma_set_number_of_data(SWO_DMA_BUS, SWO_DMA_CHAN, sizeof(trace_dma_buf));
 	dma_enable_channel(SWO_DMA_BUS, SWO_DMA_CHAN);
 	usart_enable_rx_dma(SWO_UART);
+	capturing = true;
 }
 
 void SWO_DMA_ISR(void)
 {
-	if (DMA_ISR(SWO_DMA_BUS) & DMA_ISR_HTIF(SWO_DMA_CHAN)) {
+	if (DMA_ISR(SWO_DMA_BUS) & DMA_ISR_HTIF(SWO_DMA_CHAN))
 		DMA_IFCR(SWO_DMA_BUS) |= DMA_ISR_HTIF(SWO_DMA_CHAN);
-		memcpy(&trace_rx_buf[write_index * TRACE_ENDPOINT_SIZE], pingpong_buf, TRACE_ENDPOINT_SIZE);
-	}
-	if (DMA_ISR(SWO_DMA_BUS) & DMA_ISR_TCIF(SWO_DMA_CHAN)) {
+	if (DMA_ISR(SWO_DMA_BUS) & DMA_ISR_TCIF(SWO_DMA_CHAN))
 		DMA_IFCR(SWO_DMA_BUS) |= DMA_ISR_TCIF(SWO_DMA_CHAN);
-		memcpy(
-			&trace_rx_buf[write_index * TRACE_ENDPOINT_SIZE], &pingpong_buf[TRACE_ENDPOINT_SIZE], TRACE_ENDPOINT_SIZE);
-	}
-	write_index = (write_index + 1U) % NUM_TRACE_PACKETS;
-	trace_buf_drain(usbdev, TRACE_ENDPOINT | USB_REQ_TYPE_IN);
+	traceswo_harvest();
 }
 
 void traceswo_init(uint32_t baudrate, uint32_t swo_chan_bitmask)
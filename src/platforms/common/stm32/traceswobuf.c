@@ -0,0 +1,131 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * This file implements the buffer between SWO capture and the USB trace endpoint.
+ *
+ * Capture interrupts push raw trace data into a ring which is drained to the host
+ * a full endpoint sized packet at a time, both when more data arrives and each time
+ * the endpoint completes a transfer. Once the capture goes quiet, the systick handler
+ * sends whatever partial packet is left. Should the host fall far enough behind that
+ * the ring fills, new data is dropped and counted in traceswo_stats.
+ */
+
+#include "general.h"
+#include "platform.h"
+#include "usb.h"
+#include "traceswo.h"
+
+#include <libopencm3/cm3/nvic.h>
+
+#if defined(NUM_TRACE_PACKETS)
+#define TRACESWO_BUFFER_SIZE (NUM_TRACE_PACKETS * TRACE_ENDPOINT_SIZE)
+#elif !defined(TRACESWO_BUFFER_SIZE)
+#define TRACESWO_BUFFER_SIZE 2048U
+#endif
+
+static uint8_t trace_buf[TRACESWO_BUFFER_SIZE];
+/* The head is only moved by the capture side, the tail only by the drain */
+static volatile uint16_t trace_buf_head;
+static volatile uint16_t trace_buf_tail;
+/* Tail position seen by the previous systick, to tell when data has been left waiting */
+static uint16_t trace_buf_tick_tail;
+/*
+ * The drain can be entered from USB, the capture interrupt and systick. The capture interrupt is set
+ * above USB on every platform, and systick masks USB while it drains, so each only ever pre-empts the
+ * others rather than being pre-empted by them, and a plain flag is enough to keep them from interleaving.
+ */
+static volatile bool trace_buf_draining;
+
+static uint16_t trace_buf_used(void)
+{
+	return (trace_buf_head + TRACESWO_BUFFER_SIZE - trace_buf_tail) % TRACESWO_BUFFER_SIZE;
+}
+
+static void trace_buf_send(usbd_device *const dev, const uint8_t ep, const bool allow_partial)
+{
+	if (trace_buf_draining)
+		return;
+	trace_buf_draining = true;
+	const uint16_t tail = trace_buf_tail;
+	const uint16_t used = trace_buf_used();
+	if (used >= TRACE_ENDPOINT_SIZE || (allow_partial && used)) {
+		uint8_t packet[TRACE_ENDPOINT_SIZE];
+		const uint16_t length = MIN(used, TRACE_ENDPOINT_SIZE);
+		const uint16_t first = MIN(length, TRACESWO_BUFFER_SIZE - tail);
+		memcpy(packet, trace_buf + tail, first);
+		memcpy(packet + first, trace_buf, length - first);
+		const uint16_t written = usbd_ep_write_packet(dev, ep, packet, length);
+		trace_buf_tail = (tail + written) % TRACESWO_BUFFER_SIZE;
+	}
+	trace_buf_draining = false;
+}
+
+void traceswo_buffer_push(const uint8_t *const data, const uint16_t length)
+{
+	const uint16_t space = TRACESWO_BUFFER_SIZE - 1U - trace_buf_used();
+	const uint16_t count = MIN(length, space);
+	const uint16_t head = trace_buf_head;
+	const uint16_t first = MIN(count, TRACESWO_BUFFER_SIZE - head);
+	memcpy(trace_buf + head, data, first);
+	memcpy(trace_buf, data + first, count - first);
+	trace_buf_head = (head + count) % TRACESWO_BUFFER_SIZE;
+	traceswo_stats.capture_dropped += length - count;
+	trace_buf_send(usbdev, TRACE_ENDPOINT | USB_REQ_TYPE_IN, false);
+}
+
+void trace_buf_drain(usbd_device *dev, uint8_t ep)
+{
+	trace_buf_send(dev, ep, false);
+}
+
+void traceswo_buffer_flush(void)
+{
+	/* Only send a partial packet once data has been left waiting for a whole tick */
+	const uint16_t tail = trace_buf_tail;
+	if (tail == trace_buf_tick_tail && tail != trace_buf_head && usb_get_config()) {
+		/* Systick is below USB, so keep USB out while we send unless whatever we interrupted already has */
+		const bool usb_irq_enabled = nvic_get_irq_enabled(USB_IRQ);
+		nvic_disable_irq(USB_IRQ);
+		trace_buf_send(usbdev, TRACE_ENDPOINT | USB_REQ_TYPE_IN, true);
+		if (usb_irq_enabled)
+			nvic_enable_irq(USB_IRQ);
+	}
+	trace_buf_tick_tail = trace_buf_tail;
+}
+
+void traceswo_buffer_reset(void)
+{
+	trace_buf_tail = trace_buf_head;
+	trace_buf_tick_tail = trace_buf_tail;
+}
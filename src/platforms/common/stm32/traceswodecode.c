@@ -16,60 +16,129 @@
  * along with this program.	 If not, see <http://www.gnu.org/licenses/>.
  */
 
-/* Print decoded swo stream on the usb serial */
+/*
+ * Decode the ITM/DWT packet stream carried on SWO and print the selected
+ * stimulus port channels on the usb serial.
+ *
+ * ARM DDI 0403E - ARMv7-M Architecture Reference Manual, Appendix D4 (Debug ITM and DWT Packet Protocol)
+ */
 
 #include "general.h"
 #include "usb_serial.h"
 #include "traceswo.h"
+#include "itm_decoder.h"
+
+/*
+ * Decoded data is queued in a ring and handed to the aux serial endpoint a packet at a time.
+ * While the host keeps up, packets go out as soon as they are decoded; once it falls behind, the
+ * ring fills and each completion sends a full packet. If the ring overflows, the data is dropped
+ * and accounted for in traceswo_stats rather than stalling the capture.
+ */
+#ifndef TRACESWO_DECODE_BUFFER_SIZE
+#define TRACESWO_DECODE_BUFFER_SIZE 1024U
+#endif
+
+traceswo_stats_s traceswo_stats;
+
+static void traceswo_source_packet(itm_decoder_s *decoder);
+static void traceswo_protocol_packet(itm_decoder_s *decoder);
 
-/* SWO decoding */
-/* data is static in case swo packet is astride two buffers */
-static uint8_t swo_buf[CDCACM_PACKET_SIZE];
-static int swo_buf_len = 0;
+/* Decoder state is static as packets can straddle capture buffers */
 static uint32_t swo_decode = 0; /* bitmask of channels to print */
-static int swo_pkt_len = 0;     /* decoder state */
-static bool swo_print = false;
+static itm_decoder_s swo_decoder = {
+	.source_packet = traceswo_source_packet,
+	.protocol_packet = traceswo_protocol_packet,
+};
 
-/* print decoded swo packet on usb serial */
+/* Decoded output - the head is only moved by the decoder, the tail only by the drain */
+static uint8_t swo_ring[TRACESWO_DECODE_BUFFER_SIZE];
+static volatile uint16_t swo_ring_head;
+static volatile uint16_t swo_ring_tail;
+/*
+ * The decoder runs from the capture interrupt, which every platform sets above USB so it pre-empts USB
+ * but is never pre-empted by it, or from systick with USB masked. A plain flag is then enough to stop
+ * it draining underneath a drain in progress from USB.
+ */
+static volatile bool swo_draining;
+
+static void traceswo_queue(const uint8_t *const data, const uint8_t length)
+{
+	for (uint8_t i = 0; i < length; ++i) {
+		const uint16_t next = (swo_ring_head + 1U) % TRACESWO_DECODE_BUFFER_SIZE;
+		if (next == swo_ring_tail) {
+			traceswo_stats.decode_dropped += length - i;
+			return;
+		}
+		swo_ring[swo_ring_head] = data[i];
+		swo_ring_head = next;
+	}
+}
+
+static void traceswo_source_packet(itm_decoder_s *const decoder)
+{
+	/* DWT hardware packets (exception trace, PC samples, data trace) have no place on the serial port */
+	if (decoder->header & ITM_SOURCE_HARDWARE) {
+		++traceswo_stats.hardware_packets;
+		return;
+	}
+	if (swo_decode & (1UL << ITM_SOURCE_ADDRESS(decoder->header)))
+		traceswo_queue(decoder->payload, decoder->payload_length);
+}
+
+static void traceswo_protocol_packet(itm_decoder_s *const decoder)
+{
+	/* Timestamp and extension payloads only matter for the statistics */
+	if (!(decoder->header & ITM_TIMESTAMP_MASK) || decoder->header == ITM_GLOBAL_TIMESTAMP_1 ||
+		decoder->header == ITM_GLOBAL_TIMESTAMP_2)
+		++traceswo_stats.timestamps;
+}
+
+/* Queue decoded swo packets for the usb serial */
 uint16_t traceswo_decode(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len)
 {
 	if (usbd_dev == NULL)
 		return 0;
-	const uint8_t *const data = (const uint8_t *)buf;
-	for (uint16_t i = 0; i < len; i++) {
-		const uint8_t ch = data[i];
-		if (swo_pkt_len == 0) {                    /* header */
-			uint32_t channel = (uint32_t)ch >> 3U; /* channel number */
-			uint32_t size = ch & 0x7U;             /* drop channel number */
-			if (size == 0x01U)
-				swo_pkt_len = 1; /* SWO packet 0x01XX */
-			else if (size == 0x02U)
-				swo_pkt_len = 2; /* SWO packet 0x02XXXX */
-			else if (size == 0x03U)
-				swo_pkt_len = 4; /* SWO packet 0x03XXXXXXXX */
-			swo_print = (swo_pkt_len != 0) && ((swo_decode & (1UL << channel)) != 0UL);
-		} else if (swo_pkt_len <= 4) { /* data */
-			if (swo_print) {
-				swo_buf[swo_buf_len++] = ch;
-				if (swo_buf_len == sizeof(swo_buf)) {
-					if (usb_get_config() && gdb_serial_get_dtr()) /* silently drop if usb not ready */
-						usbd_ep_write_packet(usbd_dev, addr, swo_buf, swo_buf_len);
-					swo_buf_len = 0;
-				}
-			}
-			--swo_pkt_len;
-		} else { /* recover */
-			swo_buf_len = 0;
-			swo_pkt_len = 0;
+	itm_decode(&swo_decoder, (const uint8_t *)buf, len);
+	traceswo_stats.syncs = swo_decoder.syncs;
+	traceswo_stats.overflows = swo_decoder.overflows;
+	traceswo_stats.errors = swo_decoder.errors;
+	traceswo_decode_drain(usbd_dev, addr);
+	return len;
+}
+
+bool traceswo_decode_drain(usbd_device *const dev, const uint8_t ep)
+{
+	if (swo_draining)
+		return false;
+	swo_draining = true;
+	const uint16_t head = swo_ring_head;
+	const uint16_t tail = swo_ring_tail;
+	bool queued = false;
+	if (head != tail) {
+		if (!usb_get_config() || !gdb_serial_get_dtr()) {
+			/* Nobody is listening, throw the data away */
+			traceswo_stats.decode_dropped += (head + TRACESWO_DECODE_BUFFER_SIZE - tail) % TRACESWO_DECODE_BUFFER_SIZE;
+			swo_ring_tail = head;
+		} else {
+			uint8_t packet[CDCACM_PACKET_SIZE];
+			uint16_t length = 0;
+			for (uint16_t index = tail; index != head && length < CDCACM_PACKET_SIZE;
+				 index = (index + 1U) % TRACESWO_DECODE_BUFFER_SIZE)
+				packet[length++] = swo_ring[index];
+			const uint16_t written = usbd_ep_write_packet(dev, ep, packet, length);
+			swo_ring_tail = (tail + written) % TRACESWO_DECODE_BUFFER_SIZE;
+			queued = written != 0U;
 		}
 	}
-	return len;
+	swo_draining = false;
+	return queued;
 }
 
 /* set bitmask of swo channels to be decoded */
 void traceswo_setmask(uint32_t mask)
 {
 	swo_decode = mask;
+	itm_decoder_reset(&swo_decoder);
+	swo_ring_tail = swo_ring_head;
+	memset(&traceswo_stats, 0, sizeof(traceswo_stats));
 }
-
-/* not truncated */
@@ -26,6 +26,7 @@
 #include "general.h"
 #include "gdb_if.h"
 #include "usb_serial.h"
+#include "stats.h"
 
 #include <libopencm3/usb/usbd.h>
 
@@ -46,6 +47,7 @@ void gdb_if_putchar(char c, int flush)
 		}
 		while (usbd_ep_write_packet(usbdev, CDCACM_GDB_ENDPOINT, buffer_in, count_in) <= 0)
 			continue;
+		stats_increment(STATS_USB_TX_PACKETS);
 		count_in = 0;
 	}
 }
@@ -57,6 +59,8 @@ void gdb_usb_out_cb(usbd_device *dev, uint8_t ep)
 
 	usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 1);
 	uint32_t count = usbd_ep_read_packet(dev, CDCACM_GDB_ENDPOINT, buf, CDCACM_PACKET_SIZE);
+	if (count)
+		stats_increment(STATS_USB_RX_PACKETS);
 
 	for (uint32_t idx = 0; idx < count; ++idx)
 		buffer_out[head_out++ % sizeof(buffer_out)] = buf[idx];
@@ -31,12 +31,34 @@ void traceswo_init(uint32_t baudrate, uint32_t swo_chan_bitmask);
 void traceswo_init(uint32_t swo_chan_bitmask);
 #endif
 
+typedef struct traceswo_stats {
+	uint32_t syncs;            /* ITM synchronisation packets seen */
+	uint32_t overflows;        /* ITM overflow packets - the target lost trace data */
+	uint32_t timestamps;       /* Local and global timestamp packets */
+	uint32_t hardware_packets; /* DWT hardware source packets */
+	uint32_t errors;           /* Reserved or otherwise undecodable headers */
+	uint32_t decode_dropped;   /* Decoded bytes lost because the usb serial fell behind */
+	uint32_t capture_dropped;  /* Raw bytes lost because the trace endpoint fell behind */
+} traceswo_stats_s;
+
+extern traceswo_stats_s traceswo_stats;
+
+/* Endpoint callback sending the next full packet of buffered trace data */
 void trace_buf_drain(usbd_device *dev, uint8_t ep);
+/* Queue captured trace data for the trace endpoint, called from the capture interrupt */
+void traceswo_buffer_push(const uint8_t *data, uint16_t length);
+/* Send any partial packet left waiting since the last call */
+void traceswo_buffer_flush(void);
+void traceswo_buffer_reset(void);
+/* Periodic housekeeping for the capture path, called from the systick handler */
+void traceswo_tick(void);
 
 /* Set bitmask of SWO channels to be decoded */
 void traceswo_setmask(uint32_t mask);
 
 /* Print decoded SWO packet on USB serial */
 uint16_t traceswo_decode(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len);
+/* Send the next packet of decoded SWO data, returns true if one was queued on the endpoint */
+bool traceswo_decode_drain(usbd_device *dev, uint8_t ep);
 
 #endif /* PLATFORMS_COMMON_TRACESWO_H */
@@ -87,8 +87,8 @@ static bool debug_serial_send_complete = true;
 void initialise_monitor_handles(void);
 
 static char debug_serial_debug_buffer[AUX_UART_BUFFER_SIZE];
-static uint8_t debug_serial_debug_write_index;
-static uint8_t debug_serial_debug_read_index;
+static uint16_t debug_serial_debug_write_index;
+static uint16_t debug_serial_debug_read_index;
 #endif
 
 static usbd_request_return_codes_e gdb_serial_control_request(usbd_device *dev, usb_setup_data_s *req, uint8_t **buf,
@@ -183,12 +183,13 @@ void usb_serial_set_config(usbd_device *dev, uint16_t value)
 	usb_config = value;
 
 	/* GDB interface */
-#if defined(STM32F4) || defined(LM4F) || defined(STM32F7)
 	usbd_ep_setup(dev, CDCACM_GDB_ENDPOINT, USB_ENDPOINT_ATTR_BULK, CDCACM_PACKET_SIZE, gdb_usb_out_cb);
+#if defined(LM4F)
+	usbd_ep_setup(dev, CDCACM_GDB_ENDPOINT | USB_REQ_TYPE_IN, USB_ENDPOINT_ATTR_BULK, CDCACM_PACKET_SIZE, NULL);
 #else
-	usbd_ep_setup(dev, CDCACM_GDB_ENDPOINT, USB_ENDPOINT_ATTR_BULK, CDCACM_PACKET_SIZE, NULL);
+	usbd_ep_setup(
+		dev, CDCACM_GDB_ENDPOINT | USB_REQ_TYPE_IN, USB_ENDPOINT_ATTR_BULK, CDCACM_PACKET_SIZE, gdb_usb_in_cb);
 #endif
-	usbd_ep_setup(dev, CDCACM_GDB_ENDPOINT | USB_REQ_TYPE_IN, USB_ENDPOINT_ATTR_BULK, CDCACM_PACKET_SIZE, NULL);
 	usbd_ep_setup(dev, (CDCACM_GDB_ENDPOINT + 1U) | USB_REQ_TYPE_IN, USB_ENDPOINT_ATTR_INTERRUPT, 16, NULL);
 
 	/* Serial interface */
@@ -303,6 +304,11 @@ void debug_serial_run(void)
 
 static void debug_serial_send_callback(usbd_device *dev, uint8_t ep)
 {
+#ifdef PLATFORM_HAS_TRACESWO
+	/* Decoded SWO data shares this endpoint - let it go first while it has anything queued */
+	if (traceswo_decode_drain(dev, ep))
+		return;
+#endif
 	(void)ep;
 	(void)dev;
 #if defined(STM32F0) || defined(STM32F1) || defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
@@ -334,7 +340,7 @@ static void debug_serial_receive_callback(usbd_device *dev, uint8_t ep)
 
 #if defined(STM32F0) || defined(STM32F1) || defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
 	/* Disable USBUART TX packet reception if buffer does not have enough space */
-	if (AUX_UART_BUFFER_SIZE - aux_serial_transmit_buffer_fullness() < CDCACM_PACKET_SIZE)
+	if (AUX_UART_TX_BUFFER_SIZE - aux_serial_transmit_buffer_fullness() < CDCACM_PACKET_SIZE)
 		usbd_ep_nak_set(dev, ep, 1);
 #endif
 }
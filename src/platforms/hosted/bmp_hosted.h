@@ -100,6 +100,8 @@ void libusb_exit_function(bmp_info_s *info);
 bool device_is_bmp_gdb_port(const char *device);
 #else
 int bmda_usb_transfer(usb_link_s *link, const void *tx_buffer, size_t tx_len, void *rx_buffer, size_t rx_len);
+bool bmda_usb_transfer_submit(usb_link_s *link, bool receive, void *buffer, size_t len, transfer_ctx_s *ctx);
+bool bmda_usb_transfer_wait(usb_link_s *link, transfer_ctx_s *ctx);
 #endif
 
 #endif /* PLATFORMS_HOSTED_BMP_HOSTED_H */
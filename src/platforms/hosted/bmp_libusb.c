@@ -38,6 +38,7 @@
 #include "probe_info.h"
 #include "utils.h"
 #include "hex_utils.h"
+#include "stats.h"
 
 #define NO_SERIAL_NUMBER "<no serial number>"
 
@@ -520,6 +521,7 @@ int bmda_usb_transfer(usb_link_s *link, const void *tx_buffer, size_t tx_len, vo
 				libusb_clear_halt(link->device_handle, link->ep_tx | LIBUSB_ENDPOINT_OUT);
 			return result;
 		}
+		stats_increment(STATS_USB_TX_TRANSFERS);
 	}
 	/* If there's data to receive */
 	if (rx_len) {
@@ -537,6 +539,7 @@ int bmda_usb_transfer(usb_link_s *link, const void *tx_buffer, size_t tx_len, vo
 			return result;
 		}
 
+		stats_increment(STATS_USB_RX_TRANSFERS);
 		/* Display the response */
 		DEBUG_WIRE("response:");
 		for (size_t i = 0; i < (size_t)rx_bytes && i < 32U; ++i)
@@ -548,3 +551,55 @@ int bmda_usb_transfer(usb_link_s *link, const void *tx_buffer, size_t tx_len, vo
 	}
 	return LIBUSB_SUCCESS;
 }
+
+static void LIBUSB_CALL bmda_usb_transfer_callback(struct libusb_transfer *const transfer)
+{
+	transfer_ctx_s *const ctx = (transfer_ctx_s *)transfer->user_data;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		DEBUG_ERROR("%s: Transfer on endpoint %02x failed (%d)\n", __func__, transfer->endpoint, transfer->status);
+		ctx->flags |= TRANSFER_HAS_ERROR;
+	}
+	ctx->flags |= TRANSFER_IS_DONE;
+}
+
+/*
+ * Submit a bulk transfer without waiting for it to complete, allowing several transfers to be kept in flight.
+ * The transfer context and buffer must remain valid until bmda_usb_transfer_wait() reports completion.
+ */
+bool bmda_usb_transfer_submit(
+	usb_link_s *const link, const bool receive, void *const buffer, const size_t len, transfer_ctx_s *const ctx)
+{
+	struct libusb_transfer *const transfer = libusb_alloc_transfer(0);
+	if (!transfer) {
+		DEBUG_ERROR("%s: Failed to allocate transfer\n", __func__);
+		return false;
+	}
+	const uint8_t endpoint = receive ? link->ep_rx | LIBUSB_ENDPOINT_IN : link->ep_tx | LIBUSB_ENDPOINT_OUT;
+	libusb_fill_bulk_transfer(
+		transfer, link->device_handle, endpoint, (uint8_t *)buffer, (int)len, bmda_usb_transfer_callback, ctx, 1000U);
+	/* Have libusb release the transfer for us once the callback completes */
+	transfer->flags = LIBUSB_TRANSFER_FREE_TRANSFER;
+	ctx->flags = 0U;
+	const int result = libusb_submit_transfer(transfer);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("%s: Submitting transfer failed (%d): %s\n", __func__, result, libusb_error_name(result));
+		libusb_free_transfer(transfer);
+		return false;
+	}
+	/* A bulk transfer may span many packets, so these are accounted for as whole transfers */
+	stats_increment(receive ? STATS_USB_RX_TRANSFERS : STATS_USB_TX_TRANSFERS);
+	return true;
+}
+
+/* Wait for a transfer started with bmda_usb_transfer_submit() to complete, returning whether it succeeded */
+bool bmda_usb_transfer_wait(usb_link_s *const link, transfer_ctx_s *const ctx)
+{
+	while (!(ctx->flags & TRANSFER_IS_DONE)) {
+		const int result = libusb_handle_events(link->context);
+		if (result != LIBUSB_SUCCESS && result != LIBUSB_ERROR_INTERRUPTED) {
+			DEBUG_ERROR("%s: Handling events failed (%d): %s\n", __func__, result, libusb_error_name(result));
+			return false;
+		}
+	}
+	return !(ctx->flags & TRANSFER_HAS_ERROR);
+}
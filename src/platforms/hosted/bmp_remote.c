@@ -194,6 +194,14 @@ void remote_target_clk_output_enable(const bool enable)
 		DEBUG_WARN("Please update probe firmware to enable high impedance clock feature\n");
 }
 
+bool remote_traceswo_init(const uint32_t baudrate)
+{
+	if (remote_funcs.traceswo_init)
+		return remote_funcs.traceswo_init(baudrate);
+	DEBUG_WARN("Please update probe firmware to enable SWO capture from BMDA\n");
+	return false;
+}
+
 bool remote_jtag_init(void)
 {
 	return remote_funcs.jtag_init();
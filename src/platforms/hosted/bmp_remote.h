@@ -40,6 +40,7 @@ typedef struct bmp_remote_protocol {
 	uint32_t (*get_comms_frequency)(void);
 	bool (*set_comms_frequency)(uint32_t freq);
 	void (*target_clk_output_enable)(bool enable);
+	bool (*traceswo_init)(uint32_t baudrate);
 } bmp_remote_protocol_s;
 
 extern bmp_remote_protocol_s remote_funcs;
@@ -58,6 +59,7 @@ bool remote_nrst_get_val(void);
 void remote_max_frequency_set(uint32_t freq);
 uint32_t remote_max_frequency_get(void);
 void remote_target_clk_output_enable(bool enable);
+bool remote_traceswo_init(uint32_t baudrate);
 
 void remote_adiv5_dp_init(adiv5_debug_port_s *dp);
 void remote_add_jtag_dev(uint32_t dev_index, const jtag_dev_s *jtag_dev);
@@ -19,7 +19,7 @@
  */
 
 /* This file allows pc-hosted BMP platforms to erase or read/verify/flash a
- * binary file from the command line.
+ * binary, ELF, Intel HEX or S-record file from the command line.
  */
 
 #include "general.h"
@@ -29,12 +29,15 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <getopt.h>
+#include <pthread.h>
 #include "version.h"
 #include "target_internal.h"
 #include "cortexm.h"
 #include "command.h"
+#include "stats.h"
 
 #include "cli.h"
+#include "image.h"
 #include "bmp_hosted.h"
 
 #ifndef O_BINARY
@@ -130,7 +133,7 @@ static void cl_help(char **argv)
 	bmp_ident(NULL);
 	DEBUG_INFO("\n"
 			   "Usage: %s [-h | -l | [-v BITMASK] [-O] [-d PATH | -P NUMBER | -s SERIAL | -c TYPE]\n"
-			   "\t[-n NUMBER] [-j | -A] [-C] [-t | -T] [-e] [-p] [-R[h]] [-H] [-M STRING ...]\n"
+			   "\t[-n NUMBER] [-j | -A] [-C] [-t | -T] [-e] [-p] [-R[h]] [-H] [-D] [-M STRING ...]\n"
 			   "\t[-f | -m] [-E | -w | -V | -r] [-a ADDR] [-S number] [file]]\n"
 			   "\n"
 			   "The default is to start a debug server at localhost:2000\n\n"
@@ -151,7 +154,7 @@ static void cl_help(char **argv)
 			   "\t                   type (cable)\n"
 			   "\n"
 			   "General configuration options: [-n NUMBER] [-j] [-C] [-t | -T] [-e] [-p] [-R[h]]\n"
-			   "\t\t[-H] [-M STRING ...]\n"
+			   "\t\t[-H] [-D] [-M STRING ...]\n"
 			   "\t-n, --number     Select the target device at the given position in the\n"
 			   "\t                   scan chain (use the -t option to get a scan chain listing)\n"
 			   "\t-j, --jtag       Use JTAG instead of SWD\n"
@@ -169,6 +172,8 @@ static void cl_help(char **argv)
 			   "\t-R, --reset      Reset the device. If followed by 'h', this will be done using\n"
 			   "\t                   the hardware reset line instead of over the debug link\n"
 			   "\t-H, --high-level Do not use the high level command API (bmp-remote)\n"
+			   "\t-D, --stats      Print the debug link performance counters in a machine\n"
+			   "\t                   readable form to stdout after a Flash or monitor operation\n"
 			   "\t-M, --monitor    Run target-specific monitor commands. This option\n"
 			   "\t                   can be repeated for as many commands you wish to run.\n"
 			   "\t                   If the command contains spaces, use quotes around the\n"
@@ -180,18 +185,20 @@ static void cl_help(char **argv)
 			   "\n"
 			   "Flash operation selection options [-E | -w | -V | -r]:\n"
 			   "\t-E, --erase      Erase the target device Flash\n"
-			   "\t-w, --write      Write the specified binary file to the target device\n"
-			   "\t                   Flash (the default)\n"
+			   "\t-w, --write      Write the specified file to the target device Flash\n"
+			   "\t                   (the default), erasing only the blocks it covers\n"
 			   "\t-V, --verify     Verify the target device Flash against the specified\n"
-			   "\t                   binary file\n"
+			   "\t                   file\n"
 			   "\t-r, --read       Read the target device Flash\n"
 			   "\n"
 			   "Flash operation modifiers options: [-a ADDR] [-S number] [FILE]\n"
 			   "\t-a, --addr       Start address for the given Flash operation (defaults to\n"
-			   "\t                   the start of Flash)\n"
+			   "\t                   the start of Flash, ignored for ELF, HEX and S-record\n"
+			   "\t                   files as they carry their own addresses)\n"
 			   "\t-S, --byte-count Number of bytes to work on in the Flash operation (default\n"
 			   "\t                   is till the operation fails or is complete)\n"
-			   "\t<file>           Binary file to use in Flash operations\n",
+			   "\t<file>           Binary, ELF, Intel HEX or Motorola S-record file to use\n"
+			   "\t                   in Flash operations, detected from its contents\n",
 		argv[0]);
 	exit(0);
 }
@@ -216,6 +223,7 @@ static const getopt_option_s long_options[] = {
 	{"power", no_argument, NULL, 'p'},
 	{"reset", optional_argument, NULL, 'R'},
 	{"high-level", no_argument, NULL, 'H'},
+	{"stats", no_argument, NULL, 'D'},
 	{"monitor", required_argument, NULL, 'M'},
 	{"freq", required_argument, NULL, 'f'},
 	{"multi-drop", required_argument, NULL, 'm'},
@@ -237,7 +245,7 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 	opt->opt_scanmode = BMP_SCAN_SWD;
 	opt->opt_mode = BMP_MODE_DEBUG;
 	while (true) {
-		const int option = getopt_long(argc, argv, "eEFhHv:Od:f:s:I:c:Cln:m:M:wVtTa:S:jApP:rR::", long_options, NULL);
+		const int option = getopt_long(argc, argv, "eEFhHDv:Od:f:s:I:c:Cln:m:M:wVtTa:S:jApP:rR::", long_options, NULL);
 		if (option == -1)
 			break;
 
@@ -254,6 +262,9 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 			bmda_debug_flags |= BMD_DEBUG_INFO;
 			cl_help(argv);
 			break;
+		case 'D':
+			opt->opt_dump_stats = true;
+			break;
 		case 'H':
 			opt->opt_no_hl = true;
 			break;
@@ -435,6 +446,305 @@ uint32_t scan_for_targets(const bmda_cli_options_s *const opt)
 	return 0U;
 }
 
+/* Print the stats registry as key=value lines for consumption by scripts */
+static void cl_dump_stats(target_s *const target)
+{
+	for (size_t counter = 0; counter < STATS_COUNTERS; ++counter)
+		printf("%s=%" PRIu32 "\n", stats_counter_name(counter), stats_counters[counter]);
+	for (size_t histogram = 0; histogram < STATS_HISTOGRAMS; ++histogram) {
+		const uint32_t *const buckets = stats_histogram_buckets(histogram);
+		for (uint8_t bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; ++bucket) {
+			const uint32_t limit = stats_bucket_limit(bucket);
+			if (limit == UINT32_MAX)
+				printf("%s.le_inf=%" PRIu32 "\n", stats_histogram_name(histogram), buckets[bucket]);
+			else
+				printf("%s.le_%" PRIu32 "=%" PRIu32 "\n", stats_histogram_name(histogram), limit, buckets[bucket]);
+		}
+	}
+	for (target_flash_s *flash = target ? target->flash : NULL; flash; flash = flash->next) {
+		printf("flash_%08" PRIx32 ".erase_time=%" PRIu32 "\n", flash->start, flash->erase_time);
+		printf("flash_%08" PRIx32 ".write_time=%" PRIu32 "\n", flash->start, flash->write_time);
+	}
+	fflush(stdout);
+}
+
+/* Check that every byte of a segment lands in one or other of the target's Flash regions */
+static bool cl_segment_in_flash(target_s *const t, const image_segment_s *const segment)
+{
+	const target_addr_t end = segment->addr + segment->length;
+	for (target_addr_t addr = segment->addr; addr < end;) {
+		const target_flash_s *const flash = target_flash_for_addr(t, addr);
+		if (!flash)
+			return false;
+		addr = MIN(end, flash->start + flash->length);
+	}
+	return true;
+}
+
+/*
+ * ELF files often carry PT_LOAD segments that only ever live in RAM (such as code run from SRAM with
+ * no Flash copy), so skip any that are not in Flash rather than refusing to program the image at all
+ */
+static void cl_drop_non_flash_segments(target_s *const t, image_s *const image)
+{
+	size_t kept = 0U;
+	for (size_t idx = 0; idx < image->segment_count; ++idx) {
+		const image_segment_s *const segment = &image->segments[idx];
+		if (!cl_segment_in_flash(t, segment)) {
+			DEBUG_WARN("Skipping %zu bytes at 0x%08" PRIx32 " as they are not in Flash\n", segment->length,
+				segment->addr);
+			continue;
+		}
+		image->segments[kept++] = *segment;
+	}
+	image->segment_count = kept;
+}
+
+/*
+ * Erase just the Flash blocks that the image's segments touch. The segments are in address order,
+ * so blocks shared by neighbouring segments are merged into one run and only ever erased once.
+ */
+static bool cl_flash_erase_image(target_s *const t, const image_s *const image)
+{
+	target_addr_t erase_begin = 0U;
+	target_addr_t erase_end = 0U;
+	for (size_t idx = 0; idx < image->segment_count; ++idx) {
+		const image_segment_s *const segment = &image->segments[idx];
+		const target_addr_t end = segment->addr + segment->length;
+		for (target_addr_t addr = segment->addr; addr < end;) {
+			target_flash_s *const flash = target_flash_for_addr(t, addr);
+			if (!flash) {
+				DEBUG_ERROR("Image data at 0x%08" PRIx32 " is outside of Flash\n", addr);
+				return false;
+			}
+			const target_addr_t region_end = MIN(end, flash->start + flash->length);
+			const target_addr_t block_begin = addr & ~(flash->blocksize - 1U);
+			const target_addr_t block_end = ALIGN(region_end, flash->blocksize);
+			if (erase_end != erase_begin && block_begin <= erase_end)
+				erase_end = MAX(erase_end, block_end);
+			else {
+				if (erase_end != erase_begin && !target_flash_erase(t, erase_begin, erase_end - erase_begin))
+					return false;
+				erase_begin = block_begin;
+				erase_end = block_end;
+			}
+			addr = region_end;
+		}
+	}
+	return erase_end == erase_begin || target_flash_erase(t, erase_begin, erase_end - erase_begin);
+}
+
+/*
+ * Read back and verify run as a pipeline: a reader thread keeps the adaptor busy filling a small ring
+ * of chunks while the main thread writes each filled chunk out to disk or compares it against the image.
+ * Only the reader thread touches the target while the pipeline runs.
+ */
+#define CL_READ_CHUNKS      4U
+#define CL_READ_CHUNK_SIZE  0x4000U
+#define CL_READ_PROGRESS_MS 1000U
+
+typedef struct cl_read_chunk {
+	uint8_t *data;
+	const image_segment_s *segment;
+	target_addr_t addr;
+	size_t offset;
+	size_t length;
+	bool failed;
+} cl_read_chunk_s;
+
+typedef struct cl_read_pipeline {
+	target_s *target;
+	const bmda_cli_options_s *opt;
+	const image_s *image;
+	size_t chunk_size;
+	pthread_mutex_t lock;
+	pthread_cond_t filled;
+	pthread_cond_t drained;
+	cl_read_chunk_s chunks[CL_READ_CHUNKS];
+	/* Free running counts of the chunks filled by the reader and released by the consumer */
+	size_t produced;
+	size_t consumed;
+	bool finished;
+	bool cancelled;
+} cl_read_pipeline_s;
+
+/* Make each read a whole number of the adaptor's largest transfers, kept to whole words */
+static size_t cl_read_chunk_size(void)
+{
+	const size_t transfer = bmda_mem_transfer_size() & ~3U;
+	if (!transfer)
+		return CL_READ_CHUNK_SIZE;
+	return MAX(CL_READ_CHUNK_SIZE / transfer, 1U) * transfer;
+}
+
+/* Wait for a free chunk to read into, returning NULL if the consumer gave up */
+static cl_read_chunk_s *cl_read_claim(cl_read_pipeline_s *const pipeline)
+{
+	pthread_mutex_lock(&pipeline->lock);
+	while (!pipeline->cancelled && pipeline->produced - pipeline->consumed == CL_READ_CHUNKS)
+		pthread_cond_wait(&pipeline->drained, &pipeline->lock);
+	cl_read_chunk_s *const chunk = pipeline->cancelled ? NULL : &pipeline->chunks[pipeline->produced % CL_READ_CHUNKS];
+	pthread_mutex_unlock(&pipeline->lock);
+	return chunk;
+}
+
+static void cl_read_ranges(cl_read_pipeline_s *const pipeline)
+{
+	const bmda_cli_options_s *const opt = pipeline->opt;
+	/* Reads cover the requested range, verifies each of the image's segments */
+	const size_t ranges = opt->opt_mode == BMP_MODE_FLASH_READ ? 1U : pipeline->image->segment_count;
+	for (size_t range = 0; range < ranges; ++range) {
+		const image_segment_s *const segment =
+			opt->opt_mode == BMP_MODE_FLASH_READ ? NULL : &pipeline->image->segments[range];
+		const target_addr_t flash_src = segment ? segment->addr : opt->opt_flash_start;
+		const size_t size = segment ? segment->length : opt->opt_flash_size;
+		for (size_t offset = 0; offset < size; offset += pipeline->chunk_size) {
+			cl_read_chunk_s *const chunk = cl_read_claim(pipeline);
+			if (!chunk)
+				return;
+			chunk->segment = segment;
+			chunk->addr = flash_src + (target_addr_t)offset;
+			chunk->offset = offset;
+			chunk->length = MIN(size - offset, pipeline->chunk_size);
+			chunk->failed = target_mem_read(pipeline->target, chunk->data, chunk->addr, chunk->length) != 0;
+
+			pthread_mutex_lock(&pipeline->lock);
+			++pipeline->produced;
+			pthread_cond_signal(&pipeline->filled);
+			pthread_mutex_unlock(&pipeline->lock);
+			/* A failed read ends the run, the consumer decides whether that's an error */
+			if (chunk->failed)
+				return;
+		}
+	}
+}
+
+static void *cl_read_thread(void *const context)
+{
+	cl_read_pipeline_s *const pipeline = (cl_read_pipeline_s *)context;
+	cl_read_ranges(pipeline);
+	pthread_mutex_lock(&pipeline->lock);
+	pipeline->finished = true;
+	pthread_cond_signal(&pipeline->filled);
+	pthread_mutex_unlock(&pipeline->lock);
+	return NULL;
+}
+
+/* Write a filled chunk out to disk or compare it against the image */
+static bool cl_read_consume_chunk(const bmda_cli_options_s *const opt, const cl_read_chunk_s *const chunk,
+	const int read_file, size_t *const bytes_read)
+{
+	if (chunk->failed) {
+		if (chunk->segment) {
+			DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", chunk->addr);
+			return false;
+		}
+		if (opt->opt_flash_size == 0) /* we reached end of flash */
+			DEBUG_INFO("Reached end of flash at size %zu\n", chunk->offset);
+		else
+			DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", chunk->addr);
+		return true;
+	}
+	*bytes_read += chunk->length;
+	if (chunk->segment) {
+		if (memcmp(chunk->data, chunk->segment->data + chunk->offset, chunk->length) != 0) {
+			DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", chunk->addr);
+			return false;
+		}
+	} else if (read_file != -1) {
+		const ssize_t written = write(read_file, chunk->data, chunk->length);
+		if (written < 0) {
+			const int error = errno;
+			DEBUG_ERROR("Write to %s failed (%d): %s\n", opt->opt_flash_file, error, strerror(error));
+			return false;
+		}
+		if ((size_t)written < chunk->length) {
+			DEBUG_ERROR("Read failed at flash region 0x%08" PRIx32 "\n", chunk->addr);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool cl_read_consume(cl_read_pipeline_s *const pipeline, const int read_file, const size_t total,
+	const uint32_t start_time, size_t *const bytes_read)
+{
+	uint32_t last_report = start_time;
+	while (true) {
+		pthread_mutex_lock(&pipeline->lock);
+		while (!pipeline->finished && pipeline->produced == pipeline->consumed)
+			pthread_cond_wait(&pipeline->filled, &pipeline->lock);
+		const bool drained = pipeline->produced == pipeline->consumed;
+		pthread_mutex_unlock(&pipeline->lock);
+		if (drained)
+			return true;
+
+		/* The reader leaves this chunk alone until it is released below */
+		const cl_read_chunk_s *const chunk = &pipeline->chunks[pipeline->consumed % CL_READ_CHUNKS];
+		if (!cl_read_consume_chunk(pipeline->opt, chunk, read_file, bytes_read))
+			return false;
+
+		pthread_mutex_lock(&pipeline->lock);
+		++pipeline->consumed;
+		pthread_cond_signal(&pipeline->drained);
+		pthread_mutex_unlock(&pipeline->lock);
+
+		const uint32_t now = platform_time_ms();
+		if (now - last_report >= CL_READ_PROGRESS_MS) {
+			DEBUG_INFO("%zu of %zu bytes (%u%%), %8.3fkiB/s\n", *bytes_read, total,
+				(unsigned)(total ? (uint64_t)*bytes_read * 100U / total : 100U),
+				(double)*bytes_read / (now - start_time));
+			last_report = now;
+		}
+	}
+}
+
+static bool cl_read_verify(target_s *const t, const bmda_cli_options_s *const opt, const image_s *const image,
+	const int read_file, size_t *const bytes_read)
+{
+	cl_read_pipeline_s pipeline = {
+		.target = t,
+		.opt = opt,
+		.image = image,
+		.chunk_size = cl_read_chunk_size(),
+	};
+	const size_t total = opt->opt_mode == BMP_MODE_FLASH_READ ? opt->opt_flash_size : image_size(image);
+	DEBUG_INFO("Reading in chunks of %zu bytes\n", pipeline.chunk_size);
+
+	uint8_t *const buffer = malloc(pipeline.chunk_size * CL_READ_CHUNKS);
+	if (!buffer) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	for (size_t idx = 0; idx < CL_READ_CHUNKS; ++idx)
+		pipeline.chunks[idx].data = buffer + idx * pipeline.chunk_size;
+	pthread_mutex_init(&pipeline.lock, NULL);
+	pthread_cond_init(&pipeline.filled, NULL);
+	pthread_cond_init(&pipeline.drained, NULL);
+
+	const uint32_t start_time = platform_time_ms();
+	pthread_t reader;
+	const int error = pthread_create(&reader, NULL, cl_read_thread, &pipeline);
+	bool result = false;
+	if (error)
+		DEBUG_ERROR("Failed to start the read thread (%d): %s\n", error, strerror(error));
+	else {
+		result = cl_read_consume(&pipeline, read_file, total, start_time, bytes_read);
+		/* Stop the reader early if we bailed out */
+		pthread_mutex_lock(&pipeline.lock);
+		pipeline.cancelled = true;
+		pthread_cond_signal(&pipeline.drained);
+		pthread_mutex_unlock(&pipeline.lock);
+		pthread_join(reader, NULL);
+	}
+
+	pthread_cond_destroy(&pipeline.drained);
+	pthread_cond_destroy(&pipeline.filled);
+	pthread_mutex_destroy(&pipeline.lock);
+	free(buffer);
+	return result;
+}
+
 int cl_execute(bmda_cli_options_s *opt)
 {
 	if (opt->opt_mode == BMP_MODE_RESET_HW) {
@@ -539,6 +849,7 @@ int cl_execute(bmda_cli_options_s *opt)
 		goto target_detach;
 
 	mmap_data_s map = {};
+	image_s image = {};
 	if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_VERIFY ||
 		opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
 		if (!bmp_mmap(opt->opt_flash_file, &map)) {
@@ -546,6 +857,18 @@ int cl_execute(bmda_cli_options_s *opt)
 			res = -1;
 			goto target_detach;
 		}
+		if (!image_load(&image, map.data, map.size, opt->opt_flash_start)) {
+			DEBUG_ERROR("Can not load image from %s. Aborting!\n", opt->opt_flash_file);
+			res = -1;
+			goto free_map;
+		}
+		/* Restrict binaries to the size given on the command line, the other formats say where their data goes */
+		if (image.format == IMAGE_FORMAT_BINARY && image.segment_count && opt->opt_flash_size < map.size)
+			image.segments[0].length = opt->opt_flash_size;
+		else if (image.format == IMAGE_FORMAT_ELF)
+			cl_drop_non_flash_segments(t, &image);
+		DEBUG_INFO("Loaded %s image with %zu bytes in %zu segments\n", image_format_name(image.format),
+			image_size(&image), image.segment_count);
 	} else if (opt->opt_mode == BMP_MODE_FLASH_READ) {
 		/* Open as binary */
 		read_file = open(opt->opt_flash_file, O_TRUNC | O_CREAT | O_RDWR | O_BINARY, S_IRUSR | S_IWUSR);
@@ -555,9 +878,6 @@ int cl_execute(bmda_cli_options_s *opt)
 			goto target_detach;
 		}
 	}
-	if (opt->opt_flash_size < map.size)
-		/* restrict to size given on command line */
-		map.size = opt->opt_flash_size;
 	if (opt->opt_monitor) {
 		res = command_process(t, opt->opt_monitor);
 		if (res)
@@ -574,24 +894,29 @@ int cl_execute(bmda_cli_options_s *opt)
 		}
 		target_reset(t);
 	} else if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-		DEBUG_INFO("Erasing %zu bytes at 0x%08" PRIx32 "\n", map.size, opt->opt_flash_start);
+		const size_t size = image_size(&image);
+		DEBUG_INFO("Erasing blocks covered by %zu segments\n", image.segment_count);
 		const uint32_t start_time = platform_time_ms();
-		if (!target_flash_erase(t, opt->opt_flash_start, map.size)) {
+		if (!cl_flash_erase_image(t, &image)) {
 			DEBUG_ERROR("Flash erase failed!\n");
 			res = -1;
 			goto free_map;
 		}
-		DEBUG_INFO("Flashing %zu bytes at 0x%08" PRIx32 "\n", map.size, opt->opt_flash_start);
-		/* Buffered write cares for padding*/
-		if (!target_flash_write(t, opt->opt_flash_start, map.data, map.size) || !target_flash_complete(t)) {
+		/* Buffered write cares for padding, and sees the segments in address order so pads each block once */
+		bool result = true;
+		for (size_t idx = 0; result && idx < image.segment_count; ++idx) {
+			const image_segment_s *const segment = &image.segments[idx];
+			DEBUG_INFO("Flashing %zu bytes at 0x%08" PRIx32 "\n", segment->length, segment->addr);
+			result = target_flash_write(t, segment->addr, segment->data, segment->length);
+		}
+		if (!result || !target_flash_complete(t)) {
 			DEBUG_ERROR("Flashing failed!\n");
 			res = -1;
 			goto free_map;
 		}
 		DEBUG_INFO("Success!\n");
 		const uint32_t end_time = platform_time_ms();
-		DEBUG_WARN(
-			"Flash Write succeeded for %zu bytes, %8.3fkiB/s\n", map.size, (double)map.size / (end_time - start_time));
+		DEBUG_WARN("Flash Write succeeded for %zu bytes, %8.3fkiB/s\n", size, (double)size / (end_time - start_time));
 		if (opt->opt_mode != BMP_MODE_FLASH_WRITE_VERIFY) {
 			target_reset(t);
 			goto free_map;
@@ -599,62 +924,34 @@ int cl_execute(bmda_cli_options_s *opt)
 	}
 	if (opt->opt_mode == BMP_MODE_FLASH_READ || opt->opt_mode == BMP_MODE_FLASH_VERIFY ||
 		opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-#define WORKSIZE 0x1000U
-		uint8_t data[WORKSIZE];
 		if (opt->opt_mode == BMP_MODE_FLASH_READ)
 			DEBUG_INFO("Reading flash from 0x%08" PRIx32 " for %zu bytes to %s\n", opt->opt_flash_start,
 				opt->opt_flash_size, opt->opt_flash_file);
-		const uint32_t flash_src = opt->opt_flash_start;
-		const size_t size = opt->opt_mode == BMP_MODE_FLASH_READ ? opt->opt_flash_size : map.size;
 		size_t bytes_read = 0;
-		uint8_t *flash = (uint8_t *)map.data;
 		const uint32_t start_time = platform_time_ms();
-		for (size_t offset = 0; offset < size; offset += WORKSIZE) {
-			const size_t worksize = MIN(size - offset, WORKSIZE);
-			int n_read = target_mem_read(t, data, flash_src + offset, worksize);
-			if (n_read) {
-				if (opt->opt_flash_size == 0) /* we reached end of flash */
-					DEBUG_INFO("Reached end of flash at size %" PRId32 "\n", flash_src - opt->opt_flash_start);
-				else
-					DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", flash_src);
-				break;
-			}
-			bytes_read += worksize;
-			if (opt->opt_mode == BMP_MODE_FLASH_VERIFY || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-				if (memcmp(data, flash + offset, worksize) != 0) {
-					DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", flash_src);
-					res = -1;
-					goto free_map;
-				}
-			} else if (read_file != -1) {
-				const ssize_t written = write(read_file, data, worksize);
-				if (written < 0) {
-					const int error = errno;
-					DEBUG_ERROR("Write to %s failed (%d): %s\n", opt->opt_flash_file, error, strerror(error));
-					res = -1;
-					goto free_map;
-				}
-				if ((size_t)written < worksize) {
-					DEBUG_ERROR("Read failed at flash region 0x%08" PRIx32 "\n", flash_src);
-					res = -1;
-					goto free_map;
-				}
-			}
+		if (!cl_read_verify(t, opt, &image, read_file, &bytes_read)) {
+			res = -1;
+			goto free_map;
 		}
 		const uint32_t end_time = platform_time_ms();
-		if (read_file != -1)
+		if (read_file != -1) {
 			close(read_file);
+			read_file = -1;
+		}
 		DEBUG_WARN("Read/Verify succeeded for %zu bytes, %8.3fkiB/s\n", bytes_read,
 			(double)bytes_read / (end_time - start_time));
 		if (opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY)
 			target_reset(t);
 	}
 free_map:
+	image_free(&image);
 	if (map.size)
 		bmp_munmap(&map);
 target_detach:
 	if (read_file != -1)
 		close(read_file);
+	if (opt->opt_dump_stats)
+		cl_dump_stats(t);
 	if (t)
 		target_detach(t);
 	target_list_free();
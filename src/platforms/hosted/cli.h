@@ -55,6 +55,7 @@ typedef struct bmda_cli_options {
 	bool external_resistor_swd;
 	bool fast_poll;
 	bool opt_no_hl;
+	bool opt_dump_stats;
 	char *opt_flash_file;
 	char *opt_device;
 	char *opt_serial;
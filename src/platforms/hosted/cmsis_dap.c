@@ -106,6 +106,8 @@ static uint8_t out_ep;
 static hid_device *handle = NULL;
 static uint8_t buffer[1024U];
 static size_t report_size = 64U + 1U; // TODO: read actual report size
+/* Largest packet the adaptor says it handles, defaulting to the Full Speed HID report */
+static size_t packet_size = 64U;
 bool dap_has_swd_sequence = false;
 
 dap_version_s dap_adaptor_version(dap_info_e version_kind);
@@ -264,6 +266,14 @@ bool dap_init(void)
 
 	DEBUG_INFO("Adaptor %s DAP SWD sequences\n", dap_has_swd_sequence ? "supports" : "does not support");
 
+	/* Find out how big a packet the adaptor can handle, keeping the default if it won't tell us */
+	uint8_t adaptor_packet_size[2];
+	packet_size = 64U;
+	if (dap_info(DAP_INFO_PACKET_SIZE, adaptor_packet_size, sizeof(adaptor_packet_size)) == 2U &&
+		read_le2(adaptor_packet_size, 0) > 4U)
+		packet_size = read_le2(adaptor_packet_size, 0);
+	DEBUG_INFO("Adaptor packet size is %zu bytes\n", packet_size);
+
 	dap_quirks = 0;
 	/* Handle multi-TAP JTAG on older ORBTrace gateware being broken */
 	if (strcmp(info.product, "Orbtrace") == 0 &&
@@ -330,6 +340,21 @@ void dap_nrst_set_val(bool assert)
 	dap_set_reset_state(assert);
 }
 
+/* A block read returns as many words as fit in a report after the 4 byte response header */
+size_t dap_mem_transfer_size(void)
+{
+	return ((report_size - 4U) >> 2U) << ALIGN_WORD;
+}
+
+/*
+ * A DAP_SWO_Data response carries as much trace as fits in a packet after its 4 byte header,
+ * bounded by the report size the transport here actually moves
+ */
+size_t dap_swo_data_size(void)
+{
+	return MIN(MIN(packet_size, report_size - 1U) - 4U, DAP_SWO_DATA_MAX);
+}
+
 void dap_dp_abort(adiv5_debug_port_s *const target_dp, const uint32_t abort)
 {
 	/* DP Write to Reg 0.*/
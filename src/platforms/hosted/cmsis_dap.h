@@ -33,5 +33,7 @@ void dap_jtag_dp_init(adiv5_debug_port_s *dp);
 uint32_t dap_max_frequency(uint32_t clock);
 void dap_swd_configure(uint8_t cfg);
 void dap_nrst_set_val(bool assert);
+size_t dap_mem_transfer_size(void);
+size_t dap_swo_data_size(void);
 
 #endif /* PLATFORMS_HOSTED_CMSIS_DAP_H */
@@ -436,3 +436,67 @@ void dap_write_single(
 	if (!perform_dap_transfer_recoverable(target_dp, requests, 4U, NULL, 0U))
 		DEBUG_ERROR("dap_write_single failed (fault = %u)\n", target_dp->fault);
 }
+
+static bool dap_swo_command(const dap_command_e command, const uint8_t value)
+{
+	const uint8_t request[2] = {command, value};
+	uint8_t result = DAP_RESPONSE_OK;
+	/* Execute it and check if it failed */
+	if (!dap_run_cmd(request, 2U, &result, 1U)) {
+		DEBUG_PROBE("%s failed for command %02x\n", __func__, command);
+		return false;
+	}
+	return result == DAP_RESPONSE_OK;
+}
+
+/*
+ * Configure the adaptor's SWO capture for the requested mode and line rate.
+ * Returns the baud rate the adaptor actually selected, or 0 on failure.
+ */
+uint32_t dap_swo_configure(const dap_swo_mode_e mode, const uint32_t baudrate)
+{
+	/* Make sure capture is stopped before reconfiguring anything */
+	dap_swo_control(false);
+	if (!dap_swo_command(DAP_SWO_MODE, mode))
+		return 0U;
+	if (mode == DAP_SWO_OFF)
+		return 0U;
+	if (!dap_swo_command(DAP_SWO_TRANSPORT, DAP_SWO_TRANSPORT_DATA))
+		return 0U;
+
+	uint8_t request[5] = {DAP_SWO_BAUDRATE};
+	write_le4(request, 1, baudrate);
+	uint8_t result[4] = {};
+	/* Execute it and check if it failed */
+	if (!dap_run_cmd(request, 5U, result, 4U)) {
+		DEBUG_PROBE("%s failed\n", __func__);
+		return 0U;
+	}
+	/* The adaptor answers with the closest rate it can do, or 0 if it can't do anything suitable */
+	return read_le4(result, 0);
+}
+
+bool dap_swo_control(const bool start)
+{
+	return dap_swo_command(DAP_SWO_CONTROL, start ? 1U : 0U);
+}
+
+/*
+ * Fetch up to length bytes of captured trace data from the adaptor, returning how many were read.
+ * The capture status byte is also returned so the caller can report overruns.
+ */
+size_t dap_swo_data(void *const data, const size_t length, uint8_t *const status)
+{
+	uint8_t request[3] = {DAP_SWO_DATA};
+	write_le2(request, 1, MIN(length, DAP_SWO_DATA_MAX));
+	uint8_t response[3U + DAP_SWO_DATA_MAX] = {};
+	/* Execute it and check if it failed */
+	if (!dap_run_cmd(request, 3U, response, sizeof(response))) {
+		DEBUG_PROBE("%s failed\n", __func__);
+		return 0U;
+	}
+	*status = response[0];
+	const size_t count = MIN(read_le2(response, 1), MIN(length, DAP_SWO_DATA_MAX));
+	memcpy(data, response + 3U, count);
+	return count;
+}
@@ -64,6 +64,19 @@ typedef enum dap_led_type {
 	DAP_LED_RUNNING = 1U,
 } dap_led_type_e;
 
+typedef enum dap_swo_mode {
+	DAP_SWO_OFF = 0U,
+	DAP_SWO_UART = 1U,
+	DAP_SWO_MANCHESTER = 2U,
+} dap_swo_mode_e;
+
+#define DAP_SWO_STATUS_ACTIVE         (1U << 0U)
+#define DAP_SWO_STATUS_STREAM_ERROR   (1U << 6U)
+#define DAP_SWO_STATUS_BUFFER_OVERRUN (1U << 7U)
+
+/* The most trace data a single DAP_SWO_Data response can carry in a 64 byte report, see dap_swo_data_size() */
+#define DAP_SWO_DATA_MAX 60U
+
 #define DAP_QUIRK_NO_JTAG_MUTLI_TAP (1U << 0U)
 
 extern uint8_t dap_caps;
@@ -92,6 +105,10 @@ void dap_write_single(adiv5_access_port_s *target_ap, uint32_t dest, const void
 bool dap_run_cmd(const void *request_data, size_t request_length, void *response_data, size_t response_length);
 bool dap_jtag_configure(void);
 
+uint32_t dap_swo_configure(dap_swo_mode_e mode, uint32_t baudrate);
+bool dap_swo_control(bool start);
+size_t dap_swo_data(void *data, size_t length, uint8_t *status);
+
 void dap_dp_abort(adiv5_debug_port_s *target_dp, uint32_t abort);
 uint32_t dap_dp_low_access(adiv5_debug_port_s *target_dp, uint8_t rnw, uint16_t addr, uint32_t value);
 uint32_t dap_dp_read_reg(adiv5_debug_port_s *target_dp, uint16_t addr);
@@ -53,6 +53,12 @@ typedef enum dap_command {
 	DAP_SWD_CONFIGURE = 0x13U,
 	DAP_JTAG_SEQUENCE = 0x14U,
 	DAP_JTAG_CONFIGURE = 0x15U,
+	DAP_SWO_TRANSPORT = 0x17U,
+	DAP_SWO_MODE = 0x18U,
+	DAP_SWO_BAUDRATE = 0x19U,
+	DAP_SWO_CONTROL = 0x1aU,
+	DAP_SWO_STATUS = 0x1bU,
+	DAP_SWO_DATA = 0x1cU,
 	DAP_SWD_SEQUENCE = 0x1dU,
 } dap_command_e;
 
@@ -79,6 +85,9 @@ typedef enum dap_info_status {
 	DAP_INFO_NO_STRING = 1U,
 } dap_info_status_e;
 
+/* Trace data is fetched with DAP_SWO_Data commands on the command pipe */
+#define DAP_SWO_TRANSPORT_DATA 1U
+
 #define DAP_SWD_OUT_SEQUENCE 0U
 #define DAP_SWD_IN_SEQUENCE  1U
 
@@ -41,6 +41,11 @@ typedef struct ftdi_transfer_control ftdi_transfer_control_s;
 static uint8_t outbuf[BUF_SIZE];
 static uint16_t bufptr = 0;
 
+/* Separate context for the UART channel SWO is routed to, used only by the trace capture thread */
+static ftdi_context_s *swo_ctx = NULL;
+/* Chunk size for SWO reads, large enough to keep up with a 12MBaud UART without many round trips */
+#define SWO_CHUNK_SIZE 16384U
+
 cable_desc_s active_cable;
 data_desc_s active_state;
 
@@ -164,6 +169,7 @@ const cable_desc_s cable_desc[] = {
 		.vendor = 0x0403U,
 		.product = 0x6010U,
 		.interface = INTERFACE_B,
+		.swo_interface = INTERFACE_A,
 		.init.data_low = PIN6 | PIN5,
 		.init.ddr_low = PIN6 | PIN5,
 		.init.data_high = PIN1 | PIN2,
@@ -857,3 +863,77 @@ uint32_t libftdi_max_frequency_get(void)
 		clock = 60U * 1000U * 1000U;
 	return clock / (2U * (divisor + 1U));
 }
+
+bool ftdi_swo_init(const uint32_t baudrate)
+{
+	if (active_cable.swo_interface == INTERFACE_ANY) {
+		DEBUG_ERROR("Adaptor %s does not have SWO routed to a UART\n", active_cable.name);
+		return false;
+	}
+	ftdi_swo_deinit();
+
+	ftdi_context_s *ctx = ftdi_new();
+	if (ctx == NULL) {
+		DEBUG_ERROR("ftdi_new: %s\n", ftdi_get_error_string(ctx));
+		return false;
+	}
+	int err = ftdi_set_interface(ctx, active_cable.swo_interface);
+	if (err != 0) {
+		DEBUG_ERROR("ftdi_set_interface: %d: %s\n", err, ftdi_get_error_string(ctx));
+		goto error_1;
+	}
+	err = ftdi_usb_open_desc(
+		ctx, active_cable.vendor, active_cable.product, active_cable.description, info.serial[0] ? info.serial : NULL);
+	if (err != 0) {
+		DEBUG_ERROR("unable to open ftdi SWO channel: %d (%s)\n", err, ftdi_get_error_string(ctx));
+		goto error_1;
+	}
+	err = ftdi_set_bitmode(ctx, 0, BITMODE_RESET);
+	if (err != 0) {
+		DEBUG_ERROR("ftdi_set_bitmode: %d: %s\n", err, ftdi_get_error_string(ctx));
+		goto error_2;
+	}
+	err = ftdi_set_line_property(ctx, BITS_8, STOP_BIT_1, NONE);
+	if (err != 0) {
+		DEBUG_ERROR("ftdi_set_line_property: %d: %s\n", err, ftdi_get_error_string(ctx));
+		goto error_2;
+	}
+	err = ftdi_set_baudrate(ctx, (int)baudrate);
+	if (err != 0) {
+		DEBUG_ERROR("ftdi_set_baudrate: %d: %s\n", err, ftdi_get_error_string(ctx));
+		goto error_2;
+	}
+	err = ftdi_read_data_set_chunksize(ctx, SWO_CHUNK_SIZE);
+	if (err != 0) {
+		DEBUG_ERROR("ftdi_read_data_set_chunksize: %d: %s\n", err, ftdi_get_error_string(ctx));
+		goto error_2;
+	}
+	if ((uint32_t)ctx->baudrate != baudrate)
+		DEBUG_WARN("Capturing SWO at %d baud\n", ctx->baudrate);
+	swo_ctx = ctx;
+	return true;
+
+error_2:
+	ftdi_usb_close(ctx);
+error_1:
+	ftdi_free(ctx);
+	return false;
+}
+
+void ftdi_swo_deinit(void)
+{
+	if (!swo_ctx)
+		return;
+	ftdi_usb_close(swo_ctx);
+	ftdi_free(swo_ctx);
+	swo_ctx = NULL;
+}
+
+/* Read whatever SWO data the UART has received, returning the amount read or a negative value on error */
+int ftdi_swo_read(void *const buffer, const size_t size)
+{
+	const int result = ftdi_read_data(swo_ctx, buffer, (int)size);
+	if (result < 0)
+		DEBUG_ERROR("ftdi_read_data: %d: %s\n", result, ftdi_get_error_string(swo_ctx));
+	return result;
+}
@@ -28,6 +28,7 @@
 
 #include "cli.h"
 #include "jtagtap.h"
+#include "adiv5.h"
 
 #include "bmp_hosted.h"
 
@@ -51,6 +52,8 @@ typedef struct cable_desc {
 	int vendor;
 	int product;
 	int interface;
+	/* Interface whose UART RXD has SWO routed to it, or INTERFACE_ANY if there is none */
+	int swo_interface;
 	/* Initial (C|D)(Bus|Ddr) values for additional pins.
 	 * MPSSE_CS|DI|DO|SK are initialized accordig to mode.*/
 	data_desc_s init;
@@ -128,6 +131,7 @@ bool ftdi_bmp_init(bmda_cli_options_s *cl_opts);
 bool ftdi_lookup_adapter_from_vid_pid(bmda_cli_options_s *cl_opts, const probe_info_s *probe);
 bool ftdi_lookup_adaptor_descriptor(bmda_cli_options_s *cl_opts, const probe_info_s *probe);
 bool ftdi_swd_init(void);
+void ftdi_swd_adiv5_dp_init(adiv5_debug_port_s *dp);
 bool ftdi_jtag_init(void);
 void ftdi_buffer_flush(void);
 size_t ftdi_buffer_write(const void *buffer, size_t size);
@@ -139,6 +143,9 @@ void ftdi_max_frequency_set(uint32_t freq);
 uint32_t libftdi_max_frequency_get(void);
 void libftdi_nrst_set_val(bool assert);
 bool ftdi_nrst_get_val(void);
+bool ftdi_swo_init(uint32_t baudrate);
+void ftdi_swo_deinit(void);
+int ftdi_swo_read(void *buffer, size_t size);
 
 #define MPSSE_SK 1
 #define PIN0     1
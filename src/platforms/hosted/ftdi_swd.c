@@ -32,6 +32,7 @@
 #include <ftdi.h>
 #include "ftdi_bmp.h"
 #include "buffer_utils.h"
+#include "adiv5.h"
 
 typedef enum swdio_status {
 	SWDIO_STATUS_DRIVE,
@@ -47,11 +48,35 @@ static bool direct_bb_swd;
 #define MPSSE_TMS_SHIFT (MPSSE_WRITE_TMS | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG)
 #define MPSSE_TDO_SHIFT (MPSSE_DO_WRITE | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG)
 
+/*
+ * Maximum number of data phases (DRW accesses) queued per batch, and the total queue depth
+ * which additionally covers the CTRL/STAT, SELECT, CSW, TAR and RDBUFF housekeeping accesses
+ */
+#define FTDI_SWD_QUEUE_DATA_MAX 256U
+#define FTDI_SWD_QUEUE_DEPTH    (FTDI_SWD_QUEUE_DATA_MAX + 6U)
+/* Number of response bytes returned by the MPSSE for a queued read and write access respectively */
+#define FTDI_SWD_READ_RESPONSE_LENGTH  5U
+#define FTDI_SWD_WRITE_RESPONSE_LENGTH 1U
+
+typedef struct ftdi_swd_transaction {
+	uint8_t request;
+	uint32_t value;
+} ftdi_swd_transaction_s;
+
+static ftdi_swd_transaction_s swd_queue[FTDI_SWD_QUEUE_DEPTH];
+static size_t swd_queue_length;
+static uint8_t swd_response[FTDI_SWD_QUEUE_DEPTH * FTDI_SWD_READ_RESPONSE_LENGTH];
+static size_t swd_response_pending;
+static size_t swd_response_collected;
+
 static bool ftdi_swd_seq_in_parity(uint32_t *res, size_t clock_cycles);
 static uint32_t ftdi_swd_seq_in(size_t clock_cycles);
 static void ftdi_swd_seq_out(uint32_t tms_states, size_t clock_cycles);
 static void ftdi_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles);
 
+static void ftdi_swd_mem_read(adiv5_access_port_s *ap, void *dest, uint32_t src, size_t len);
+static void ftdi_swd_mem_write(adiv5_access_port_s *ap, uint32_t dest, const void *src, size_t len, align_e align);
+
 bool ftdi_swd_possible(void)
 {
 	const bool swd_read = active_cable.mpsse_swd_read.set_data_low || active_cable.mpsse_swd_read.clr_data_low ||
@@ -126,6 +151,16 @@ bool ftdi_swd_init(void)
 	return true;
 }
 
+void ftdi_swd_adiv5_dp_init(adiv5_debug_port_s *const dp)
+{
+	/* The transaction queue relies on the MPSSE engine being able to shift SWDIO in and out directly */
+	if (!do_mpsse || info.is_jtag)
+		return;
+	DEBUG_INFO("Using queued MPSSE transactions for memory access\n");
+	dp->mem_read = ftdi_swd_mem_read;
+	dp->mem_write = ftdi_swd_mem_write;
+}
+
 static void ftdi_swd_turnaround_mpsse(const swdio_status_e dir)
 {
 	/* If the turnaround should set SWDIO to an input */
@@ -435,3 +470,138 @@ static void ftdi_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles)
 	else
 		ftdi_swd_seq_out_parity_raw(tms_states, parity, clock_cycles);
 }
+
+/*
+ * The following implements a transaction queue for the MPSSE backend. Rather than doing a full USB
+ * round trip per SWD access (as seq_in/seq_in_parity have to), the request, ACK and data phases of many
+ * accesses are built up in the MPSSE command buffer and the responses are only collected once the
+ * whole batch has been queued. The memory access logic on top of this is shared in adiv5.c.
+ */
+
+static size_t ftdi_swd_response_limit(void)
+{
+	/*
+	 * Bound how many response bytes may be outstanding on the adaptor before we have to collect them,
+	 * so the MPSSE never stalls on a full transmit buffer while we're still writing commands to it.
+	 * The Hi-Speed dual and quad parts have 4KiB per channel, everything else has much less.
+	 */
+	if (info.ftdi_ctx->type == TYPE_2232H || info.ftdi_ctx->type == TYPE_4232H)
+		return 2048U;
+	return 256U;
+}
+
+static void ftdi_swd_queue_reserve(const size_t response_length)
+{
+	/* If this access would overrun what the adaptor can buffer, pull in what's pending first */
+	if (swd_response_pending + response_length > ftdi_swd_response_limit()) {
+		ftdi_buffer_read(swd_response + swd_response_collected, swd_response_pending);
+		swd_response_collected += swd_response_pending;
+		swd_response_pending = 0U;
+	}
+	swd_response_pending += response_length;
+}
+
+static size_t ftdi_swd_queue_access(const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	assert(swd_queue_length < FTDI_SWD_QUEUE_DEPTH);
+	const uint8_t request = make_packet_request(rnw, addr);
+	swd_queue[swd_queue_length] = (ftdi_swd_transaction_s){request, value};
+	ftdi_swd_queue_reserve(rnw ? FTDI_SWD_READ_RESPONSE_LENGTH : FTDI_SWD_WRITE_RESPONSE_LENGTH);
+
+	/* Request phase followed by the turnaround to let the target drive the ACK */
+	ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+	ftdi_jtag_tdi_tdo_seq(NULL, false, &request, 8U);
+	ftdi_swd_turnaround(SWDIO_STATUS_FLOAT);
+	if (rnw) {
+		/* Clock in the 3 ACK bits, 32 data bits and the parity bit as 4 whole bytes and 4 residual bits */
+		const ftdi_mpsse_cmd_s data_bytes = {MPSSE_DO_READ | MPSSE_LSB, {3U, 0U}};
+		const ftdi_mpsse_cmd_bits_s data_bits = {MPSSE_DO_READ | MPSSE_LSB | MPSSE_BITMODE, 3U};
+		ftdi_buffer_write_val(data_bytes);
+		ftdi_buffer_write_val(data_bits);
+	} else {
+		/* Clock in the 3 ACK bits, then turn the bus around and write the data phase along with its parity */
+		const ftdi_mpsse_cmd_bits_s ack_bits = {MPSSE_DO_READ | MPSSE_LSB | MPSSE_BITMODE, 2U};
+		ftdi_buffer_write_val(ack_bits);
+		ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+		uint8_t data_in[5];
+		write_le4(data_in, 0, value);
+		data_in[4] = __builtin_parity(value) & 1U;
+		ftdi_jtag_tdi_tdo_seq(NULL, false, data_in, 33U);
+	}
+	return swd_queue_length++;
+}
+
+static void ftdi_swd_queue_discard(void)
+{
+	swd_queue_length = 0U;
+	swd_response_pending = 0U;
+	swd_response_collected = 0U;
+}
+
+/*
+ * Run the queued transactions, collecting and decoding all the responses.
+ * Read results are stored back into the value field of their queue entry.
+ * Returns true only if every access was ACKed OK and every read passed its parity check.
+ */
+static bool ftdi_swd_queue_run(void)
+{
+	/* Clock out the idle cycles the ADIv5 spec requires at the end of the batch */
+	const uint8_t idle = 0U;
+	ftdi_jtag_tdi_tdo_seq(NULL, false, &idle, 8U);
+	ftdi_buffer_read(swd_response + swd_response_collected, swd_response_pending);
+	DEBUG_PROBE("%s: %zu transactions\n", __func__, swd_queue_length);
+
+	bool result = true;
+	const uint8_t *response = swd_response;
+	for (size_t idx = 0; idx < swd_queue_length; ++idx) {
+		ftdi_swd_transaction_s *const transaction = &swd_queue[idx];
+		/* RnW is bit 2 of the request */
+		if (transaction->request & 0x04U) {
+			/* The residual 4 bits come back MSb aligned, so shift them down */
+			const uint64_t value = read_le4(response, 0) | ((uint64_t)(response[4] >> 4U) << 32U);
+			const uint8_t ack = value & 7U;
+			transaction->value = (uint32_t)(value >> 3U);
+			const bool parity = ((value >> 35U) & 1U) ^ (__builtin_parity(transaction->value) & 1U);
+			if (ack != SWDP_ACK_OK || parity) {
+				DEBUG_PROBE("%s: read %zu failed, ACK %u%s\n", __func__, idx, ack, parity ? ", parity error" : "");
+				result = false;
+				break;
+			}
+			response += FTDI_SWD_READ_RESPONSE_LENGTH;
+		} else {
+			const uint8_t ack = response[0] >> 5U;
+			if (ack != SWDP_ACK_OK) {
+				DEBUG_PROBE("%s: write %zu failed, ACK %u\n", __func__, idx, ack);
+				result = false;
+				break;
+			}
+			response += FTDI_SWD_WRITE_RESPONSE_LENGTH;
+		}
+	}
+	ftdi_swd_queue_discard();
+	return result;
+}
+
+/* Running the queue only resets its length, so the decoded results remain available afterwards */
+static uint32_t ftdi_swd_queue_read_value(const size_t idx)
+{
+	return swd_queue[idx].value;
+}
+
+static const adiv5_swd_queue_s ftdi_swd_queue = {
+	.data_max = FTDI_SWD_QUEUE_DATA_MAX,
+	.access = ftdi_swd_queue_access,
+	.run = ftdi_swd_queue_run,
+	.read_value = ftdi_swd_queue_read_value,
+};
+
+static void ftdi_swd_mem_read(adiv5_access_port_s *const ap, void *const dest, const uint32_t src, const size_t len)
+{
+	adiv5_swd_queue_mem_read(&ftdi_swd_queue, ap, dest, src, len);
+}
+
+static void ftdi_swd_mem_write(
+	adiv5_access_port_s *const ap, const uint32_t dest, const void *const src, const size_t len, const align_e align)
+{
+	adiv5_swd_queue_mem_write(&ftdi_swd_queue, ap, dest, src, len, align);
+}
@@ -308,10 +308,12 @@ char gdb_if_getchar(void)
 	return value;
 }
 
-char gdb_if_getchar_to(uint32_t timeout)
+bool gdb_if_wait(const uint32_t timeout)
 {
-	if (gdb_if_conn == INVALID_SOCKET)
-		return -1;
+	if (gdb_if_conn == INVALID_SOCKET) {
+		platform_delay(timeout);
+		return false;
+	}
 
 #ifndef __CYGWIN__
 	timeval_s select_timeout;
@@ -325,7 +327,14 @@ char gdb_if_getchar_to(uint32_t timeout)
 	FD_ZERO(&fds);
 	FD_SET(gdb_if_conn, &fds);
 
-	if (select(FD_SETSIZE, &fds, NULL, NULL, &select_timeout) > 0)
+	return select(FD_SETSIZE, &fds, NULL, NULL, &select_timeout) > 0;
+}
+
+char gdb_if_getchar_to(uint32_t timeout)
+{
+	if (gdb_if_conn == INVALID_SOCKET)
+		return -1;
+	if (gdb_if_wait(timeout))
 		return gdb_if_getchar();
 	return -1;
 }
@@ -0,0 +1,407 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements loading of Flash images for the BMDA command line: ELF files (by their PT_LOAD
+ * segments' physical addresses), Intel HEX, Motorola S-records and raw binaries. Images are turned into a
+ * sorted list of non-overlapping segments so only the parts of Flash that the image really covers are
+ * erased and written, however sparse the image is.
+ */
+
+#include "general.h"
+#include "image.h"
+
+#include <ctype.h>
+
+#define ELF_IDENT_SIZE    16U
+#define ELF_CLASS         4U
+#define ELF_DATA          5U
+#define ELF_CLASS_32      1U
+#define ELF_DATA_LSB      1U
+#define ELF_DATA_MSB      2U
+#define ELF32_HEADER_SIZE 52U
+#define ELF32_PHDR_SIZE   32U
+#define ELF_PT_LOAD       1U
+
+#define IHEX_DATA                  0x00U
+#define IHEX_END_OF_FILE           0x01U
+#define IHEX_EXTENDED_SEGMENT_ADDR 0x02U
+#define IHEX_START_SEGMENT_ADDR    0x03U
+#define IHEX_EXTENDED_LINEAR_ADDR  0x04U
+#define IHEX_START_LINEAR_ADDR     0x05U
+
+/* The longest record either text format can carry is 255 bytes plus its address, type and checksum */
+#define RECORD_MAX_BYTES 261U
+
+typedef struct image_text {
+	const char *data;
+	size_t size;
+	size_t offset;
+	size_t line;
+} image_text_s;
+
+const char *image_format_name(const image_format_e format)
+{
+	switch (format) {
+	case IMAGE_FORMAT_ELF:
+		return "ELF";
+	case IMAGE_FORMAT_IHEX:
+		return "Intel HEX";
+	case IMAGE_FORMAT_SREC:
+		return "Motorola S-record";
+	default:
+		return "binary";
+	}
+}
+
+static bool image_add_segment(image_s *const image, const uint32_t addr, const uint8_t *const data, const size_t length)
+{
+	if (!length)
+		return true;
+	if ((uint64_t)addr + length > UINT32_MAX + 1ULL) {
+		DEBUG_ERROR("Image data at 0x%08" PRIx32 " runs past the end of the address space\n", addr);
+		return false;
+	}
+	/* Records for consecutive addresses are decoded into consecutive storage, so can just be extended */
+	if (image->segment_count) {
+		image_segment_s *const last = &image->segments[image->segment_count - 1U];
+		if (last->addr + last->length == addr && last->data + last->length == data) {
+			last->length += length;
+			return true;
+		}
+	}
+	image_segment_s *const segments = realloc(image->segments, (image->segment_count + 1U) * sizeof(*segments));
+	if (!segments) { /* realloc failed: heap exhaustion */
+		DEBUG_ERROR("realloc: failed in %s\n", __func__);
+		return false;
+	}
+	image->segments = segments;
+	image->segments[image->segment_count++] = (image_segment_s){.addr = addr, .length = length, .data = data};
+	return true;
+}
+
+static int image_segment_compare(const void *const lhs, const void *const rhs)
+{
+	const image_segment_s *const a = (const image_segment_s *)lhs;
+	const image_segment_s *const b = (const image_segment_s *)rhs;
+	if (a->addr == b->addr)
+		return 0;
+	return a->addr < b->addr ? -1 : 1;
+}
+
+/* Put the segments in address order, which buffered Flash writes rely on, and reject overlapping data */
+static bool image_sort_segments(image_s *const image)
+{
+	if (image->segment_count > 1U)
+		qsort(image->segments, image->segment_count, sizeof(*image->segments), image_segment_compare);
+	for (size_t idx = 1U; idx < image->segment_count; ++idx) {
+		const image_segment_s *const prev = &image->segments[idx - 1U];
+		if ((uint64_t)prev->addr + prev->length > image->segments[idx].addr) {
+			DEBUG_ERROR("Image segments at 0x%08" PRIx32 " and 0x%08" PRIx32 " overlap\n", prev->addr,
+				image->segments[idx].addr);
+			return false;
+		}
+	}
+	return true;
+}
+
+static uint32_t image_elf_read(const uint8_t *const data, const size_t width, const bool big_endian)
+{
+	uint32_t value = 0U;
+	for (size_t idx = 0; idx < width; ++idx)
+		value |= (uint32_t)data[big_endian ? width - 1U - idx : idx] << (idx * 8U);
+	return value;
+}
+
+static bool image_load_elf(image_s *const image, const uint8_t *const data, const size_t size)
+{
+	if (size < ELF32_HEADER_SIZE || data[ELF_CLASS] != ELF_CLASS_32 ||
+		(data[ELF_DATA] != ELF_DATA_LSB && data[ELF_DATA] != ELF_DATA_MSB)) {
+		DEBUG_ERROR("Only 32-bit ELF files are supported\n");
+		return false;
+	}
+	const bool big_endian = data[ELF_DATA] == ELF_DATA_MSB;
+	const uint32_t phdr_offset = image_elf_read(data + 28U, 4U, big_endian);
+	const uint16_t phdr_size = image_elf_read(data + 42U, 2U, big_endian);
+	const uint16_t phdr_count = image_elf_read(data + 44U, 2U, big_endian);
+	if (phdr_size < ELF32_PHDR_SIZE || phdr_offset > size || (size - phdr_offset) / phdr_size < phdr_count) {
+		DEBUG_ERROR("ELF program header table is truncated\n");
+		return false;
+	}
+
+	for (uint16_t idx = 0; idx < phdr_count; ++idx) {
+		const uint8_t *const phdr = data + phdr_offset + (size_t)idx * phdr_size;
+		if (image_elf_read(phdr, 4U, big_endian) != ELF_PT_LOAD)
+			continue;
+		const uint32_t offset = image_elf_read(phdr + 4U, 4U, big_endian);
+		/* Segments are placed by their load (physical) address, so initialised data lands in Flash */
+		const uint32_t addr = image_elf_read(phdr + 12U, 4U, big_endian);
+		const uint32_t file_size = image_elf_read(phdr + 16U, 4U, big_endian);
+		if (offset > size || size - offset < file_size) {
+			DEBUG_ERROR("ELF segment %u is truncated\n", idx);
+			return false;
+		}
+		if (!image_add_segment(image, addr, data + offset, file_size))
+			return false;
+	}
+	return true;
+}
+
+/* Read the next line of a text image, skipping blank lines, and returning its length without the line ending */
+static const char *image_text_line(image_text_s *const text, size_t *const length)
+{
+	while (text->offset < text->size) {
+		const char *const line = text->data + text->offset;
+		size_t line_length = 0;
+		while (text->offset + line_length < text->size && line[line_length] != '\n')
+			++line_length;
+		text->offset += line_length + 1U;
+		++text->line;
+		while (line_length && isspace((unsigned char)line[line_length - 1U]))
+			--line_length;
+		if (line_length) {
+			*length = line_length;
+			return line;
+		}
+	}
+	return NULL;
+}
+
+static int image_hex_nibble(const char digit)
+{
+	if (digit >= '0' && digit <= '9')
+		return digit - '0';
+	if (digit >= 'a' && digit <= 'f')
+		return digit - 'a' + 10;
+	if (digit >= 'A' && digit <= 'F')
+		return digit - 'A' + 10;
+	return -1;
+}
+
+/* Decode the hex digits of a record into bytes, returning how many there were or 0 on malformed input */
+static size_t image_hex_decode(const char *const digits, const size_t length, uint8_t *const bytes)
+{
+	if (!length || length & 1U || length / 2U > RECORD_MAX_BYTES)
+		return 0;
+	for (size_t idx = 0; idx < length; idx += 2U) {
+		const int high = image_hex_nibble(digits[idx]);
+		const int low = image_hex_nibble(digits[idx + 1U]);
+		if (high < 0 || low < 0)
+			return 0;
+		bytes[idx / 2U] = (uint8_t)((high << 4U) | low);
+	}
+	return length / 2U;
+}
+
+/* Intel HEX records are ':' <length> <address:2> <type> <data> <checksum>, summing to 0 */
+static bool image_ihex_record(const char *const line, const size_t length, uint8_t *const record)
+{
+	if (line[0] != ':')
+		return false;
+	const size_t count = image_hex_decode(line + 1U, length - 1U, record);
+	if (count < 5U || count != record[0] + 5U)
+		return false;
+	uint8_t checksum = 0U;
+	for (size_t idx = 0; idx < count; ++idx)
+		checksum += record[idx];
+	return checksum == 0U;
+}
+
+static bool image_load_ihex(image_s *const image, image_text_s *const text)
+{
+	uint32_t base = 0U;
+	size_t stored = 0U;
+	size_t length = 0U;
+	for (const char *line = image_text_line(text, &length); line; line = image_text_line(text, &length)) {
+		uint8_t record[RECORD_MAX_BYTES];
+		if (!image_ihex_record(line, length, record)) {
+			DEBUG_ERROR("Malformed Intel HEX record on line %zu\n", text->line);
+			return false;
+		}
+		const uint8_t data_length = record[0];
+		const uint16_t offset = (record[1] << 8U) | record[2];
+		const uint8_t *const payload = record + 4U;
+		switch (record[3]) {
+		case IHEX_DATA:
+			memcpy(image->storage + stored, payload, data_length);
+			if (!image_add_segment(image, base + offset, image->storage + stored, data_length))
+				return false;
+			stored += data_length;
+			break;
+		case IHEX_END_OF_FILE:
+			return true;
+		case IHEX_EXTENDED_SEGMENT_ADDR:
+		case IHEX_EXTENDED_LINEAR_ADDR:
+			if (data_length != 2U) {
+				DEBUG_ERROR("Malformed Intel HEX address record on line %zu\n", text->line);
+				return false;
+			}
+			if (record[3] == IHEX_EXTENDED_SEGMENT_ADDR)
+				base = (uint32_t)((payload[0] << 8U) | payload[1]) << 4U;
+			else
+				base = (uint32_t)((payload[0] << 8U) | payload[1]) << 16U;
+			break;
+		case IHEX_START_SEGMENT_ADDR:
+		case IHEX_START_LINEAR_ADDR:
+			break;
+		default:
+			DEBUG_ERROR("Unknown Intel HEX record type %02x on line %zu\n", record[3], text->line);
+			return false;
+		}
+	}
+	DEBUG_WARN("Intel HEX file has no end of file record\n");
+	return true;
+}
+
+/*
+ * S-records are 'S' <type> <count> <address:2-4> <data> <checksum>, the count covering everything after
+ * itself and the checksum being the ones complement of the sum of those bytes. Returns the address width.
+ */
+static size_t image_srec_record(const char *const line, const size_t length, uint8_t *const record)
+{
+	if (length < 4U || line[0] != 'S')
+		return 0;
+	const size_t count = image_hex_decode(line + 2U, length - 2U, record);
+	if (count < 2U || count != record[0] + 1U)
+		return 0;
+	uint8_t checksum = 0U;
+	for (size_t idx = 0; idx < count - 1U; ++idx)
+		checksum += record[idx];
+	checksum = ~checksum;
+	if (checksum != record[count - 1U])
+		return 0;
+
+	switch (line[1]) {
+	case '0':
+	case '1':
+	case '5':
+	case '9':
+		return 2U;
+	case '2':
+	case '6':
+	case '8':
+		return 3U;
+	case '3':
+	case '7':
+		return 4U;
+	default:
+		return 0;
+	}
+}
+
+static bool image_load_srec(image_s *const image, image_text_s *const text)
+{
+	size_t stored = 0U;
+	size_t length = 0U;
+	for (const char *line = image_text_line(text, &length); line; line = image_text_line(text, &length)) {
+		uint8_t record[RECORD_MAX_BYTES];
+		const size_t addr_width = image_srec_record(line, length, record);
+		if (!addr_width || record[0] < addr_width + 1U) {
+			DEBUG_ERROR("Malformed S-record on line %zu\n", text->line);
+			return false;
+		}
+		/* Only S1, S2 and S3 carry data, the rest are headers, counts and start addresses */
+		if (line[1] < '1' || line[1] > '3')
+			continue;
+		const uint32_t addr = image_elf_read(record + 1U, addr_width, true);
+		const size_t data_length = record[0] - addr_width - 1U;
+		memcpy(image->storage + stored, record + 1U + addr_width, data_length);
+		if (!image_add_segment(image, addr, image->storage + stored, data_length))
+			return false;
+		stored += data_length;
+	}
+	return true;
+}
+
+/* Work out what format the image is in, insisting on a valid first record for the text formats */
+static image_format_e image_detect_format(const uint8_t *const data, const size_t size)
+{
+	if (size >= ELF_IDENT_SIZE && memcmp(data, "\x7f" "ELF", 4U) == 0)
+		return IMAGE_FORMAT_ELF;
+	image_text_s text = {.data = (const char *)data, .size = size};
+	size_t length = 0U;
+	const char *const line = image_text_line(&text, &length);
+	uint8_t record[RECORD_MAX_BYTES];
+	if (line && image_ihex_record(line, length, record))
+		return IMAGE_FORMAT_IHEX;
+	if (line && image_srec_record(line, length, record))
+		return IMAGE_FORMAT_SREC;
+	return IMAGE_FORMAT_BINARY;
+}
+
+bool image_load(image_s *const image, const void *const data, const size_t size, const uint32_t base_addr)
+{
+	memset(image, 0, sizeof(*image));
+	image->format = image_detect_format((const uint8_t *)data, size);
+
+	bool result = false;
+	if (image->format == IMAGE_FORMAT_BINARY)
+		result = image_add_segment(image, base_addr, (const uint8_t *)data, size);
+	else if (image->format == IMAGE_FORMAT_ELF)
+		result = image_load_elf(image, (const uint8_t *)data, size);
+	else {
+		/* Every data byte takes at least two characters in either text format */
+		image->storage = malloc(size / 2U + 1U);
+		if (!image->storage) { /* malloc failed: heap exhaustion */
+			DEBUG_ERROR("malloc: failed in %s\n", __func__);
+			return false;
+		}
+		image_text_s text = {.data = (const char *)data, .size = size};
+		if (image->format == IMAGE_FORMAT_IHEX)
+			result = image_load_ihex(image, &text);
+		else
+			result = image_load_srec(image, &text);
+	}
+
+	if (result)
+		result = image_sort_segments(image);
+	if (!result)
+		image_free(image);
+	return result;
+}
+
+void image_free(image_s *const image)
+{
+	free(image->segments);
+	free(image->storage);
+	image->segments = NULL;
+	image->storage = NULL;
+	image->segment_count = 0U;
+}
+
+size_t image_size(const image_s *const image)
+{
+	size_t size = 0U;
+	for (size_t idx = 0; idx < image->segment_count; ++idx)
+		size += image->segments[idx].length;
+	return size;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_IMAGE_H
+#define PLATFORMS_HOSTED_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef enum image_format {
+	IMAGE_FORMAT_BINARY,
+	IMAGE_FORMAT_ELF,
+	IMAGE_FORMAT_IHEX,
+	IMAGE_FORMAT_SREC,
+} image_format_e;
+
+/* A contiguous run of bytes to be placed at addr, sorted by address and never overlapping another */
+typedef struct image_segment {
+	uint32_t addr;
+	size_t length;
+	const uint8_t *data;
+} image_segment_s;
+
+typedef struct image {
+	image_format_e format;
+	image_segment_s *segments;
+	size_t segment_count;
+	/* Backing store for the decoded data of the text formats, the others point into the file itself */
+	uint8_t *storage;
+} image_s;
+
+bool image_load(image_s *image, const void *data, size_t size, uint32_t base_addr);
+void image_free(image_s *image);
+size_t image_size(const image_s *image);
+const char *image_format_name(image_format_e format);
+
+#endif /* PLATFORMS_HOSTED_IMAGE_H */
@@ -109,11 +109,14 @@ bool jlink_transfer(const uint16_t clock_cycles, const uint8_t *const tms, const
 	/* Copy in the TDI values to transmit (if present) */
 	if (tdi)
 		memcpy(buffer + 4U + byte_count, tdi, byte_count);
-	/* Send the resulting transaction and try to read back the response data */
-	if (bmda_usb_transfer(info.usb_link, buffer, sizeof(jlink_io_transact_s) + (byte_count * 2U), buffer, byte_count) <
-			0 ||
-		/* Try to read back the transaction return code */
-		bmda_usb_transfer(info.usb_link, NULL, 0, buffer + byte_count, 1U) < 0)
+	/*
+	 * Send the resulting transaction and try to read back the response data along with the return code.
+	 * The adaptor may send the return code in its own packet, in which case we have to go back for it.
+	 */
+	const int received = bmda_usb_transfer(
+		info.usb_link, buffer, sizeof(jlink_io_transact_s) + (byte_count * 2U), buffer, byte_count + 1U);
+	if (received < 0 || (size_t)received < byte_count ||
+		((size_t)received == byte_count && bmda_usb_transfer(info.usb_link, NULL, 0, buffer + byte_count, 1U) < 0))
 		return false;
 	/* Copy out the response into the TDO buffer (if present) */
 	if (tdo)
@@ -26,11 +26,13 @@
 
 bool jlink_init(void);
 bool jlink_swd_init(adiv5_debug_port_s *dp);
+void jlink_adiv5_dp_init(adiv5_debug_port_s *dp);
 bool jlink_jtag_init(void);
 const char *jlink_target_voltage(void);
 void jlink_nrst_set_val(bool assert);
 bool jlink_nrst_get_val(void);
 void jlink_max_frequency_set(uint32_t freq);
 uint32_t jlink_max_frequency_get(void);
+size_t jlink_mem_transfer_size(void);
 
 #endif /* PLATFORMS_HOSTED_JLINK_H */
@@ -83,6 +83,36 @@ static uint32_t jlink_adiv5_raw_read_no_check(uint16_t addr);
 static uint32_t jlink_adiv5_clear_error(adiv5_debug_port_s *dp, bool protocol_recovery);
 static uint32_t jlink_adiv5_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t request_value);
 
+static void jlink_adiv5_mem_read(adiv5_access_port_s *ap, void *dest, uint32_t src, size_t len);
+static void jlink_adiv5_mem_write(adiv5_access_port_s *ap, uint32_t dest, const void *src, size_t len, align_e align);
+
+/*
+ * Size of the direction, data and response buffers used for batched transactions. This matches the
+ * limit jlink_transfer() imposes on a single JLINK_CMD_IO_TRANSACT, giving us 4096 clock cycles per batch.
+ */
+#define JLINK_SWD_BATCH_BUFFER_SIZE 512U
+/*
+ * Maximum number of data phases (DRW accesses) per batch, and the total batch depth which additionally
+ * covers the CTRL/STAT, SELECT, CSW, TAR and RDBUFF housekeeping accesses. A read costs 46 clock cycles
+ * and a write 54, so this keeps a full batch comfortably inside the buffers above.
+ */
+#define JLINK_SWD_BATCH_DATA_MAX 64U
+#define JLINK_SWD_BATCH_DEPTH    (JLINK_SWD_BATCH_DATA_MAX + 6U)
+
+typedef struct jlink_swd_transaction {
+	uint8_t request;
+	/* Offset of the ACK phase for this transaction in the response bit stream */
+	uint16_t ack_offset;
+	uint32_t value;
+} jlink_swd_transaction_s;
+
+static jlink_swd_transaction_s swd_batch[JLINK_SWD_BATCH_DEPTH];
+static size_t swd_batch_length;
+static uint8_t swd_batch_dir[JLINK_SWD_BATCH_BUFFER_SIZE];
+static uint8_t swd_batch_data[JLINK_SWD_BATCH_BUFFER_SIZE];
+static uint8_t swd_batch_response[JLINK_SWD_BATCH_BUFFER_SIZE];
+static uint16_t swd_batch_cycles;
+
 bool jlink_swd_init(adiv5_debug_port_s *dp)
 {
 	DEBUG_PROBE("-> jlink_swd_init(%u)\n", dp->dev_index);
@@ -110,6 +140,15 @@ bool jlink_swd_init(adiv5_debug_port_s *dp)
 	return true;
 }
 
+void jlink_adiv5_dp_init(adiv5_debug_port_s *const dp)
+{
+	/* Batched memory accesses are only implemented for SWD */
+	if (info.is_jtag)
+		return;
+	dp->mem_read = jlink_adiv5_mem_read;
+	dp->mem_write = jlink_adiv5_mem_write;
+}
+
 static void jlink_swd_seq_out(const uint32_t tms_states, const size_t clock_cycles)
 {
 	DEBUG_PROBE("%s %zu clock_cycles: %08" PRIx32 "\n", __func__, clock_cycles, tms_states);
@@ -394,3 +433,130 @@ static uint32_t jlink_adiv5_raw_access(
 	DEBUG_PROBE("%s: addr %04x <- %08" PRIx32 "\n", __func__, addr, request_value);
 	return result_value;
 }
+
+/*
+ * The following implements a transaction builder which packs the request, ACK and data phases of many
+ * SWD accesses into a single JLINK_CMD_IO_TRANSACT, decoding all the ACKs once the transfer completes.
+ * The memory access logic on top of this is shared in adiv5.c.
+ */
+
+static void jlink_swd_batch_reset(void)
+{
+	swd_batch_length = 0U;
+	swd_batch_cycles = 0U;
+	memset(swd_batch_dir, 0, sizeof(swd_batch_dir));
+	memset(swd_batch_data, 0, sizeof(swd_batch_data));
+}
+
+static void jlink_swd_batch_append(const uint32_t data, const size_t clock_cycles, const jlink_swd_dir_e direction)
+{
+	assert(swd_batch_cycles + clock_cycles <= JLINK_SWD_BATCH_BUFFER_SIZE * 8U);
+	for (size_t bit = 0; bit < clock_cycles; ++bit, ++swd_batch_cycles) {
+		const size_t byte = swd_batch_cycles >> 3U;
+		const uint8_t mask = 1U << (swd_batch_cycles & 7U);
+		if (direction == JLINK_SWD_OUT)
+			swd_batch_dir[byte] |= mask;
+		if ((data >> bit) & 1U)
+			swd_batch_data[byte] |= mask;
+	}
+}
+
+static uint32_t jlink_swd_batch_response_bits(const size_t offset, const size_t clock_cycles)
+{
+	uint32_t result = 0U;
+	for (size_t bit = 0; bit < clock_cycles; ++bit) {
+		const size_t position = offset + bit;
+		if (swd_batch_response[position >> 3U] & (1U << (position & 7U)))
+			result |= 1U << bit;
+	}
+	return result;
+}
+
+static size_t jlink_swd_batch_access(const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	assert(swd_batch_length < JLINK_SWD_BATCH_DEPTH);
+	const uint8_t request = make_packet_request(rnw, addr);
+	/*
+	 * The phases generated here are exactly the sequences jlink_adiv5_raw_access() runs as separate
+	 * transfers, so the ACK is found just after the 8 bit request in the response
+	 */
+	swd_batch[swd_batch_length] = (jlink_swd_transaction_s){request, swd_batch_cycles + 8U, value};
+	jlink_swd_batch_append(request, 8U, JLINK_SWD_OUT);
+	if (rnw) {
+		/* ACK, data and parity come from the target, followed by 2 OUT cycles for turnaround and idle */
+		jlink_swd_batch_append(0U, 3U + 33U, JLINK_SWD_IN);
+		jlink_swd_batch_append(0U, 2U, JLINK_SWD_OUT);
+	} else {
+		/* ACK and turnaround come from the target, then we write the data, its parity and 8 idle cycles */
+		jlink_swd_batch_append(0U, 4U, JLINK_SWD_IN);
+		jlink_swd_batch_append(0U, 1U, JLINK_SWD_OUT);
+		jlink_swd_batch_append(value, 32U, JLINK_SWD_OUT);
+		jlink_swd_batch_append(__builtin_parity(value) & 1U, 1U, JLINK_SWD_OUT);
+		jlink_swd_batch_append(0U, 8U, JLINK_SWD_OUT);
+	}
+	return swd_batch_length++;
+}
+
+/*
+ * Run the batch, decoding all the responses. Read results are stored back into the value field of their
+ * batch entry. Returns true only if every access was ACKed OK and every read passed its parity check.
+ */
+static bool jlink_swd_batch_run(void)
+{
+	DEBUG_PROBE("%s: %zu transactions in %u cycles\n", __func__, swd_batch_length, swd_batch_cycles);
+	const bool transferred = jlink_transfer(swd_batch_cycles, swd_batch_dir, swd_batch_data, swd_batch_response);
+	const size_t length = swd_batch_length;
+	jlink_swd_batch_reset();
+	if (!transferred) {
+		DEBUG_ERROR("%s failed\n", __func__);
+		return false;
+	}
+
+	for (size_t idx = 0; idx < length; ++idx) {
+		jlink_swd_transaction_s *const transaction = &swd_batch[idx];
+		const uint8_t ack = jlink_swd_batch_response_bits(transaction->ack_offset, 3U);
+		if (ack != SWDP_ACK_OK) {
+			DEBUG_PROBE("%s: transaction %zu failed, ACK %u\n", __func__, idx, ack);
+			return false;
+		}
+		/* RnW is bit 2 of the request */
+		if (transaction->request & 0x04U) {
+			transaction->value = jlink_swd_batch_response_bits(transaction->ack_offset + 3U, 32U);
+			const uint8_t parity = jlink_swd_batch_response_bits(transaction->ack_offset + 35U, 1U);
+			if ((__builtin_parity(transaction->value) & 1U) != parity) {
+				DEBUG_PROBE("%s: transaction %zu failed parity check\n", __func__, idx);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* Running the batch only resets its length, so the decoded results remain available afterwards */
+static uint32_t jlink_swd_batch_read_value(const size_t idx)
+{
+	return swd_batch[idx].value;
+}
+
+static const adiv5_swd_queue_s jlink_swd_batch = {
+	.data_max = JLINK_SWD_BATCH_DATA_MAX,
+	.access = jlink_swd_batch_access,
+	.run = jlink_swd_batch_run,
+	.read_value = jlink_swd_batch_read_value,
+};
+
+size_t jlink_mem_transfer_size(void)
+{
+	return (size_t)JLINK_SWD_BATCH_DATA_MAX << ALIGN_WORD;
+}
+
+static void jlink_adiv5_mem_read(adiv5_access_port_s *const ap, void *const dest, const uint32_t src, const size_t len)
+{
+	adiv5_swd_queue_mem_read(&jlink_swd_batch, ap, dest, src, len);
+}
+
+static void jlink_adiv5_mem_write(
+	adiv5_access_port_s *const ap, const uint32_t dest, const void *const src, const size_t len, const align_e align)
+{
+	adiv5_swd_queue_mem_write(&jlink_swd_batch, ap, dest, src, len, align);
+}
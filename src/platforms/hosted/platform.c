@@ -52,6 +52,7 @@
 #include "jlink.h"
 #include "cmsis_dap.h"
 #endif
+#include "swo.h"
 
 bmp_info_s info;
 
@@ -67,6 +68,7 @@ void gdb_ident(char *p, int count)
 
 static void exit_function(void)
 {
+	bmda_swo_deinit();
 	libusb_exit_function(&info);
 
 	switch (info.bmp_type) {
@@ -278,6 +280,12 @@ void bmda_adiv5_dp_init(adiv5_debug_port_s *const dp)
 
 	case BMP_TYPE_CMSIS_DAP:
 		return dap_adiv5_dp_init(dp);
+
+	case BMP_TYPE_FTDI:
+		return ftdi_swd_adiv5_dp_init(dp);
+
+	case BMP_TYPE_JLINK:
+		return jlink_adiv5_dp_init(dp);
 #endif
 
 	default:
@@ -329,6 +337,30 @@ char *bmda_adaptor_ident(void)
 	}
 }
 
+/* Largest memory read the adaptor completes in one transfer, or 0 if it has no particular limit */
+size_t bmda_mem_transfer_size(void)
+{
+	switch (info.bmp_type) {
+	case BMP_TYPE_BMP:
+		/* Responses are hex encoded with 2 bytes of framing around the data */
+		return (REMOTE_MAX_MSG_SIZE - 2U) / 2U;
+
+#if HOSTED_BMP_ONLY == 0
+	case BMP_TYPE_STLINK_V2:
+		return stlink_mem_transfer_size();
+
+	case BMP_TYPE_CMSIS_DAP:
+		return dap_mem_transfer_size();
+
+	case BMP_TYPE_JLINK:
+		return jlink_mem_transfer_size();
+#endif
+
+	default:
+		return 0U;
+	}
+}
+
 const char *platform_target_voltage(void)
 {
 	switch (info.bmp_type) {
@@ -529,10 +561,34 @@ void platform_buffer_flush(void)
 	}
 }
 
+/*
+ * Run state polling starts out back to back when the target is resumed or stepped, so that short runs
+ * to a breakpoint are reported promptly, then backs off exponentially while the target keeps running.
+ * The wait between polls is done on the GDB socket so that a ^C from GDB cuts it short.
+ */
+#define BMDA_PACE_FAST_POLLS 8U
+#define BMDA_PACE_MAX_MS     8U
+
+static uint32_t pace_polls;
+static uint32_t pace_interval;
+
+void platform_pace_restart(void)
+{
+	pace_polls = 0U;
+	pace_interval = 0U;
+}
+
 void platform_pace_poll(void)
 {
-	if (!cl_opts.fast_poll)
-		platform_delay(8);
+	bmda_swo_poll();
+	if (cl_opts.fast_poll)
+		return;
+	if (pace_polls < BMDA_PACE_FAST_POLLS)
+		++pace_polls;
+	else
+		pace_interval = pace_interval ? MIN(pace_interval * 2U, BMDA_PACE_MAX_MS) : 1U;
+	if (pace_interval)
+		gdb_if_wait(pace_interval);
 }
 
 void platform_target_clk_output_enable(const bool enable)
@@ -630,6 +686,8 @@ static void decode_access(const uint16_t addr, const uint8_t rnw)
 
 void adiv5_dp_write(adiv5_debug_port_s *dp, uint16_t addr, uint32_t value)
 {
+	if (addr == ADIV5_DP_SELECT)
+		stats_increment(STATS_DP_SELECT_WRITES);
 	decode_access(addr, ADIV5_LOW_WRITE);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 	dp->low_access(dp, ADIV5_LOW_WRITE, addr, value);
@@ -668,6 +726,8 @@ uint32_t adiv5_ap_read(adiv5_access_port_s *ap, uint16_t addr)
 
 void adiv5_ap_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value)
 {
+	if (addr == ADIV5_AP_CSW)
+		stats_increment(STATS_AP_CSW_WRITES);
 	decode_access(addr, ADIV5_LOW_WRITE);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 	return ap->dp->ap_write(ap, addr, value);
@@ -38,6 +38,7 @@
 #include "timing.h"
 
 char *bmda_adaptor_ident(void);
+size_t bmda_mem_transfer_size(void);
 void platform_buffer_flush(void);
 
 #define PLATFORM_IDENT "(Black Magic Debug App) "
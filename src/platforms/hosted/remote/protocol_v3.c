@@ -38,6 +38,7 @@
 #include "protocol_v1.h"
 #include "protocol_v2.h"
 #include "protocol_v3.h"
+#include "protocol_v3_defs.h"
 #include "protocol_v3_adiv5.h"
 
 void remote_v3_init(void)
@@ -50,6 +51,7 @@ void remote_v3_init(void)
 		.get_comms_frequency = remote_v2_get_comms_frequency,
 		.set_comms_frequency = remote_v2_set_comms_frequency,
 		.target_clk_output_enable = remote_v2_target_clk_output_enable,
+		.traceswo_init = remote_v3_traceswo_init,
 	};
 }
 
@@ -63,3 +65,17 @@ bool remote_v3_adiv5_init(adiv5_debug_port_s *const dp)
 	dp->mem_write = remote_v3_adiv5_mem_write_bytes;
 	return true;
 }
+
+bool remote_v3_traceswo_init(const uint32_t baudrate)
+{
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	int length = snprintf(buffer, REMOTE_MAX_MSG_SIZE, REMOTE_TRACESWO_STR, baudrate);
+	platform_buffer_write(buffer, length);
+	length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+	if (length < 1 || buffer[0] != REMOTE_RESP_OK) {
+		DEBUG_ERROR("remote_traceswo_init failed, error %s\n",
+			length < 1 ? "with communication" : buffer[0] == REMOTE_RESP_NOTSUP ? "not supported" : buffer + 1);
+		return false;
+	}
+	return true;
+}
@@ -40,5 +40,6 @@
 void remote_v3_init(void);
 
 bool remote_v3_adiv5_init(adiv5_debug_port_s *dp);
+bool remote_v3_traceswo_init(uint32_t baudrate);
 
 #endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V3_H*/
@@ -58,4 +58,13 @@
 #define REMOTE_MEM_READ         'm'
 #define REMOTE_MEM_WRITE        'M'
 
+/* It also adds a command for starting raw (undecoded) SWO capture to the probe's trace endpoint */
+#define REMOTE_TRACESWO 'W'
+
+#define REMOTE_TRACESWO_STR                                                          \
+	(char[])                                                                         \
+	{                                                                                \
+		REMOTE_SOM, REMOTE_GEN_PACKET, REMOTE_TRACESWO, REMOTE_UINT32, REMOTE_EOM, 0 \
+	}
+
 #endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V3_DEFS_H*/
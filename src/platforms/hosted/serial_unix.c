@@ -31,6 +31,7 @@
 #include "bmp_hosted.h"
 #include "utils.h"
 #include "cortexm.h"
+#include "stats.h"
 
 static int fd; /* File descriptor for connection to GDB remote */
 
@@ -214,6 +215,7 @@ bool platform_buffer_write(const void *const data, const size_t length)
 		DEBUG_ERROR("Failed to write (%d): %s\n", errno, strerror(error));
 		exit(-2);
 	}
+	stats_increment(STATS_USB_TX_PACKETS);
 	return (size_t)written == length;
 }
 
@@ -270,6 +272,7 @@ int platform_buffer_read(void *const data, size_t length)
 		char *const buffer = (char *)data;
 		if (buffer[offset] == REMOTE_EOM) {
 			buffer[offset] = 0;
+			stats_increment(STATS_USB_RX_PACKETS);
 			DEBUG_WIRE("       %s\n", buffer);
 			return offset;
 		}
@@ -21,6 +21,7 @@
 #include <windows.h>
 #include "remote.h"
 #include "cli.h"
+#include "stats.h"
 
 #include <assert.h>
 #include <string.h>
@@ -239,6 +240,7 @@ bool platform_buffer_write(const void *const data, const size_t length)
 		}
 		offset += written;
 	}
+	stats_increment(STATS_USB_TX_PACKETS);
 	return true;
 }
 
@@ -272,6 +274,7 @@ int platform_buffer_read(void *const data, const size_t length)
 			DEBUG_WIRE("%c", buffer[offset]);
 			if (buffer[offset] == REMOTE_EOM) {
 				buffer[offset] = 0;
+				stats_increment(STATS_USB_RX_PACKETS);
 				DEBUG_WIRE("\n");
 				return offset;
 			}
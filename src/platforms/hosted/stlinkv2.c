@@ -636,48 +636,177 @@ static int stlink_usb_get_rw_status(bool verbose)
 	return stlink_usb_error_check(data, verbose);
 }
 
-static void stlink_mem_read(adiv5_access_port_s *ap, void *dest, uint32_t src, size_t len)
-{
-	if (len == 0)
-		return;
-	if (len > stlink.block_size) {
-		DEBUG_WARN("Too large!\n");
-		return;
+/*
+ * The ST-Link can do at most block_size bytes per 8-bit access, and up to 1KiB for 16- and 32-bit
+ * accesses which additionally must not cross the 1KiB TAR auto-increment boundary
+ */
+#define STLINK_MAX_RW16_32 1024U
+/* Number of memory accesses we keep in flight at once */
+#define STLINK_PIPELINE_DEPTH 4U
+
+typedef struct stlink_mem_op {
+	stlink_mem_command_s command;
+	stlink_simple_command_s status_request;
+	uint32_t address;
+	uint8_t *data;
+	size_t length;
+	uint8_t status[12];
+	/* Due to the minimum read size of 2, single byte reads are done into this and copied out */
+	uint8_t bounce[2];
+	/* Command, data phase, status request and status response transfers */
+	transfer_ctx_s transfers[4];
+	bool write;
+} stlink_mem_op_s;
+
+static uint8_t stlink_mem_operation(const align_e align, const bool write)
+{
+	switch (align) {
+	case ALIGN_BYTE:
+		return write ? STLINK_DEBUG_WRITEMEM_8BIT : STLINK_DEBUG_READMEM_8BIT;
+	case ALIGN_HALFWORD:
+		return write ? STLINK_DEBUG_APIV2_WRITEMEM_16BIT : STLINK_DEBUG_APIV2_READMEM_16BIT;
+	default:
+		return write ? STLINK_DEBUG_WRITEMEM_32BIT : STLINK_DEBUG_READMEM_32BIT;
 	}
+}
 
-	uint8_t type;
-	if ((src & 1U) || (len & 1U))
-		type = STLINK_DEBUG_READMEM_8BIT;
-	else if ((src & 3U) || (len & 3U))
-		type = STLINK_DEBUG_APIV2_READMEM_16BIT;
-	else
-		type = STLINK_DEBUG_READMEM_32BIT;
-
-	/* Build the command packet and perform the access */
-	stlink_mem_command_s command = stlink_memory_access(type, src, len, ap->apsel);
-	int res = 0;
-	if (len > 1)
-		res = stlink_read_retry(&command, sizeof(command), dest, len);
-	else {
-		/*
-		 * Due to an artefact of how the ST-Link protocol works (minimum read size is 2),
-		 * a single byte read must be done into a 2 byte buffer
-		 */
-		uint8_t buffer[2];
-		res = stlink_read_retry(&command, sizeof(command), buffer, sizeof(buffer));
-		/* But we only want and need to keep a single byte from this */
-		memcpy(dest, buffer, 1);
+/*
+ * Plan the next access of a transfer. This picks the widest access width the address and remaining
+ * length allow (capped at max_align), splitting off small head and tail accesses so the bulk of the
+ * transfer can be done with aligned full-width blocks.
+ */
+static size_t stlink_mem_plan(const uint32_t addr, const size_t len, const align_e max_align, align_e *const align)
+{
+	align_e access = MIN(max_align, ALIGN_WORD);
+	while (access > ALIGN_BYTE && ((addr | MIN(len, 4U)) & ((1U << access) - 1U)))
+		--access;
+	*align = access;
+	const size_t width = 1U << access;
+	/* If this is a head or tail access, only go as far as the next word boundary */
+	if (access < max_align && access < ALIGN_WORD)
+		return MIN(len, 4U - (addr & 3U)) & ~(width - 1U);
+	const size_t limit = access == ALIGN_BYTE ? stlink.block_size : STLINK_MAX_RW16_32;
+	const size_t boundary = 0x400U - (addr & 0x3ffU);
+	return MIN(MIN(len, limit), boundary) & ~(width - 1U);
+}
+
+/* Submit the transfers making up a memory operation, returning how many were successfully submitted */
+static size_t stlink_mem_op_submit(stlink_mem_op_s *const op)
+{
+	usb_link_s *const link = info.usb_link;
+	uint8_t *const buffer = !op->write && op->length == 1U ? op->bounce : op->data;
+	const size_t length = !op->write && op->length == 1U ? sizeof(op->bounce) : op->length;
+	if (!bmda_usb_transfer_submit(link, false, &op->command, sizeof(op->command), &op->transfers[0]))
+		return 0U;
+	if (!bmda_usb_transfer_submit(link, !op->write, buffer, length, &op->transfers[1]))
+		return 1U;
+	if (!bmda_usb_transfer_submit(link, false, &op->status_request, sizeof(op->status_request), &op->transfers[2]))
+		return 2U;
+	if (!bmda_usb_transfer_submit(link, true, op->status, sizeof(op->status), &op->transfers[3]))
+		return 3U;
+	return 4U;
+}
+
+static int stlink_mem_op_complete(stlink_mem_op_s *const op, const size_t submitted)
+{
+	/* If the submission failed part way, the transfers that did make it still have to be waited on */
+	bool result = submitted == 4U;
+	for (size_t idx = 0; idx < submitted; ++idx)
+		result &= bmda_usb_transfer_wait(info.usb_link, &op->transfers[idx]);
+	if (!result)
+		return STLINK_ERROR_FAIL;
+	if (!op->write && op->length == 1U)
+		op->data[0] = op->bounce[0];
+	return stlink_usb_error_check(op->status, false);
+}
+
+/* Re-run a memory operation synchronously, retrying on WAIT as the non-pipelined path always has */
+static int stlink_mem_op_retry(stlink_mem_op_s *const op)
+{
+	if (op->write)
+		return stlink_write_retry(&op->command, sizeof(op->command), op->data, op->length);
+	if (op->length == 1U) {
+		const int result = stlink_read_retry(&op->command, sizeof(op->command), op->bounce, sizeof(op->bounce));
+		op->data[0] = op->bounce[0];
+		return result;
 	}
-	if (res != STLINK_ERROR_OK) {
-		/* FIXME: What is the right measure when failing?
-		 *
-		 * E.g. TM4C129 gets here when NRF probe reads 0x10000010
-		 * Approach taken:
-		 * Fill the memory with some fixed pattern so hopefully
-		 * the caller notices the error*/
-		DEBUG_ERROR("stlink_mem_read from  %" PRIx32 " to %p, len %zu failed\n", src, dest, len);
-		memset(dest, 0xff, len);
+	return stlink_read_retry(&op->command, sizeof(op->command), op->data, op->length);
+}
+
+/*
+ * Split a memory transfer up into ST-Link sized accesses and run them, keeping up to STLINK_PIPELINE_DEPTH
+ * accesses (each a command, data phase and status check) in flight on the USB link at once.
+ * Once an access does not complete OK, nothing more is submitted and the pipeline is drained, then:
+ * - for reads, just the accesses that failed are re-run synchronously
+ * - for writes, everything from the first failed access on is re-run synchronously in order, so the
+ *   data that ends up in the target is as if the writes had been done one at a time
+ */
+static bool stlink_mem_transfer(
+	adiv5_access_port_s *const ap, uint32_t addr, uint8_t *data, size_t len, const align_e max_align, const bool write)
+{
+	stlink_mem_op_s ops[STLINK_PIPELINE_DEPTH] = {0};
+	size_t submitted[STLINK_PIPELINE_DEPTH] = {0};
+	size_t failed[STLINK_PIPELINE_DEPTH];
+	size_t failures = 0U;
+	size_t head = 0U;
+	size_t in_flight = 0U;
+	bool result = true;
+
+	while (len || in_flight) {
+		/* If the pipeline is full or we've nothing left to queue, retire the oldest operation */
+		if (in_flight == STLINK_PIPELINE_DEPTH || !len || failures) {
+			const size_t slot = (head + STLINK_PIPELINE_DEPTH - in_flight) % STLINK_PIPELINE_DEPTH;
+			/* Operations retire in submission order, so for writes this queues everything after the first failure */
+			if (stlink_mem_op_complete(&ops[slot], submitted[slot]) != STLINK_ERROR_OK || (write && failures))
+				failed[failures++] = slot;
+			--in_flight;
+			/* Once a failure is seen, drain the pipeline before retrying synchronously */
+			if (failures && !in_flight) {
+				for (size_t idx = 0; idx < failures; ++idx) {
+					DEBUG_PROBE("%s: retrying access at %08" PRIx32 "\n", __func__, ops[failed[idx]].address);
+					if (stlink_mem_op_retry(&ops[failed[idx]]) != STLINK_ERROR_OK) {
+						DEBUG_ERROR("stlink_mem_%s at %08" PRIx32 ", len %zu failed\n", write ? "write" : "read",
+							ops[failed[idx]].address, ops[failed[idx]].length);
+						/* The pipeline is drained, so stop here rather than let later writes land past a failed one */
+						if (write)
+							return false;
+						result = false;
+						memset(ops[failed[idx]].data, 0xff, ops[failed[idx]].length);
+					}
+				}
+				failures = 0U;
+			}
+			continue;
+		}
+
+		align_e align;
+		const size_t amount = stlink_mem_plan(addr, len, max_align, &align);
+		stlink_mem_op_s *const op = &ops[head];
+		op->command = stlink_memory_access(stlink_mem_operation(align, write), addr, amount, ap->apsel);
+		op->status_request = (stlink_simple_command_s){
+			.command = STLINK_DEBUG_COMMAND,
+			.operation = STLINK_DEBUG_APIV2_GETLASTRWSTATUS2,
+		};
+		op->address = addr;
+		op->data = data;
+		op->length = amount;
+		op->write = write;
+		submitted[head] = stlink_mem_op_submit(op);
+		head = (head + 1U) % STLINK_PIPELINE_DEPTH;
+		++in_flight;
+
+		addr += amount;
+		data += amount;
+		len -= amount;
 	}
+	return result;
+}
+
+static void stlink_mem_read(adiv5_access_port_s *ap, void *dest, uint32_t src, size_t len)
+{
+	if (len == 0)
+		return;
+	stlink_mem_transfer(ap, src, (uint8_t *)dest, len, ALIGN_WORD, false);
 	DEBUG_PROBE("stlink_mem_read from %" PRIx32 " to %p, len %zu\n", src, dest, len);
 }
 
@@ -686,29 +815,11 @@ static void stlink_mem_write(
 {
 	if (len == 0)
 		return;
-	const uint8_t *const data = (const uint8_t *)src;
-	/* Chunk the write up into stlink.block_size blocks */
-	for (size_t offset = 0; offset < len; offset += stlink.block_size) {
-		/* Figure out how many bytes are in the block and at what start address */
-		const size_t amount = MIN(len - offset, stlink.block_size);
-		const uint32_t addr = dest + offset;
-		/* Now generate an appropriate access packet */
-		stlink_mem_command_s command;
-		switch (align) {
-		case ALIGN_BYTE:
-			command = stlink_memory_access(STLINK_DEBUG_WRITEMEM_8BIT, addr, amount, ap->apsel);
-			break;
-		case ALIGN_HALFWORD:
-			command = stlink_memory_access(STLINK_DEBUG_APIV2_WRITEMEM_16BIT, addr, amount, ap->apsel);
-			break;
-		case ALIGN_WORD:
-		case ALIGN_DWORD:
-			command = stlink_memory_access(STLINK_DEBUG_WRITEMEM_32BIT, addr, amount, ap->apsel);
-			break;
-		}
-		/* And perform the block write */
-		stlink_write_retry(&command, sizeof(command), data + offset, amount);
-	}
+	/*
+	 * The pipeline only ever reads from the source buffer for writes,
+	 * so casting away the const here is safe
+	 */
+	stlink_mem_transfer(ap, dest, (uint8_t *)src, len, align, true);
 }
 
 static void stlink_regs_read(adiv5_access_port_s *ap, void *data)
@@ -867,3 +978,8 @@ uint32_t stlink_max_frequency_get(void)
 		return STLINK_V2_CPU_CLOCK_FREQ / (STLINK_V2_JTAG_MUL_FACTOR * stlink_v2_divisor);
 	return STLINK_V2_CPU_CLOCK_FREQ / (STLINK_V2_SWD_MUL_FACTOR * (stlink_v2_divisor + 1U));
 }
+
+size_t stlink_mem_transfer_size(void)
+{
+	return STLINK_MAX_RW16_32;
+}
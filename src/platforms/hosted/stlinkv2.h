@@ -40,5 +40,6 @@ void stlink_jtag_dp_init(adiv5_debug_port_s *dp);
 void stlink_exit_function(bmp_info_s *info);
 void stlink_max_frequency_set(uint32_t freq);
 uint32_t stlink_max_frequency_get(void);
+size_t stlink_mem_transfer_size(void);
 
 #endif /* PLATFORMS_HOSTED_STLINKV2_H */
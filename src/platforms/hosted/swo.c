@@ -0,0 +1,649 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements host-side SWO capture for BMDA along with an ITM/DWT protocol decoder.
+ *
+ * Trace data is pulled from the adaptor (the native BMP trace endpoint, an FTDI UART channel, or
+ * CMSIS-DAP's DAP_SWO_Data command) and either passed through raw or decoded, with each stimulus
+ * port's output sent to its own file, FIFO or local socket. Decoding on the host takes the probe's
+ * CDC ACM interface out of the data path, so trace rates are limited only by the adaptor's capture.
+ */
+
+#include "general.h"
+#include "swo.h"
+#include "bmp_hosted.h"
+#include "bmp_remote.h"
+#include "gdb_packet.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#if HOSTED_BMP_ONLY == 0
+#include <pthread.h>
+#include "dap.h"
+#include "cmsis_dap.h"
+#include "ftdi_bmp.h"
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+#ifndef O_NONBLOCK
+#define O_NONBLOCK 0
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define SWO_CHANNELS            (SWO_ITM_HARDWARE_CHANNEL + 1U)
+#define SWO_SINK_BUFFER_SIZE    4096U
+#define SWO_CAPTURE_BUFFER_SIZE 16384U
+/* How long a capture thread blocks in a single USB read before checking whether it should stop */
+#define SWO_READ_TIMEOUT_MS 100U
+/* Limit on DAP_SWO_Data commands per poll so a busy trace stream can't starve the GDB server */
+#define SWO_DAP_POLL_LIMIT 64U
+
+/* Hardware source (DWT) packet discriminators */
+#define DWT_EVENT_COUNTER  0U
+#define DWT_EXCEPTION      1U
+#define DWT_PC_SAMPLE      2U
+#define DWT_DATA_TRACE_MIN 8U
+#define DWT_DATA_TRACE_MAX 23U
+
+typedef enum swo_backend {
+	SWO_BACKEND_NONE,
+	SWO_BACKEND_BMP,
+	SWO_BACKEND_DAP,
+	SWO_BACKEND_FTDI,
+} swo_backend_e;
+
+typedef struct swo_sink {
+	int fd;
+	size_t length;
+	uint8_t buffer[SWO_SINK_BUFFER_SIZE];
+} swo_sink_s;
+
+typedef struct swo_capture {
+	swo_backend_e backend;
+	bool decode;
+	/* Output path, optionally containing a single %u for per-channel outputs, or NULL for stdout */
+	char *output;
+	bool per_channel;
+	bool output_open;
+	int listen_fd;
+	swo_sink_s sinks[SWO_CHANNELS];
+	swo_itm_decoder_s decoder;
+
+	/* Counted from the capture thread on the bulk trace backends, read and reset from GDB's thread */
+	_Atomic uint64_t captured;
+	_Atomic uint64_t dropped;
+	uint32_t adaptor_overruns;
+	uint32_t adaptor_errors;
+
+#if HOSTED_BMP_ONLY == 0
+	pthread_t thread;
+	bool thread_started;
+	volatile bool stop;
+	libusb_device_handle *trace_handle;
+	uint8_t trace_interface;
+	uint8_t trace_endpoint;
+#endif
+} swo_capture_s;
+
+static swo_capture_s swo = {.backend = SWO_BACKEND_NONE, .listen_fd = -1};
+
+static const char *const dwt_exception_functions[] = {"", "entered", "exited", "returned to"};
+
+static void swo_itm_source_packet(itm_decoder_s *itm);
+static void swo_itm_protocol_packet(itm_decoder_s *itm);
+
+void swo_itm_decoder_init(
+	swo_itm_decoder_s *const decoder, const uint32_t channel_mask, swo_itm_output_fn output, void *output_context)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	itm_decoder_init(&decoder->itm, swo_itm_source_packet, swo_itm_protocol_packet, decoder);
+	decoder->channel_mask = channel_mask;
+	decoder->output = output;
+	decoder->output_context = output_context;
+}
+
+static uint32_t swo_itm_payload_value(const itm_decoder_s *const itm)
+{
+	uint32_t value = 0;
+	for (uint8_t i = 0; i < itm->payload_length; ++i)
+		value |= (uint32_t)itm->payload[i] << (i * 8U);
+	return value;
+}
+
+/* Sum up a protocol packet payload made of 7-bit little endian groups with continuation bits */
+static uint64_t swo_itm_protocol_value(const itm_decoder_s *const itm)
+{
+	uint64_t value = 0;
+	for (uint8_t i = 0; i < itm->payload_length; ++i)
+		value |= (uint64_t)(itm->payload[i] & ~ITM_CONTINUATION) << (i * 7U);
+	return value;
+}
+
+static void swo_itm_hardware_packet(swo_itm_decoder_s *const decoder)
+{
+	const itm_decoder_s *const itm = &decoder->itm;
+	const uint8_t discriminator = ITM_SOURCE_ADDRESS(itm->header);
+	const uint32_t value = swo_itm_payload_value(itm);
+	char line[96U];
+	int length = 0;
+	++decoder->hardware_packets;
+
+	if (discriminator == DWT_EVENT_COUNTER)
+		length = snprintf(line, sizeof(line), "[%" PRIu64 "] event counter wrap: %02" PRIx32 "\n",
+			decoder->local_timestamp, value);
+	else if (discriminator == DWT_EXCEPTION)
+		length = snprintf(line, sizeof(line), "[%" PRIu64 "] exception %" PRIu32 " %s\n", decoder->local_timestamp,
+			value & 0x1ffU, dwt_exception_functions[(value >> 12U) & 3U]);
+	else if (discriminator == DWT_PC_SAMPLE && itm->payload_length == 4U)
+		length = snprintf(line, sizeof(line), "[%" PRIu64 "] pc 0x%08" PRIx32 "\n", decoder->local_timestamp, value);
+	else if (discriminator == DWT_PC_SAMPLE)
+		length = snprintf(line, sizeof(line), "[%" PRIu64 "] pc sleeping\n", decoder->local_timestamp);
+	else if (discriminator >= DWT_DATA_TRACE_MIN && discriminator <= DWT_DATA_TRACE_MAX) {
+		const uint8_t comparator = (discriminator >> 1U) & 3U;
+		if (discriminator < 16U && !(discriminator & 1U))
+			length = snprintf(line, sizeof(line), "[%" PRIu64 "] comparator %u pc 0x%08" PRIx32 "\n",
+				decoder->local_timestamp, comparator, value);
+		else if (discriminator < 16U)
+			length = snprintf(line, sizeof(line), "[%" PRIu64 "] comparator %u address offset 0x%04" PRIx32 "\n",
+				decoder->local_timestamp, comparator, value);
+		else
+			length = snprintf(line, sizeof(line), "[%" PRIu64 "] comparator %u %s 0x%0*" PRIx32 "\n",
+				decoder->local_timestamp, comparator, discriminator & 1U ? "write" : "read",
+				itm->payload_length * 2, value);
+	} else
+		length = snprintf(line, sizeof(line), "[%" PRIu64 "] hardware source %u: 0x%0*" PRIx32 "\n",
+			decoder->local_timestamp, discriminator, itm->payload_length * 2, value);
+
+	if (length > 0)
+		decoder->output(decoder->output_context, SWO_ITM_HARDWARE_CHANNEL, line, MIN((size_t)length, sizeof(line) - 1U));
+}
+
+static void swo_itm_source_packet(itm_decoder_s *const itm)
+{
+	swo_itm_decoder_s *const decoder = (swo_itm_decoder_s *)itm->context;
+	if (itm->header & ITM_SOURCE_HARDWARE) {
+		swo_itm_hardware_packet(decoder);
+		return;
+	}
+	const uint8_t channel = ITM_SOURCE_ADDRESS(itm->header);
+	if (decoder->channel_mask & (1U << channel))
+		decoder->output(decoder->output_context, channel, itm->payload, itm->payload_length);
+}
+
+static void swo_itm_protocol_packet(itm_decoder_s *const itm)
+{
+	swo_itm_decoder_s *const decoder = (swo_itm_decoder_s *)itm->context;
+	const uint64_t value = swo_itm_protocol_value(itm);
+	if (itm->header == ITM_GLOBAL_TIMESTAMP_1) {
+		/* GTS1 carries bits [25:0] of the global timestamp, possibly compressed to just the low bits that changed */
+		const uint64_t mask = ((UINT64_C(1) << MIN(itm->payload_length * 7U, 26U)) - 1U);
+		decoder->global_timestamp = (decoder->global_timestamp & ~mask) | (value & mask);
+	} else if (itm->header == ITM_GLOBAL_TIMESTAMP_2)
+		/* GTS2 carries the upper bits, from bit 26 up */
+		decoder->global_timestamp = (decoder->global_timestamp & ((UINT64_C(1) << 26U) - 1U)) | (value << 26U);
+	else if (!(itm->header & ITM_TIMESTAMP_MASK)) {
+		/* Local timestamps are a delta since the last one - format 2 packs a small delta into the header itself */
+		if (itm->header & ITM_CONTINUATION)
+			decoder->local_timestamp += value;
+		else
+			decoder->local_timestamp += (itm->header >> 4U) & 7U;
+	}
+	/* Extension packets only carry the stimulus port page, which we don't need to track */
+}
+
+void swo_itm_decode(swo_itm_decoder_s *const decoder, const uint8_t *const data, const size_t length)
+{
+	itm_decode(&decoder->itm, data, length);
+}
+
+static bool swo_sink_open(const uint8_t channel)
+{
+	swo_sink_s *const sink = &swo.sinks[channel];
+#ifndef _WIN32
+	if (swo.listen_fd != -1) {
+		/* Local socket output - pick up a client if one has connected since we last looked */
+		sink->fd = accept(swo.listen_fd, NULL, NULL);
+		if (sink->fd != -1)
+			fcntl(sink->fd, F_SETFL, fcntl(sink->fd, F_GETFL) | O_NONBLOCK);
+		return sink->fd != -1;
+	}
+#endif
+	if (!swo.output) {
+		sink->fd = STDOUT_FILENO;
+		return true;
+	}
+	char path[PATH_MAX];
+	if (swo.per_channel)
+		snprintf(path, sizeof(path), swo.output, channel);
+	else
+		snprintf(path, sizeof(path), "%s", swo.output);
+	/* Open non-blocking so a FIFO without a reader makes us drop data rather than stall capture */
+	sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK | O_BINARY, S_IRUSR | S_IWUSR);
+	return sink->fd != -1;
+}
+
+static void swo_sink_close(swo_sink_s *const sink)
+{
+	if (sink->fd != -1 && sink->fd != STDOUT_FILENO)
+		close(sink->fd);
+	sink->fd = -1;
+	sink->length = 0U;
+}
+
+static void swo_sink_flush(const uint8_t channel)
+{
+	swo_sink_s *const sink = &swo.sinks[channel];
+	if (!sink->length)
+		return;
+	if (sink->fd == -1 && !swo_sink_open(channel)) {
+		atomic_fetch_add(&swo.dropped, sink->length);
+		sink->length = 0U;
+		return;
+	}
+
+	size_t offset = 0;
+	while (offset < sink->length) {
+#ifndef _WIN32
+		const ssize_t result = swo.listen_fd != -1 ?
+			send(sink->fd, sink->buffer + offset, sink->length - offset, MSG_NOSIGNAL) :
+			write(sink->fd, sink->buffer + offset, sink->length - offset);
+#else
+		const ssize_t result = write(sink->fd, sink->buffer + offset, sink->length - offset);
+#endif
+		if (result <= 0) {
+			/* A full FIFO or socket means the reader is behind - drop rather than stall. Anything else closes it */
+			if (result == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				swo_sink_close(sink);
+			else if (errno == EINTR)
+				continue;
+			break;
+		}
+		offset += (size_t)result;
+	}
+	atomic_fetch_add(&swo.dropped, sink->length - offset);
+	sink->length = 0U;
+}
+
+static void swo_output(void *const context, const uint8_t channel, const void *const data, const size_t length)
+{
+	(void)context;
+	/* Without per-channel outputs, everything goes to the first sink */
+	const uint8_t index = swo.per_channel ? channel : 0U;
+	swo_sink_s *const sink = &swo.sinks[index];
+	if (sink->length + length > SWO_SINK_BUFFER_SIZE)
+		swo_sink_flush(index);
+	memcpy(sink->buffer + sink->length, data, length);
+	sink->length += length;
+}
+
+static bool swo_setup_output(const char *const output)
+{
+	for (uint8_t channel = 0; channel < SWO_CHANNELS; ++channel) {
+		swo.sinks[channel].fd = -1;
+		swo.sinks[channel].length = 0U;
+	}
+	swo.output_open = true;
+	swo.per_channel = false;
+	if (!output)
+		return true;
+
+#ifndef _WIN32
+	/* Ignore SIGPIPE so a FIFO reader going away doesn't take BMDA down with it */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (strncmp(output, "unix:", 5U) == 0) {
+		struct sockaddr_un address = {.sun_family = AF_UNIX};
+		if (strlen(output + 5U) >= sizeof(address.sun_path)) {
+			DEBUG_ERROR("SWO socket path too long\n");
+			return false;
+		}
+		strcpy(address.sun_path, output + 5U);
+		swo.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (swo.listen_fd == -1) {
+			DEBUG_ERROR("Failed to create SWO socket: %s\n", strerror(errno));
+			return false;
+		}
+		unlink(address.sun_path);
+		if (bind(swo.listen_fd, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(swo.listen_fd, 1) == -1) {
+			DEBUG_ERROR("Failed to listen on SWO socket %s: %s\n", address.sun_path, strerror(errno));
+			close(swo.listen_fd);
+			swo.listen_fd = -1;
+			return false;
+		}
+		fcntl(swo.listen_fd, F_SETFL, fcntl(swo.listen_fd, F_GETFL) | O_NONBLOCK);
+		return true;
+	}
+#endif
+
+	/* A path template must contain at most a single %u and no other conversions */
+	const char *const conversion = strchr(output, '%');
+	if (conversion) {
+		if (conversion[1] != 'u' || strchr(conversion + 1U, '%')) {
+			DEBUG_ERROR("SWO output path may only contain a single %%u\n");
+			return false;
+		}
+		swo.per_channel = swo.decode;
+	}
+	swo.output = strdup(output);
+	return swo.output != NULL;
+}
+
+#if HOSTED_BMP_ONLY == 0
+static void swo_flush(void)
+{
+	for (uint8_t channel = 0; channel < SWO_CHANNELS; ++channel)
+		swo_sink_flush(channel);
+}
+
+static void swo_process(const uint8_t *const data, const size_t length)
+{
+	if (!length)
+		return;
+	atomic_fetch_add(&swo.captured, length);
+	if (swo.decode)
+		swo_itm_decode(&swo.decoder, data, length);
+	else {
+		for (size_t offset = 0; offset < length;) {
+			const size_t amount = MIN(length - offset, SWO_SINK_BUFFER_SIZE);
+			swo_output(NULL, 0U, data + offset, amount);
+			offset += amount;
+		}
+	}
+	swo_flush();
+}
+
+/* Find the BMP's vendor-specific trace capture interface and claim it */
+static bool swo_bmp_open(void)
+{
+	libusb_config_descriptor_s *config = NULL;
+	if (libusb_get_active_config_descriptor(info.libusb_dev, &config) != LIBUSB_SUCCESS)
+		return false;
+	bool found = false;
+	for (uint8_t idx = 0; idx < config->bNumInterfaces && !found; ++idx) {
+		const libusb_interface_descriptor_s *const iface = &config->interface[idx].altsetting[0];
+		if (iface->bInterfaceClass == LIBUSB_CLASS_VENDOR_SPEC && iface->bInterfaceSubClass == 0xffU &&
+			iface->bInterfaceProtocol == 0xffU && iface->bNumEndpoints == 1U &&
+			(iface->endpoint[0].bEndpointAddress & LIBUSB_ENDPOINT_IN)) {
+			swo.trace_interface = iface->bInterfaceNumber;
+			swo.trace_endpoint = iface->endpoint[0].bEndpointAddress;
+			found = true;
+		}
+	}
+	libusb_free_config_descriptor(config);
+	if (!found) {
+		DEBUG_ERROR("Probe firmware does not provide a trace capture interface\n");
+		return false;
+	}
+
+	int result = libusb_open(info.libusb_dev, &swo.trace_handle);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("Failed to open trace interface (%d): %s\n", result, libusb_error_name(result));
+		return false;
+	}
+	result = libusb_claim_interface(swo.trace_handle, swo.trace_interface);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("Failed to claim trace interface (%d): %s\n", result, libusb_error_name(result));
+		libusb_close(swo.trace_handle);
+		swo.trace_handle = NULL;
+		return false;
+	}
+	return true;
+}
+
+static void swo_bmp_close(void)
+{
+	if (!swo.trace_handle)
+		return;
+	libusb_release_interface(swo.trace_handle, swo.trace_interface);
+	libusb_close(swo.trace_handle);
+	swo.trace_handle = NULL;
+}
+
+static int swo_bmp_read(uint8_t *const data, const size_t length)
+{
+	int transferred = 0;
+	const int result =
+		libusb_bulk_transfer(swo.trace_handle, swo.trace_endpoint, data, (int)length, &transferred, SWO_READ_TIMEOUT_MS);
+	if (result != LIBUSB_SUCCESS && result != LIBUSB_ERROR_TIMEOUT) {
+		DEBUG_ERROR("Trace capture failed (%d): %s\n", result, libusb_error_name(result));
+		return result;
+	}
+	return transferred;
+}
+
+/*
+ * The native BMP and FTDI trace streams come from a USB endpoint that nothing else uses, so read
+ * them from a thread that does nothing but keep a transfer in flight and decode what comes back.
+ */
+static void *swo_capture_thread(void *const argument)
+{
+	(void)argument;
+	uint8_t data[SWO_CAPTURE_BUFFER_SIZE];
+	while (!swo.stop) {
+		const int result =
+			swo.backend == SWO_BACKEND_BMP ? swo_bmp_read(data, sizeof(data)) : ftdi_swo_read(data, sizeof(data));
+		/* If the adaptor went away there's nothing more to be had, so stop capturing */
+		if (result < 0)
+			break;
+		swo_process(data, (size_t)result);
+	}
+	return NULL;
+}
+
+static bool swo_start_thread(void)
+{
+	swo.stop = false;
+	const int result = pthread_create(&swo.thread, NULL, swo_capture_thread, NULL);
+	if (result != 0) {
+		DEBUG_ERROR("Failed to start trace capture thread: %s\n", strerror(result));
+		return false;
+	}
+	swo.thread_started = true;
+	return true;
+}
+
+static bool swo_dap_init(const swo_coding_e coding, const uint32_t baudrate)
+{
+	const dap_swo_mode_e mode = coding == SWO_CODING_MANCHESTER ? DAP_SWO_MANCHESTER : DAP_SWO_UART;
+	if (!(dap_caps & (mode == DAP_SWO_MANCHESTER ? DAP_CAP_SWO_MANCHESTER : DAP_CAP_SWO_ASYNC))) {
+		DEBUG_ERROR("Adaptor does not support %s SWO capture\n", mode == DAP_SWO_MANCHESTER ? "Manchester" : "NRZ");
+		return false;
+	}
+	const uint32_t actual_baudrate = dap_swo_configure(mode, baudrate);
+	if (!actual_baudrate) {
+		DEBUG_ERROR("Adaptor can't capture SWO at %" PRIu32 " baud\n", baudrate);
+		return false;
+	}
+	if (actual_baudrate != baudrate)
+		DEBUG_WARN("Adaptor capturing SWO at %" PRIu32 " baud\n", actual_baudrate);
+	return dap_swo_control(true);
+}
+#endif
+
+bool bmda_swo_init(const swo_coding_e coding, const uint32_t baudrate, const bool decode, const uint32_t channel_mask,
+	const char *const output)
+{
+	bmda_swo_deinit();
+	swo.decode = decode;
+	if (!swo_setup_output(output)) {
+		bmda_swo_deinit();
+		return false;
+	}
+	swo_itm_decoder_init(&swo.decoder, channel_mask, swo_output, NULL);
+	atomic_store(&swo.captured, 0U);
+	atomic_store(&swo.dropped, 0U);
+	swo.adaptor_overruns = 0U;
+	swo.adaptor_errors = 0U;
+
+	bool result = false;
+	switch (info.bmp_type) {
+#if HOSTED_BMP_ONLY == 0
+	case BMP_TYPE_BMP:
+		swo.backend = SWO_BACKEND_BMP;
+		/* The firmware picks its own line coding, so all we can tell it is the baud rate to use for NRZ */
+		result = swo_bmp_open() && remote_traceswo_init(baudrate) && swo_start_thread();
+		break;
+
+	case BMP_TYPE_CMSIS_DAP:
+		swo.backend = SWO_BACKEND_DAP;
+		result = swo_dap_init(coding, baudrate);
+		break;
+
+	case BMP_TYPE_FTDI:
+		swo.backend = SWO_BACKEND_FTDI;
+		if (coding == SWO_CODING_MANCHESTER)
+			DEBUG_ERROR("FTDI adaptors can only capture NRZ SWO\n");
+		else
+			result = ftdi_swo_init(baudrate) && swo_start_thread();
+		break;
+#endif
+
+	default:
+#if HOSTED_BMP_ONLY == 1
+		(void)coding;
+		(void)baudrate;
+		DEBUG_ERROR("SWO capture requires a BMDA build with libusb support\n");
+#else
+		DEBUG_ERROR("SWO capture is not supported on this adaptor\n");
+#endif
+		break;
+	}
+
+	if (!result)
+		bmda_swo_deinit();
+	return result;
+}
+
+void bmda_swo_deinit(void)
+{
+	switch (swo.backend) {
+#if HOSTED_BMP_ONLY == 0
+	case SWO_BACKEND_BMP:
+	case SWO_BACKEND_FTDI:
+		if (swo.thread_started) {
+			swo.stop = true;
+			pthread_join(swo.thread, NULL);
+			swo.thread_started = false;
+		}
+		if (swo.backend == SWO_BACKEND_BMP)
+			swo_bmp_close();
+		else
+			ftdi_swo_deinit();
+		break;
+
+	case SWO_BACKEND_DAP:
+		bmda_swo_poll();
+		dap_swo_control(false);
+		dap_swo_configure(DAP_SWO_OFF, 0U);
+		break;
+#endif
+
+	default:
+		break;
+	}
+	swo.backend = SWO_BACKEND_NONE;
+
+	if (swo.output_open) {
+		for (uint8_t channel = 0; channel < SWO_CHANNELS; ++channel)
+			swo_sink_close(&swo.sinks[channel]);
+		swo.output_open = false;
+	}
+#ifndef _WIN32
+	if (swo.listen_fd != -1) {
+		close(swo.listen_fd);
+		swo.listen_fd = -1;
+	}
+#endif
+	free(swo.output);
+	swo.output = NULL;
+}
+
+/*
+ * Called from the GDB server's poll loop. Only CMSIS-DAP needs servicing here, as its trace
+ * data has to be fetched with commands on the same pipe as all other debug traffic.
+ */
+void bmda_swo_poll(void)
+{
+#if HOSTED_BMP_ONLY == 0
+	if (swo.backend != SWO_BACKEND_DAP)
+		return;
+	uint8_t data[DAP_SWO_DATA_MAX * SWO_DAP_POLL_LIMIT];
+	const size_t request = dap_swo_data_size();
+	size_t length = 0;
+	for (size_t poll = 0; poll < SWO_DAP_POLL_LIMIT; ++poll) {
+		uint8_t status = 0;
+		const size_t amount = dap_swo_data(data + length, request, &status);
+		if (status & DAP_SWO_STATUS_BUFFER_OVERRUN)
+			++swo.adaptor_overruns;
+		if (status & DAP_SWO_STATUS_STREAM_ERROR)
+			++swo.adaptor_errors;
+		length += amount;
+		/* A short read means the adaptor's buffer is drained */
+		if (amount < request)
+			break;
+	}
+	swo_process(data, length);
+#endif
+}
+
+void bmda_swo_status(void)
+{
+	if (swo.backend == SWO_BACKEND_NONE) {
+		gdb_out("Trace capture is not running\n");
+		return;
+	}
+	gdb_outf("Captured %" PRIu64 " bytes, dropped %" PRIu64 " bytes of output\n", atomic_load(&swo.captured),
+		atomic_load(&swo.dropped));
+	if (swo.backend == SWO_BACKEND_DAP)
+		gdb_outf("Adaptor buffer overruns: %" PRIu32 ", stream errors: %" PRIu32 "\n", swo.adaptor_overruns,
+			swo.adaptor_errors);
+	if (swo.decode)
+		gdb_outf("ITM syncs: %" PRIu32 ", overflows: %" PRIu32 ", hardware packets: %" PRIu32
+				 ", bad headers: %" PRIu32 "\n",
+			swo.decoder.itm.syncs, swo.decoder.itm.overflows, swo.decoder.hardware_packets, swo.decoder.itm.errors);
+}
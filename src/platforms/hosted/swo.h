@@ -0,0 +1,75 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_SWO_H
+#define PLATFORMS_HOSTED_SWO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "itm_decoder.h"
+
+/* Default NRZ line rate, used when a capture is requested without a baud rate */
+#define BMDA_SWO_DEFAULT_BAUD 2250000U
+
+/* Decoded hardware source (DWT) packets are rendered as text on this pseudo-channel */
+#define SWO_ITM_HARDWARE_CHANNEL 32U
+
+typedef enum swo_coding {
+	SWO_CODING_NRZ,
+	SWO_CODING_MANCHESTER,
+} swo_coding_e;
+
+typedef void (*swo_itm_output_fn)(void *context, uint8_t channel, const void *data, size_t length);
+
+typedef struct swo_itm_decoder {
+	itm_decoder_s itm;
+	uint32_t channel_mask;
+
+	uint64_t local_timestamp;
+	uint64_t global_timestamp;
+	uint32_t hardware_packets;
+
+	swo_itm_output_fn output;
+	void *output_context;
+} swo_itm_decoder_s;
+
+void swo_itm_decoder_init(
+	swo_itm_decoder_s *decoder, uint32_t channel_mask, swo_itm_output_fn output, void *output_context);
+void swo_itm_decode(swo_itm_decoder_s *decoder, const uint8_t *data, size_t length);
+
+bool bmda_swo_init(swo_coding_e coding, uint32_t baudrate, bool decode, uint32_t channel_mask, const char *output);
+void bmda_swo_deinit(void);
+void bmda_swo_poll(void);
+void bmda_swo_status(void);
+
+#endif /* PLATFORMS_HOSTED_SWO_H */
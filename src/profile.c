@@ -0,0 +1,220 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * This file implements the PC sampling profiler behind `monitor profile`.
+ *
+ * Samples are taken between polls of the running target and counted in a histogram of
+ * fixed size bins which can then be printed as a flat profile, or written out in gprof's
+ * gmon.out format from BMDA
+ */
+
+#include "general.h"
+#include "gdb_packet.h"
+#include "profile.h"
+
+#if PC_HOSTED == 1
+#include <stdio.h>
+
+/* BMDA has memory to spare, so give it 2 byte bins over the first 128KiB or so */
+#define PROFILE_MAX_BINS 65536U
+#else
+#define PROFILE_MAX_BINS 1024U
+#endif
+
+/* Gaps between polls longer than this are assumed to be the target having been halted */
+#define PROFILE_MAX_GAP_MS 100U
+
+typedef struct profile {
+	profile_info_s info;
+	target_s *target;
+	profile_sample_fn sample;
+	uint16_t *histogram;
+	uint32_t last_ms;
+	uint32_t credit; /* Progress towards the next sample at the requested rate, in thousandths */
+} profile_s;
+
+static profile_s profile;
+
+bool profile_start(target_s *const target, const profile_sample_fn sample, const uint32_t rate, const uint32_t low_pc,
+	const uint32_t high_pc)
+{
+	if (high_pc <= low_pc)
+		return false;
+	profile_stop();
+	free(profile.histogram);
+	memset(&profile, 0, sizeof(profile));
+
+	/* Work out the smallest bin size (keeping to Thumb instruction alignment) that covers the range */
+	const uint32_t range = high_pc - low_pc;
+	uint32_t bin_size = (range + PROFILE_MAX_BINS - 1U) / PROFILE_MAX_BINS;
+	bin_size = MAX((bin_size + 1U) & ~1U, 2U);
+	const uint32_t bins = (range + bin_size - 1U) / bin_size;
+
+	profile.histogram = calloc(bins, sizeof(*profile.histogram));
+	if (!profile.histogram) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	profile.target = target;
+	profile.sample = sample;
+	profile.info.low_pc = low_pc;
+	profile.info.high_pc = low_pc + bins * bin_size;
+	profile.info.bin_size = bin_size;
+	profile.info.bins = bins;
+	profile.info.rate = rate;
+	profile.info.running = true;
+	profile.last_ms = platform_time_ms();
+	return true;
+}
+
+void profile_stop(void)
+{
+	profile.info.running = false;
+	profile.target = NULL;
+}
+
+static void profile_take_sample(void)
+{
+	++profile.info.samples;
+	uint32_t pc = 0;
+	if (!profile.sample(profile.target, &pc)) {
+		++profile.info.idle;
+		return;
+	}
+	if (pc < profile.info.low_pc || pc >= profile.info.high_pc) {
+		++profile.info.outside;
+		return;
+	}
+	uint16_t *const bin = &profile.histogram[(pc - profile.info.low_pc) / profile.info.bin_size];
+	if (*bin < UINT16_MAX)
+		++*bin;
+}
+
+void profile_poll(target_s *const target)
+{
+	if (!profile.info.running || target != profile.target)
+		return;
+	const uint32_t now = platform_time_ms();
+	const uint32_t delta = MIN(now - profile.last_ms, PROFILE_MAX_GAP_MS);
+	profile.last_ms = now;
+	profile.info.elapsed_ms += delta;
+
+	/*
+	 * Take at most one sample per poll so sampling is spread out over the paced polls rather than
+	 * bunched up in bursts, which would skew the histogram and hold up the poll loop
+	 */
+	if (profile.info.rate) {
+		profile.credit = MIN(profile.credit + delta * profile.info.rate, 1000U);
+		if (profile.credit < 1000U)
+			return;
+		profile.credit -= 1000U;
+	}
+	profile_take_sample();
+}
+
+const profile_info_s *profile_info(void)
+{
+	return &profile.info;
+}
+
+void profile_report_flat(const uint32_t count)
+{
+	const uint32_t samples = profile.info.samples;
+	if (!profile.histogram || !samples) {
+		gdb_out("No samples taken\n");
+		return;
+	}
+	gdb_out(" Samples      %   Address range\n");
+	/* Walk the bins in order of descending count, then ascending address, without sorting a copy */
+	uint32_t last_count = UINT32_MAX;
+	uint32_t last_bin = 0;
+	for (uint32_t reported = 0; reported < count; ++reported) {
+		uint32_t best_bin = UINT32_MAX;
+		uint32_t best_count = 0;
+		for (uint32_t bin = 0; bin < profile.info.bins; ++bin) {
+			const uint32_t bin_count = profile.histogram[bin];
+			if (!bin_count || bin_count > last_count || (reported && bin_count == last_count && bin <= last_bin))
+				continue;
+			if (bin_count > best_count) {
+				best_count = bin_count;
+				best_bin = bin;
+			}
+		}
+		if (best_bin == UINT32_MAX)
+			break;
+		const uint32_t start = profile.info.low_pc + best_bin * profile.info.bin_size;
+		const uint32_t permille = (uint32_t)(((uint64_t)best_count * 1000U) / samples);
+		gdb_outf("%8" PRIu32 " %3" PRIu32 ".%" PRIu32 "%%  0x%08" PRIx32 "-0x%08" PRIx32 "\n", best_count,
+			permille / 10U, permille % 10U, start, start + profile.info.bin_size - 1U);
+		last_count = best_count;
+		last_bin = best_bin;
+	}
+}
+
+#if PC_HOSTED == 1
+static bool profile_write_u32(FILE *const file, const uint32_t value)
+{
+	const uint8_t data[4] = {value & 0xffU, (value >> 8U) & 0xffU, (value >> 16U) & 0xffU, value >> 24U};
+	return fwrite(data, sizeof(data), 1, file) == 1U;
+}
+
+bool profile_write_gmon(const char *const path)
+{
+	if (!profile.histogram)
+		return false;
+	FILE *const file = fopen(path, "wb");
+	if (!file) {
+		DEBUG_ERROR("Failed to open %s for writing\n", path);
+		return false;
+	}
+	/*
+	 * gmon.out header ("gmon", version 1, 12 spare bytes) followed by a single time histogram
+	 * record - all in the target's (little) endianness with 32-bit addresses
+	 */
+	static const uint8_t header[20U] = {'g', 'm', 'o', 'n', 1U};
+	static const char dimension[15U] = "seconds";
+	/* gprof turns counts into time with the sample rate, so give it the rate we actually achieved */
+	const uint32_t rate =
+		profile.info.elapsed_ms ? (uint32_t)(((uint64_t)profile.info.samples * 1000U) / profile.info.elapsed_ms) : 1U;
+	bool result = fwrite(header, sizeof(header), 1, file) == 1U && fputc(0 /* GMON_TAG_TIME_HIST */, file) != EOF &&
+		profile_write_u32(file, profile.info.low_pc) && profile_write_u32(file, profile.info.high_pc) &&
+		profile_write_u32(file, profile.info.bins) && profile_write_u32(file, MAX(rate, 1U)) &&
+		fwrite(dimension, sizeof(dimension), 1, file) == 1U && fputc('s', file) != EOF;
+	for (uint32_t bin = 0; result && bin < profile.info.bins; ++bin) {
+		const uint8_t count[2] = {profile.histogram[bin] & 0xffU, profile.histogram[bin] >> 8U};
+		result = fwrite(count, sizeof(count), 1, file) == 1U;
+	}
+	return fclose(file) == 0 && result;
+}
+#endif
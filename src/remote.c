@@ -37,6 +37,9 @@
 #include "version.h"
 #include "exception.h"
 #include "hex_utils.h"
+#ifdef PLATFORM_HAS_TRACESWO
+#include "traceswo.h"
+#endif
 
 #define HTON(x)    (((x) <= '9') ? (x) - '0' : ((TOUPPER(x)) - 'A' + 10))
 #define TOUPPER(x) ((((x) >= 'a') && ((x) <= 'z')) ? ((x) - ('a' - 'A')) : (x))
@@ -311,6 +314,21 @@ static void remote_packet_process_general(char *packet, const size_t packet_len)
 		platform_target_clk_output_enable(packet[2] != '0');
 		remote_respond(REMOTE_RESP_OK, 0);
 		break;
+	case REMOTE_TRACESWO: {
+#ifdef PLATFORM_HAS_TRACESWO
+		/* Start capture with decoding off - the host wants the raw stream from the trace endpoint */
+#if TRACESWO_PROTOCOL == 2
+		const uint32_t baudrate = remote_hex_string_to_num(8, packet + 2);
+		traceswo_init(baudrate ? baudrate : SWO_DEFAULT_BAUD, 0);
+#else
+		traceswo_init(0);
+#endif
+		remote_respond(REMOTE_RESP_OK, 0);
+#else
+		remote_respond(REMOTE_RESP_NOTSUP, 0);
+#endif
+		break;
+	}
 	default:
 		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
 		break;
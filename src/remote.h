@@ -101,6 +101,7 @@
 #define REMOTE_NRST_SET      'Z'
 #define REMOTE_NRST_GET      'z'
 #define REMOTE_ADD_JTAG_DEV  'J'
+#define REMOTE_TRACESWO      'W'
 
 #define REMOTE_START_STR                                                            \
 	(char[])                                                                        \
@@ -0,0 +1,102 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file implements the counter and histogram registry behind `monitor stats` */
+
+#include "general.h"
+#include "stats.h"
+
+uint32_t stats_counters[STATS_COUNTERS];
+static uint32_t stats_histograms[STATS_HISTOGRAMS][STATS_HISTOGRAM_BUCKETS];
+
+static const char *const stats_counter_names[STATS_COUNTERS] = {
+	[STATS_SWD_TRANSACTIONS] = "swd_transactions",
+	[STATS_SWD_WAIT_RETRIES] = "swd_wait_retries",
+	[STATS_SWD_FAULT_RETRIES] = "swd_fault_retries",
+	[STATS_DP_SELECT_WRITES] = "dp_select_writes",
+	[STATS_AP_CSW_WRITES] = "ap_csw_writes",
+	[STATS_USB_TX_PACKETS] = "usb_tx_packets",
+	[STATS_USB_RX_PACKETS] = "usb_rx_packets",
+	[STATS_USB_TX_TRANSFERS] = "usb_tx_transfers",
+	[STATS_USB_RX_TRANSFERS] = "usb_rx_transfers",
+	[STATS_HALT_POLLS] = "halt_polls",
+	[STATS_FLASH_ERASES] = "flash_erases",
+	[STATS_FLASH_WRITES] = "flash_writes",
+};
+
+static const struct {
+	const char *name;
+	const char *unit;
+} stats_histogram_info[STATS_HISTOGRAMS] = {
+	[STATS_FLASH_ERASE_TIME] = {"flash_erase_time", "ms"},
+	[STATS_FLASH_WRITE_TIME] = {"flash_write_time", "ms"},
+};
+
+void stats_record(const stats_histogram_e histogram, const uint32_t value)
+{
+	const uint8_t bucket = value ? MIN(ulog2(value), STATS_HISTOGRAM_BUCKETS - 1U) : 0U;
+	++stats_histograms[histogram][bucket];
+}
+
+void stats_reset(void)
+{
+	memset(stats_counters, 0, sizeof(stats_counters));
+	memset(stats_histograms, 0, sizeof(stats_histograms));
+}
+
+const char *stats_counter_name(const stats_counter_e counter)
+{
+	return stats_counter_names[counter];
+}
+
+const char *stats_histogram_name(const stats_histogram_e histogram)
+{
+	return stats_histogram_info[histogram].name;
+}
+
+const char *stats_histogram_unit(const stats_histogram_e histogram)
+{
+	return stats_histogram_info[histogram].unit;
+}
+
+const uint32_t *stats_histogram_buckets(const stats_histogram_e histogram)
+{
+	return stats_histograms[histogram];
+}
+
+/* Returns the largest value counted by a bucket, or UINT32_MAX for the last, open ended, one */
+uint32_t stats_bucket_limit(const uint8_t bucket)
+{
+	if (bucket >= STATS_HISTOGRAM_BUCKETS - 1U)
+		return UINT32_MAX;
+	return (1U << bucket) - 1U;
+}
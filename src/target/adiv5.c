@@ -986,8 +986,8 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp, const uint32_t idcode)
 
 #define ALIGNOF(x) (((x)&3U) == 0 ? ALIGN_WORD : (((x)&1U) == 0 ? ALIGN_HALFWORD : ALIGN_BYTE))
 
-/* Program the CSW and TAR for sequential access at a given width */
-void ap_mem_access_setup(adiv5_access_port_s *ap, uint32_t addr, align_e align)
+/* Compute the CSW value for sequential access at a given width */
+static uint32_t ap_mem_access_csw(const adiv5_access_port_s *const ap, const align_e align)
 {
 	uint32_t csw = ap->csw | ADIV5_AP_CSW_ADDRINC_SINGLE;
 
@@ -1003,7 +1003,13 @@ void ap_mem_access_setup(adiv5_access_port_s *ap, uint32_t addr, align_e align)
 		csw |= ADIV5_AP_CSW_SIZE_WORD;
 		break;
 	}
-	adiv5_ap_write(ap, ADIV5_AP_CSW, csw);
+	return csw;
+}
+
+/* Program the CSW and TAR for sequential access at a given width */
+void ap_mem_access_setup(adiv5_access_port_s *ap, uint32_t addr, align_e align)
+{
+	adiv5_ap_write(ap, ADIV5_AP_CSW, ap_mem_access_csw(ap, align));
 	adiv5_dp_low_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_AP_TAR, addr);
 }
 
@@ -1123,8 +1129,126 @@ void adiv5_mem_write_bytes(adiv5_access_port_s *ap, uint32_t dest, const void *s
 	adiv5_dp_read(ap->dp, ADIV5_DP_RDBUFF);
 }
 
+#if PC_HOSTED == 1
+/*
+ * Queued memory access for adaptors that can clock out the request, ACK and data phases of many SWD accesses
+ * in one go, but can't act on an ACK part way through the batch.
+ *
+ * Each batch turns on the DP's overrun detection: with CTRL/STAT.ORUNDETECT set, the first WAIT or FAULT
+ * response sets STICKYORUN and every access after that is answered with FAULT until the sticky flag is
+ * cleared. The host is then required to always clock a full data phase, which is exactly what the queue does.
+ * The ACKs are all checked once the batch completes and if any of them was not OK, the DP is recovered and
+ * that chunk falls back to the regular access path.
+ */
+
+static size_t adiv5_swd_queue_chunk_length(
+	const adiv5_swd_queue_s *const queue, const uint32_t address, const size_t len, const align_e align)
+{
+	/* Limit the chunk to the queue's capacity and to the 10 bit TAR auto-increment boundary */
+	const size_t boundary = 0x400U - (address & 0x3ffU);
+	return MIN(MIN(len, boundary), queue->data_max << align);
+}
+
+static void adiv5_swd_queue_mem_setup(
+	const adiv5_swd_queue_s *const queue, adiv5_access_port_s *const ap, const uint32_t addr, const align_e align)
+{
+	/* Turn on overrun detection so a WAIT or FAULT part way through poisons the rest of the batch */
+	queue->access(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT,
+		ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ | ADIV5_DP_CTRLSTAT_ORUNDETECT);
+	/* These bypass adiv5_dp_write() and adiv5_ap_write(), so count them here */
+	stats_increment(STATS_DP_SELECT_WRITES);
+	queue->access(ADIV5_LOW_WRITE, ADIV5_DP_SELECT, (uint32_t)ap->apsel << 24U);
+	stats_increment(STATS_AP_CSW_WRITES);
+	queue->access(ADIV5_LOW_WRITE, ADIV5_AP_CSW, ap_mem_access_csw(ap, align));
+	queue->access(ADIV5_LOW_WRITE, ADIV5_AP_TAR, addr);
+}
+
+static bool adiv5_swd_queue_mem_finish(const adiv5_swd_queue_s *const queue)
+{
+	/* Complete the batch by checking the last access made it and turning overrun detection back off */
+	queue->access(ADIV5_LOW_READ, ADIV5_DP_RDBUFF, 0U);
+	queue->access(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ);
+	return queue->run();
+}
+
+static void adiv5_swd_queue_recover(adiv5_debug_port_s *const dp)
+{
+	DEBUG_WARN("Queued SWD access failed, recovering and retrying\n");
+	/* Bring the link back into a known state, clear the sticky errors and disable overrun detection */
+	dp->error(dp, true);
+	adiv5_dp_write(dp, ADIV5_DP_CTRLSTAT, ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ);
+}
+
+static bool adiv5_swd_queue_read_chunk(const adiv5_swd_queue_s *const queue, adiv5_access_port_s *const ap,
+	uint8_t *const dest, const uint32_t src, const size_t len, const align_e align)
+{
+	const size_t count = len >> align;
+	adiv5_swd_queue_mem_setup(queue, ap, src, align);
+	size_t first_read = 0;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const size_t position = queue->access(ADIV5_LOW_READ, ADIV5_AP_DRW, 0U);
+		if (!idx)
+			first_read = position;
+	}
+	if (!adiv5_swd_queue_mem_finish(queue))
+		return false;
+
+	/* AP reads are posted, so the data for each access arrives with the next access */
+	uint8_t *data = dest;
+	for (size_t idx = 0; idx < count; ++idx)
+		data = adiv5_unpack_data(data, src + (idx << align), queue->read_value(first_read + idx + 1U), align);
+	return true;
+}
+
+void adiv5_swd_queue_mem_read(const adiv5_swd_queue_s *const queue, adiv5_access_port_s *const ap, void *const dest,
+	const uint32_t src, const size_t len)
+{
+	const align_e align = MIN(ALIGNOF(src), ALIGNOF(len));
+	uint8_t *const data = (uint8_t *)dest;
+	for (size_t offset = 0; offset < len;) {
+		const size_t chunk = adiv5_swd_queue_chunk_length(queue, src + offset, len - offset, align);
+		if (ap->dp->fault || !adiv5_swd_queue_read_chunk(queue, ap, data + offset, src + offset, chunk, align)) {
+			if (!ap->dp->fault)
+				adiv5_swd_queue_recover(ap->dp);
+			advi5_mem_read_bytes(ap, data + offset, src + offset, chunk);
+		}
+		offset += chunk;
+	}
+}
+
+static bool adiv5_swd_queue_write_chunk(const adiv5_swd_queue_s *const queue, adiv5_access_port_s *const ap,
+	const uint32_t dest, const uint8_t *const src, const size_t len, const align_e align)
+{
+	const size_t count = len >> align;
+	adiv5_swd_queue_mem_setup(queue, ap, dest, align);
+	const uint8_t *data = src;
+	for (size_t idx = 0; idx < count; ++idx) {
+		uint32_t value = 0;
+		data = adiv5_pack_data(dest + (idx << align), data, &value, align);
+		queue->access(ADIV5_LOW_WRITE, ADIV5_AP_DRW, value);
+	}
+	return adiv5_swd_queue_mem_finish(queue);
+}
+
+void adiv5_swd_queue_mem_write(const adiv5_swd_queue_s *const queue, adiv5_access_port_s *const ap,
+	const uint32_t dest, const void *const src, const size_t len, const align_e align)
+{
+	const uint8_t *const data = (const uint8_t *)src;
+	for (size_t offset = 0; offset < len;) {
+		const size_t chunk = adiv5_swd_queue_chunk_length(queue, dest + offset, len - offset, align);
+		if (ap->dp->fault || !adiv5_swd_queue_write_chunk(queue, ap, dest + offset, data + offset, chunk, align)) {
+			if (!ap->dp->fault)
+				adiv5_swd_queue_recover(ap->dp);
+			adiv5_mem_write_bytes(ap, dest + offset, data + offset, chunk, align);
+		}
+		offset += chunk;
+	}
+}
+#endif
+
 void firmware_ap_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value)
 {
+	stats_increment(STATS_DP_SELECT_WRITES);
 	adiv5_dp_recoverable_access(
 		ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
 	adiv5_dp_write(ap->dp, addr, value);
@@ -1133,6 +1257,7 @@ void firmware_ap_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value)
 uint32_t firmware_ap_read(adiv5_access_port_s *ap, uint16_t addr)
 {
 	uint32_t ret;
+	stats_increment(STATS_DP_SELECT_WRITES);
 	adiv5_dp_recoverable_access(
 		ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
 	ret = adiv5_dp_read(ap->dp, addr);
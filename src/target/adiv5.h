@@ -24,6 +24,7 @@
 #include "general.h"
 #include "jtag_scan.h"
 #include "swd.h"
+#include "stats.h"
 
 #if PC_HOSTED == 1
 #include "platform.h"
@@ -299,6 +300,8 @@ static inline uint32_t adiv5_ap_read(adiv5_access_port_s *ap, uint16_t addr)
 
 static inline void adiv5_ap_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value)
 {
+	if (addr == ADIV5_AP_CSW)
+		stats_increment(STATS_AP_CSW_WRITES);
 	return ap->dp->ap_write(ap, addr, value);
 }
 
@@ -315,6 +318,8 @@ static inline void adiv5_mem_write_sized(
 
 static inline void adiv5_dp_write(adiv5_debug_port_s *dp, uint16_t addr, uint32_t value)
 {
+	if (addr == ADIV5_DP_SELECT)
+		stats_increment(STATS_DP_SELECT_WRITES);
 	dp->low_access(dp, ADIV5_LOW_WRITE, addr, value);
 }
 
@@ -357,6 +362,23 @@ void adiv5_jtag_dp_handler(uint8_t jd_index);
 #if PC_HOSTED == 1
 void bmda_jtag_dp_init(adiv5_debug_port_s *dp);
 bool bmda_swd_dp_init(adiv5_debug_port_s *dp);
+
+/* Wire level operations of an adaptor that can batch up SWD accesses for queued memory access */
+typedef struct adiv5_swd_queue {
+	/* Maximum number of data phases (DRW accesses) in a batch, not counting the 6 housekeeping accesses */
+	size_t data_max;
+	/* Append an access to the current batch, returning its index within the batch */
+	size_t (*access)(uint8_t rnw, uint16_t addr, uint32_t value);
+	/* Run the batch, returning true only if every access was ACKed OK and every read passed its parity check */
+	bool (*run)(void);
+	/* Fetch the result of the read at the given index of the last batch run */
+	uint32_t (*read_value)(size_t idx);
+} adiv5_swd_queue_s;
+
+void adiv5_swd_queue_mem_read(
+	const adiv5_swd_queue_s *queue, adiv5_access_port_s *ap, void *dest, uint32_t src, size_t len);
+void adiv5_swd_queue_mem_write(
+	const adiv5_swd_queue_s *queue, adiv5_access_port_s *ap, uint32_t dest, const void *src, size_t len, align_e align);
 #endif
 
 void adiv5_mem_write(adiv5_access_port_s *ap, uint32_t dest, const void *src, size_t len);
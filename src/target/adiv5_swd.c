@@ -264,9 +264,13 @@ uint32_t firmware_swdp_low_access(adiv5_debug_port_s *dp, const uint8_t RnW, con
 	platform_timeout_s timeout;
 	platform_timeout_set(&timeout, 250U);
 	do {
+		stats_increment(STATS_SWD_TRANSACTIONS);
 		swd_proc.seq_out(request, 8U);
 		ack = swd_proc.seq_in(3U);
-		if (ack == SWDP_ACK_FAULT) {
+		if (ack == SWDP_ACK_WAIT)
+			stats_increment(STATS_SWD_WAIT_RETRIES);
+		else if (ack == SWDP_ACK_FAULT) {
+			stats_increment(STATS_SWD_FAULT_RETRIES);
 			DEBUG_ERROR("SWD access resulted in fault, retrying\n");
 			/* On fault, abort the request and repeat */
 			/* Yes, this is self-recursive.. no, we can't think of a better option */
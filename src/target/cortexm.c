@@ -40,6 +40,7 @@
 #include "gdb_packet.h"
 #include "semihosting.h"
 #include "platform.h"
+#include "profile.h"
 
 #include <string.h>
 #include <assert.h>
@@ -70,12 +71,19 @@
 #endif
 
 static bool cortexm_vector_catch(target_s *t, int argc, const char **argv);
+static bool cortexm_profile(target_s *t, int argc, const char **argv);
 #if PC_HOSTED == 0
 static bool cortexm_redirect_stdout(target_s *t, int argc, const char **argv);
 #endif
 
 const command_s cortexm_cmd_list[] = {
 	{"vector_catch", cortexm_vector_catch, "Catch exception vectors"},
+#if PC_HOSTED == 1
+	{"profile", cortexm_profile,
+		"Sample the PC while running: [start [RATE_HZ] [LOW_PC HIGH_PC]|stop|flat [COUNT]|gmon FILE]"},
+#else
+	{"profile", cortexm_profile, "Sample the PC while running: [start [RATE_HZ] [LOW_PC HIGH_PC]|stop|flat [COUNT]]"},
+#endif
 #if PC_HOSTED == 0
 	{"redirect_stdout", cortexm_redirect_stdout, "Redirect semihosting stdout to USB UART"},
 #endif
@@ -1232,7 +1240,11 @@ static int cortexm_fault_unwind(target_s *t)
 	return 0;
 }
 
-bool cortexm_run_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+/*
+ * Set up the registers for a stub loaded at loadaddr and set it running, without waiting for it.
+ * This allows the caller to overlap work (such as staging the next buffer) with the stub's execution.
+ */
+bool cortexm_start_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
 {
 	uint32_t regs[t->regs_size / 4U];
 
@@ -1251,14 +1263,19 @@ bool cortexm_run_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1,
 		return false;
 
 	/* Execute the stub */
-	target_halt_reason_e reason = TARGET_HALT_RUNNING;
-#if defined(PLATFORM_HAS_DEBUG)
-	uint32_t arm_regs_start[t->regs_size];
-	target_regs_read(t, arm_regs_start);
-#endif
 	cortexm_halt_resume(t, 0);
+	return true;
+}
+
+/*
+ * Wait for a stub started with cortexm_start_stub() to hit its exit breakpoint.
+ * Returns the breakpoint's immediate (the stub's exit code), or -1 if the stub hung or faulted.
+ */
+int cortexm_wait_stub(target_s *t, uint32_t timeout_ms)
+{
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
 	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 5000);
+	platform_timeout_set(&timeout, timeout_ms);
 	while (reason == TARGET_HALT_RUNNING) {
 		if (platform_timeout_is_expired(&timeout)) {
 			cortexm_halt_request(t);
@@ -1267,9 +1284,9 @@ bool cortexm_run_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1,
 			uint32_t arm_regs[t->regs_size];
 			target_regs_read(t, arm_regs);
 			for (uint32_t i = 0; i < 20U; ++i)
-				DEBUG_WARN("%2" PRIu32 ": %08" PRIx32 ", %08" PRIx32 "\n", i, arm_regs_start[i], arm_regs[i]);
+				DEBUG_WARN("%2" PRIu32 ": %08" PRIx32 "\n", i, arm_regs[i]);
 #endif
-			return false;
+			return -1;
 		}
 		reason = cortexm_halt_poll(t, NULL);
 	}
@@ -1279,17 +1296,24 @@ bool cortexm_run_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1,
 
 	if (reason != TARGET_HALT_BREAKPOINT) {
 		DEBUG_WARN(" Reason %d\n", reason);
-		return false;
+		return -1;
 	}
 
 	uint32_t pc = cortexm_pc_read(t);
 	uint16_t bkpt_instr = target_mem_read16(t, pc);
 	if (bkpt_instr >> 8U != 0xbeU)
-		return false;
+		return -1;
 
 	return bkpt_instr & 0xffU;
 }
 
+bool cortexm_run_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+{
+	if (!cortexm_start_stub(t, loadaddr, r0, r1, r2, r3))
+		return false;
+	return cortexm_wait_stub(t, 5000) > 0;
+}
+
 /*
  * The following routines implement hardware breakpoints and watchpoints.
  * The Flash Patch and Breakpoint (FPB) and Data Watch and Trace (DWT)
@@ -1452,6 +1476,113 @@ static bool cortexm_vector_catch(target_s *t, int argc, const char **argv)
 	return true;
 }
 
+#define CORTEXM_PROFILE_DEFAULT_RATE 1000U
+#define CORTEXM_PROFILE_DEFAULT_BINS 20U
+
+static bool cortexm_profile_sample(target_s *const t, uint32_t *const pc)
+{
+	const uint32_t pcsr = target_mem_read32(t, CORTEXM_DWT_PCSR);
+	/* PCSR reads as all ones while the core is halted or otherwise has no sample to offer */
+	if (target_check_error(t) || pcsr == UINT32_MAX)
+		return false;
+	*pc = pcsr;
+	return true;
+}
+
+/*
+ * Default to the Flash holding the vector table, which is where the code usually lives, along with any
+ * regions directly adjoining it (the sector groups of parts like the STM32F4 are each their own region).
+ * target_add_flash() prepends, so the first region in the list is just the last one added - the UICR
+ * on nRF51 parts, for instance - and is no good as a default.
+ */
+static void cortexm_profile_default_range(target_s *const t, uint32_t *const low_pc, uint32_t *const high_pc)
+{
+	uint32_t vtor = target_mem_read32(t, CORTEXM_VTOR);
+	if (target_check_error(t))
+		vtor = UINT32_MAX;
+	const target_flash_s *base = NULL;
+	for (const target_flash_s *flash = t->flash; flash; flash = flash->next) {
+		if (vtor >= flash->start && vtor - flash->start < flash->length) {
+			base = flash;
+			break;
+		}
+		/* If the vector table isn't in Flash (running from RAM), fall back on the lowest region */
+		if (!base || flash->start < base->start)
+			base = flash;
+	}
+
+	*low_pc = base->start;
+	*high_pc = base->start + base->length;
+	for (bool grown = true; grown;) {
+		grown = false;
+		for (const target_flash_s *flash = t->flash; flash; flash = flash->next) {
+			if (flash->start == *high_pc) {
+				*high_pc += flash->length;
+				grown = true;
+			} else if (flash->start + flash->length == *low_pc) {
+				*low_pc = flash->start;
+				grown = true;
+			}
+		}
+	}
+}
+
+static bool cortexm_profile(target_s *t, int argc, const char **argv)
+{
+	if (argc == 1) {
+		const profile_info_s *const info = profile_info();
+		tc_printf(t, "Profiling: %s, %" PRIu32 " samples (%" PRIu32 " idle, %" PRIu32 " outside 0x%08" PRIx32
+					 "-0x%08" PRIx32 ") over %" PRIu32 "ms\n",
+			info->running ? "running" : "stopped", info->samples, info->idle, info->outside, info->low_pc,
+			info->high_pc, info->elapsed_ms);
+		return true;
+	}
+
+	if (!strcmp(argv[1], "start")) {
+		/* DWT_PCSR is optional on ARMv6-M and no parts we know of implement it */
+		if (t->target_options & TOPT_FLAVOUR_V6M) {
+			tc_printf(t, "PC sampling requires an ARMv7-M or later core\n");
+			return false;
+		}
+		const uint32_t rate = argc > 2 ? strtoul(argv[2], NULL, 0) : CORTEXM_PROFILE_DEFAULT_RATE;
+		uint32_t low_pc = 0;
+		uint32_t high_pc = 0;
+		if (argc > 4) {
+			low_pc = strtoul(argv[3], NULL, 0);
+			high_pc = strtoul(argv[4], NULL, 0);
+		} else if (t->flash)
+			cortexm_profile_default_range(t, &low_pc, &high_pc);
+		if (!profile_start(t, cortexm_profile_sample, rate, low_pc, high_pc)) {
+			tc_printf(t, "Failed to start profiling, check the address range\n");
+			return false;
+		}
+		const profile_info_s *const info = profile_info();
+		tc_printf(t,
+			"Profiling 0x%08" PRIx32 "-0x%08" PRIx32 " in %" PRIu32 " byte bins, continue to collect samples\n",
+			info->low_pc, info->high_pc, info->bin_size);
+	} else if (!strcmp(argv[1], "stop"))
+		profile_stop();
+	else if (!strcmp(argv[1], "flat"))
+		profile_report_flat(argc > 2 ? strtoul(argv[2], NULL, 0) : CORTEXM_PROFILE_DEFAULT_BINS);
+#if PC_HOSTED == 1
+	else if (!strcmp(argv[1], "gmon") && argc > 2) {
+		if (!profile_write_gmon(argv[2])) {
+			tc_printf(t, "Failed to write profile to %s\n", argv[2]);
+			return false;
+		}
+	}
+#endif
+	else {
+		tc_printf(t, "usage: monitor profile [start [RATE_HZ] [LOW_PC HIGH_PC]|stop|flat [COUNT]"
+#if PC_HOSTED == 1
+					 "|gmon FILE"
+#endif
+					 "]\n");
+		return false;
+	}
+	return true;
+}
+
 #if PC_HOSTED == 0
 static bool cortexm_redirect_stdout(target_s *t, int argc, const char **argv)
 {
@@ -1486,6 +1617,59 @@ static void probe_mem_write(
 }
 #endif
 
+/*
+ * Semihosted console output is read out of target memory in aligned chunks, so a string read never strays
+ * past the block its terminator is in, and handed straight to the console - GDB's as 'O' packets, or the
+ * USB UART when stdout is redirected. The target is then resumed without a File-I/O round trip through GDB.
+ */
+#define CORTEXM_SEMIHOSTING_CONSOLE_CHUNK 64U
+
+static void cortexm_semihosting_console_out(target_s *const t, const char *const data, const size_t len)
+{
+#if PC_HOSTED == 1
+	(void)t;
+	fwrite(data, 1U, len, stderr);
+#else
+	if (t->stdout_redirected)
+		debug_serial_send_stdout((const uint8_t *)data, len);
+	else
+		gdb_out_buf(data, len);
+#endif
+}
+
+#if PC_HOSTED == 0
+static bool cortexm_semihosting_console_write(target_s *const t, target_addr_t addr, size_t len)
+{
+	char chunk[CORTEXM_SEMIHOSTING_CONSOLE_CHUNK];
+	while (len) {
+		const size_t amount = MIN(len, sizeof(chunk));
+		if (target_mem_read(t, chunk, addr, amount))
+			return false;
+		cortexm_semihosting_console_out(t, chunk, amount);
+		addr += amount;
+		len -= amount;
+	}
+	return true;
+}
+#endif
+
+static bool cortexm_semihosting_console_write0(target_s *const t, target_addr_t addr)
+{
+	char chunk[CORTEXM_SEMIHOSTING_CONSOLE_CHUNK];
+	while (true) {
+		const size_t amount = sizeof(chunk) - (addr & (sizeof(chunk) - 1U));
+		if (target_mem_read(t, chunk, addr, amount))
+			return false;
+		const char *const end = memchr(chunk, '\0', amount);
+		const size_t length = end ? (size_t)(end - chunk) : amount;
+		if (length)
+			cortexm_semihosting_console_out(t, chunk, length);
+		if (end)
+			return true;
+		addr += amount;
+	}
+}
+
 static int cortexm_hostio_request(target_s *t)
 {
 	uint32_t arm_regs[t->regs_size];
@@ -1626,12 +1810,7 @@ static int cortexm_hostio_request(target_s *t)
 		target_addr_t str_addr = arm_regs[1];
 		if (str_addr == TARGET_NULL)
 			break;
-		while (true) {
-			const uint8_t str_c = target_mem_read8(t, str_addr++);
-			if (target_check_error(t) || str_c == 0x00)
-				break;
-			fputc(str_c, stderr);
-		}
+		cortexm_semihosting_console_write0(t, str_addr);
 		ret = 0;
 		break;
 	}
@@ -1820,31 +1999,21 @@ static int cortexm_hostio_request(target_s *t)
 			ret = params[2] - ret;
 		break;
 	case SEMIHOSTING_SYS_WRITE: /* write */
+		/* Writes to the console take the fast path, everything else is File-I/O */
+		if (params[0] - 1U == STDOUT_FILENO || params[0] - 1U == STDERR_FILENO) {
+			ret = cortexm_semihosting_console_write(t, params[1], params[2]) ? 0 : -1;
+			break;
+		}
 		ret = tc_write(t, params[0] - 1, params[1], params[2]);
 		if (ret >= 0)
 			ret = params[2] - ret;
 		break;
 	case SEMIHOSTING_SYS_WRITEC: /* writec */
-		ret = tc_write(t, STDERR_FILENO, arm_regs[1], 1);
+		ret = cortexm_semihosting_console_write(t, arm_regs[1], 1U) ? 0 : -1;
 		break;
-	case SEMIHOSTING_SYS_WRITE0: { /* write0 */
-		ret = -1;
-		target_addr_t str_begin = arm_regs[1];
-		target_addr_t str_end = str_begin;
-		while (target_mem_read8(t, str_end) != 0) {
-			if (target_check_error(t))
-				break;
-			str_end++;
-		}
-		int len = str_end - str_begin;
-		if (len != 0) {
-			int rc = tc_write(t, STDERR_FILENO, str_begin, len);
-			if (rc != len)
-				break;
-		}
-		ret = 0;
+	case SEMIHOSTING_SYS_WRITE0: /* write0 */
+		ret = cortexm_semihosting_console_write0(t, arm_regs[1]) ? 0 : -1;
 		break;
-	}
 	case SEMIHOSTING_SYS_ISTTY: /* isatty */
 		ret = tc_isatty(t, params[0] - 1);
 		break;
@@ -30,6 +30,7 @@ extern unsigned cortexm_wait_timeout;
 #define CORTEXM_SCS_BASE (CORTEXM_PPB_BASE + 0xe000U)
 
 #define CORTEXM_CPUID (CORTEXM_SCS_BASE + 0xd00U)
+#define CORTEXM_VTOR  (CORTEXM_SCS_BASE + 0xd08U)
 #define CORTEXM_AIRCR (CORTEXM_SCS_BASE + 0xd0cU)
 #define CORTEXM_CFSR  (CORTEXM_SCS_BASE + 0xd28U)
 #define CORTEXM_HFSR  (CORTEXM_SCS_BASE + 0xd2cU)
@@ -61,6 +62,7 @@ extern unsigned cortexm_wait_timeout;
 #define CORTEXM_DWT_BASE (CORTEXM_PPB_BASE + 0x1000U)
 
 #define CORTEXM_DWT_CTRL    (CORTEXM_DWT_BASE + 0x000U)
+#define CORTEXM_DWT_PCSR    (CORTEXM_DWT_BASE + 0x01cU)
 #define CORTEXM_DWT_COMP(i) (CORTEXM_DWT_BASE + 0x020U + (0x10U * (i)))
 #define CORTEXM_DWT_MASK(i) (CORTEXM_DWT_BASE + 0x024U + (0x10U * (i)))
 #define CORTEXM_DWT_FUNC(i) (CORTEXM_DWT_BASE + 0x028U + (0x10U * (i)))
@@ -194,6 +196,8 @@ bool cortexm_attach(target_s *t);
 void cortexm_detach(target_s *t);
 void cortexm_halt_resume(target_s *t, bool step);
 bool cortexm_run_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+bool cortexm_start_stub(target_s *t, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+int cortexm_wait_stub(target_s *t, uint32_t timeout_ms);
 int cortexm_mem_write_sized(target_s *t, target_addr_t dest, const void *src, size_t len, align_e align);
 
 /* This is only for the ADIv5 implementation's use, do not call. */
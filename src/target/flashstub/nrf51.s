@@ -0,0 +1,69 @@
+@ This file is part of the Black Magic Debug project.
+@
+@ Copyright (C) 2026 agent <agent@local>
+@
+@ This program is free software: you can redistribute it and/or modify
+@ it under the terms of the GNU General Public License as published by
+@ the Free Software Foundation, either version 3 of the License, or
+@ (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+@
+@ You should have received a copy of the GNU General Public License
+@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+@
+@ NVMC Flash stub for the nRF51 and nRF52 parts. Written for ARMv6-M so it runs on both.
+@
+@ r0 = destination address, r1 = source buffer in SRAM, r2 = length,
+@ r3 = non-zero to skip words that are entirely erased, zero to copy every word
+@
+@ Programs (or copies, when the destination is SRAM) a word at a time across any
+@ number of pages, waiting for the NVMC to become ready and reading back each word.
+@ Exits with bkpt #0 on success, and bkpt #1 if a word did not read back as written.
+
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+
+	.equ NVMC_READY, 0x4001e400
+
+	.text
+	.global nrf51_flash_stub
+	.thumb_func
+nrf51_flash_stub:
+	ldr r7, =NVMC_READY
+	movs r6, #0
+	mvns r6, r6
+
+word:
+	cmp r2, #0
+	beq done
+	ldmia r1!, {r4}
+	@ Skip words that are entirely erased, if asked to
+	cmp r4, r6
+	bne program
+	cmp r3, #0
+	bne next
+program:
+	str r4, [r0]
+wait:
+	ldr r5, [r7]
+	cmp r5, #0
+	beq wait
+	ldr r5, [r0]
+	cmp r5, r4
+	bne error
+next:
+	adds r0, #4
+	subs r2, #4
+	b word
+
+done:
+	bkpt #0
+error:
+	bkpt #1
+
+	.pool
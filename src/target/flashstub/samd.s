@@ -0,0 +1,135 @@
+@ This file is part of the Black Magic Debug project.
+@
+@ Copyright (C) 2026 agent <agent@local>
+@
+@ This program is free software: you can redistribute it and/or modify
+@ it under the terms of the GNU General Public License as published by
+@ the Free Software Foundation, either version 3 of the License, or
+@ (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+@
+@ You should have received a copy of the GNU General Public License
+@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+@
+@ NVMCTRL Flash stub for the SAM D09/D1x/D2x/L2x parts.
+@
+@ r0 = Flash address, r1 = source buffer in SRAM (or 0 to erase), r2 = length
+@
+@ Erases whole rows, or writes whole pages, unlocking the region before each
+@ command and re-locking it after. Pages that are entirely 0xff are skipped so
+@ the driver can hand over write buffers larger than an erase row.
+@ Exits with bkpt #0 on success, and bkpt #1 if NVMCTRL reports an error.
+
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+
+	.equ NVMC_BASE, 0x41004000
+	.equ NVMC_CTRLA, 0x00
+	.equ NVMC_INTFLAG, 0x14
+	.equ NVMC_STATUS, 0x18
+	.equ NVMC_ADDR, 0x1c
+
+	.equ CMD_KEY, 0xa500
+	.equ CMD_ERASEROW, 0x02
+	.equ CMD_WRITEPAGE, 0x04
+	.equ CMD_LOCK, 0x40
+	.equ CMD_UNLOCK, 0x41
+
+	.equ INTFLAG_READY, 0x01
+	.equ STATUS_ERRORS, 0x1c
+	.equ PAGE_SIZE, 64
+	.equ ROW_SIZE, 256
+
+	.text
+	.global samd_flash_stub
+	.thumb_func
+samd_flash_stub:
+	ldr r4, =NVMC_BASE
+	ldr r5, =CMD_KEY
+	@ Clear any errors left over from before we were called
+	movs r3, #STATUS_ERRORS
+	strh r3, [r4, #NVMC_STATUS]
+	cmp r1, #0
+	beq erase
+
+write:
+	cmp r2, #0
+	beq done
+	@ Skip pages that are entirely erased
+	movs r6, #0
+check:
+	ldr r3, [r1, r6]
+	adds r3, #1
+	bne program
+	adds r6, #4
+	cmp r6, #PAGE_SIZE
+	bne check
+	adds r0, #PAGE_SIZE
+	adds r1, #PAGE_SIZE
+	subs r2, #PAGE_SIZE
+	b write
+
+program:
+	@ Fill the page buffer, which also loads the page's address into ADDR
+	movs r6, #0
+fill:
+	ldr r3, [r1, r6]
+	str r3, [r0, r6]
+	adds r6, #4
+	cmp r6, #PAGE_SIZE
+	bne fill
+	movs r3, #CMD_UNLOCK
+	bl command
+	movs r3, #CMD_WRITEPAGE
+	bl command
+	movs r3, #CMD_LOCK
+	bl command
+	adds r0, #PAGE_SIZE
+	adds r1, #PAGE_SIZE
+	subs r2, #PAGE_SIZE
+	b write
+
+erase:
+	cmp r2, #0
+	beq done
+	@ ADDR takes a 16-bit word address
+	lsrs r3, r0, #1
+	str r3, [r4, #NVMC_ADDR]
+	movs r3, #CMD_UNLOCK
+	bl command
+	movs r3, #CMD_ERASEROW
+	bl command
+	movs r3, #CMD_LOCK
+	bl command
+	movs r3, #1
+	lsls r3, #8
+	adds r0, r3
+	subs r2, r3
+	b erase
+
+done:
+	bkpt #0
+error:
+	bkpt #1
+
+@ Issue the command in r3, wait for NVMCTRL to become ready again and check for errors
+	.thumb_func
+command:
+	orrs r3, r5
+	str r3, [r4, #NVMC_CTRLA]
+wait:
+	ldrb r3, [r4, #NVMC_INTFLAG]
+	lsrs r3, r3, #1
+	bcc wait
+	ldrh r3, [r4, #NVMC_STATUS]
+	movs r6, #STATUS_ERRORS
+	tst r3, r6
+	bne error
+	bx lr
+
+	.pool
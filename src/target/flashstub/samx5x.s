@@ -0,0 +1,114 @@
+@ This file is part of the Black Magic Debug project.
+@
+@ Copyright (C) 2026 agent <agent@local>
+@
+@ This program is free software: you can redistribute it and/or modify
+@ it under the terms of the GNU General Public License as published by
+@ the Free Software Foundation, either version 3 of the License, or
+@ (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+@
+@ You should have received a copy of the GNU General Public License
+@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+@
+@ NVMCTRL Flash stub for the SAM D5x/E5x parts.
+@
+@ r0 = Flash address, r1 = source buffer in SRAM, r2 = length
+@
+@ Writes whole pages, unlocking the region before each command and re-locking
+@ it after. Pages that are entirely 0xff are skipped so the driver can hand
+@ over write buffers larger than a page. Block erases stay host-driven.
+@ Exits with bkpt #0 on success, and bkpt #1 if NVMCTRL reports an error.
+
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+
+	.equ NVMC_BASE, 0x41004000
+	.equ NVMC_CTRLB, 0x04
+	.equ NVMC_INTFLAG, 0x10
+	.equ NVMC_STATUS, 0x12
+	.equ NVMC_ADDRESS, 0x14
+
+	.equ CMD_KEY, 0xa500
+	.equ CMD_WRITEPAGE, 0x03
+	.equ CMD_LOCK, 0x11
+	.equ CMD_UNLOCK, 0x12
+
+	.equ STATUS_READY, 0x01
+	@ ADDRE | PROGE | LOCKE | NVME
+	.equ INTFLAG_ERRORS, 0x4e
+
+	.text
+	.global samx5x_flash_stub
+	.thumb_func
+samx5x_flash_stub:
+	ldr r4, =NVMC_BASE
+	ldr r5, =CMD_KEY
+	@ r7 holds the page size (512) throughout
+	movs r7, #1
+	lsls r7, #9
+	@ Clear any errors left over from before we were called
+	movs r3, #INTFLAG_ERRORS
+	strh r3, [r4, #NVMC_INTFLAG]
+
+write:
+	cmp r2, #0
+	beq done
+	@ Skip pages that are entirely erased
+	movs r6, #0
+check:
+	ldr r3, [r1, r6]
+	adds r3, #1
+	bne program
+	adds r6, #4
+	cmp r6, r7
+	bne check
+	b next_page
+
+program:
+	str r0, [r4, #NVMC_ADDRESS]
+	movs r3, #CMD_UNLOCK
+	bl command
+	movs r6, #0
+fill:
+	ldr r3, [r1, r6]
+	str r3, [r0, r6]
+	adds r6, #4
+	cmp r6, r7
+	bne fill
+	movs r3, #CMD_WRITEPAGE
+	bl command
+	movs r3, #CMD_LOCK
+	bl command
+next_page:
+	adds r0, r7
+	adds r1, r7
+	subs r2, r7
+	b write
+
+done:
+	bkpt #0
+error:
+	bkpt #1
+
+@ Issue the command in r3, wait for NVMCTRL to become ready again and check for errors
+	.thumb_func
+command:
+	orrs r3, r5
+	str r3, [r4, #NVMC_CTRLB]
+wait:
+	ldrh r3, [r4, #NVMC_STATUS]
+	lsrs r3, r3, #1
+	bcc wait
+	ldrh r3, [r4, #NVMC_INTFLAG]
+	movs r6, #INTFLAG_ERRORS
+	tst r3, r6
+	bne error
+	bx lr
+
+	.pool
@@ -0,0 +1,81 @@
+@ This file is part of the Black Magic Debug project.
+@
+@ Copyright (C) 2026 agent <agent@local>
+@
+@ This program is free software: you can redistribute it and/or modify
+@ it under the terms of the GNU General Public License as published by
+@ the Free Software Foundation, either version 3 of the License, or
+@ (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+@
+@ You should have received a copy of the GNU General Public License
+@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+@
+@ FPEC Flash stub for the STM32F0, STM32F1 and STM32F3 parts and the GD32, AT32,
+@ CH32 and MM32 clones thereof. Written for ARMv6-M so it runs on all of them.
+@
+@ r0 = Flash address, r1 = source buffer in SRAM, r2 = length,
+@ r3 = FPEC base address for the bank being written
+@
+@ Programs a halfword at a time, skipping halfwords that are already erased.
+@ Exits with bkpt #0 on success, and bkpt #1 if the FPEC reports an error.
+
+	.syntax unified
+	.cpu cortex-m0
+	.thumb
+
+	.equ FLASH_SR, 0x0c
+	.equ FLASH_CR, 0x10
+
+	.equ CR_PG, 0x01
+	.equ SR_BSY, 0x01
+	.equ SR_ERRORS, 0x14
+	.equ SR_CLEAR, 0x34
+
+	.text
+	.global stm32f1_flash_stub
+	.thumb_func
+stm32f1_flash_stub:
+	@ Clear any errors and the end of operation flag left over from before we were called
+	movs r4, #SR_CLEAR
+	str r4, [r3, #FLASH_SR]
+	movs r4, #CR_PG
+	str r4, [r3, #FLASH_CR]
+	ldr r7, =0xffff
+	movs r6, #SR_ERRORS
+
+halfword:
+	cmp r2, #0
+	beq done
+	ldrh r4, [r1]
+	adds r1, #2
+	@ Skip halfwords that are entirely erased
+	cmp r4, r7
+	beq next
+	strh r4, [r0]
+	@ Wait for the FPEC to finish programming and check for errors
+wait:
+	ldr r5, [r3, #FLASH_SR]
+	lsrs r4, r5, #1
+	bcs wait
+	tst r5, r6
+	bne error
+next:
+	adds r0, #2
+	subs r2, #2
+	b halfword
+
+done:
+	movs r4, #0
+	str r4, [r3, #FLASH_CR]
+	bkpt #0
+error:
+	movs r4, #0
+	str r4, [r3, #FLASH_CR]
+	bkpt #1
+
+	.pool
@@ -0,0 +1,124 @@
+@ This file is part of the Black Magic Debug project.
+@
+@ Copyright (C) 2026 agent <agent@local>
+@
+@ This program is free software: you can redistribute it and/or modify
+@ it under the terms of the GNU General Public License as published by
+@ the Free Software Foundation, either version 3 of the License, or
+@ (at your option) any later version.
+@
+@ This program is distributed in the hope that it will be useful,
+@ but WITHOUT ANY WARRANTY; without even the implied warranty of
+@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+@ GNU General Public License for more details.
+@
+@ You should have received a copy of the GNU General Public License
+@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+@
+@ FPEC Flash stub for the STM32L4, L4+, G4, WB and WL parts.
+@
+@ r0 = Flash address, r1 = source buffer in SRAM, r2 = length,
+@ r3 = FPEC base address with the fast programming row size in bytes in its
+@      low 12 bits, or 0 there to use standard programming
+@
+@ Standard programming writes a double word at a time, skipping double words
+@ that are entirely 0xff. Fast programming (FSTPG) feeds whole rows to the FPEC
+@ back to back, skipping rows that are entirely 0xff, and requires the bank to
+@ have been mass erased beforehand.
+@ Exits with bkpt #0 on success, and bkpt #1 if the FPEC reports an error.
+
+	.syntax unified
+	.cpu cortex-m4
+	.thumb
+
+	.equ FLASH_SR, 0x10
+	.equ FLASH_CR, 0x14
+
+	.equ CR_PG, 0x00000001
+	.equ CR_FSTPG, 0x00040000
+	.equ SR_BSY, 0x00010000
+	.equ SR_ERRORS, 0x0000c3fa
+
+	.text
+	.global stm32l4_flash_stub
+	.thumb_func
+stm32l4_flash_stub:
+	@ A fast programming row fails if the Flash is read part way through, as fetching a vector would
+	cpsid i
+	ubfx r4, r3, #0, #12
+	bfc r3, #0, #12
+	@ Clear any errors left over from before we were called
+	ldr r6, =SR_ERRORS
+	str r6, [r3, #FLASH_SR]
+	cbz r4, standard
+
+	mov r5, #CR_FSTPG
+	str r5, [r3, #FLASH_CR]
+fast:
+	cbz r2, done
+	@ Skip rows that are entirely erased
+	movs r5, #0
+check:
+	ldr r7, [r1, r5]
+	adds r7, #1
+	bne row
+	adds r5, #4
+	cmp r5, r4
+	bne check
+	add r0, r4
+	add r1, r4
+	subs r2, r4
+	b fast
+
+row:
+	@ Feed the row in as consecutive double words, the FPEC programs it once the last one arrives
+	mov r5, r4
+copy:
+	ldmia r1!, {r7, r8}
+	str r7, [r0]
+	str r8, [r0, #4]
+	adds r0, #8
+	subs r5, #8
+	bne copy
+	subs r2, r4
+	bl wait
+	b fast
+
+standard:
+	movs r5, #CR_PG
+	str r5, [r3, #FLASH_CR]
+dword:
+	cbz r2, done
+	ldmia r1!, {r7, r8}
+	@ Skip double words that are entirely erased
+	and r5, r7, r8
+	adds r5, #1
+	beq skip
+	str r7, [r0]
+	str r8, [r0, #4]
+	bl wait
+skip:
+	adds r0, #8
+	subs r2, #8
+	b dword
+
+done:
+	movs r5, #0
+	str r5, [r3, #FLASH_CR]
+	bkpt #0
+error:
+	movs r5, #0
+	str r5, [r3, #FLASH_CR]
+	bkpt #1
+
+@ Wait for the FPEC to finish programming and check for errors
+	.thumb_func
+wait:
+	ldr r5, [r3, #FLASH_SR]
+	tst r5, #SR_BSY
+	bne wait
+	tst r5, r6
+	bne error
+	bx lr
+
+	.pool
@@ -973,6 +973,7 @@ static lpc43xx_partid_s lpc43xx_iap_read_partid(target_s *const t)
 	flash.iap_entry = target_mem_read32(t, IAP_ENTRYPOINT_LOCATION);
 	flash.iap_ram = IAP_RAM_BASE;
 	flash.iap_msp = IAP_RAM_BASE + IAP_RAM_SIZE;
+	flash.session = NULL;
 
 	/* Prepare a failure result in case readback fails */
 	lpc43xx_partid_s result;
@@ -39,6 +39,60 @@ typedef struct __attribute__((aligned(4))) iap_frame {
 	iap_result_s result;
 } iap_frame_s;
 
+/* One entry in a chain of IAP calls run by the session trampoline */
+typedef struct iap_call {
+	iap_config_s config;
+	iap_result_s result;
+} iap_call_s;
+
+/* Maximum number of write blocks staged in target RAM and programmed in a single core run */
+#define LPC_IAP_SESSION_MAX_BLOCKS 4U
+/* Stack space left for the IAP ROM below iap_msp when sizing the staging area */
+#define LPC_IAP_STACK_RESERVE 128U
+
+/*
+ * Thumb trampoline used to chain IAP calls in a single core run. On entry r0 holds the IAP entrypoint,
+ * r1 the address of an array of iap_call_s and r2 the number of entries in it. Each call is made in turn
+ * until one fails or the array is exhausted, at which point the breakpoint hands control back to us.
+ */
+static const uint16_t lpc_iap_trampoline[] = {
+	0x4604U,              /*       mov r4, r0 */
+	0x460dU,              /*       mov r5, r1 */
+	0x4616U,              /*       mov r6, r2 */
+	0x4628U,              /* loop: mov r0, r5 */
+	0x4629U,              /*       mov r1, r5 */
+	0x3114U,              /*       adds r1, #20 */
+	0x47a0U,              /*       blx r4 */
+	0x6968U,              /*       ldr r0, [r5, #20] */
+	0x2800U,              /*       cmp r0, #0 */
+	0xd102U,              /*       bne done */
+	0x3528U,              /*       adds r5, #40 */
+	0x3e01U,              /*       subs r6, #1 */
+	0xd1f5U,              /*       bne loop */
+	ARM_THUMB_BREAKPOINT, /* done: bkpt */
+};
+
+#define LPC_IAP_TRAMPOLINE_OFFSET ALIGN(sizeof(iap_frame_s), 4U)
+#define LPC_IAP_TRAMPOLINE_BREAK  (LPC_IAP_TRAMPOLINE_OFFSET + sizeof(lpc_iap_trampoline) - 2U)
+#define LPC_IAP_CHAIN_OFFSET      (LPC_IAP_TRAMPOLINE_OFFSET + sizeof(lpc_iap_trampoline))
+/* Size of the IAP RAM control area (frame, trampoline and call chain) for a given number of staged blocks */
+#define LPC_IAP_CONTROL_SIZE(blocks) (LPC_IAP_CHAIN_OFFSET + (2U * (blocks) * sizeof(iap_call_s)))
+
+/*
+ * A Flash prepare/done session. The IAP RAM control area and the target registers are saved once when the
+ * session starts and restored when it ends, and write blocks are staged into target RAM so they can be
+ * prepared and programmed as one chain of IAP calls.
+ */
+struct lpc_iap_session {
+	/* Number of blocks that can be staged at once, 0 if the staging area does not fit in IAP RAM */
+	uint8_t slots;
+	uint8_t queued;
+	uint32_t stage_addr;
+	iap_call_s chain[2U * LPC_IAP_SESSION_MAX_BLOCKS];
+	uint8_t saved_ram[LPC_IAP_CONTROL_SIZE(LPC_IAP_SESSION_MAX_BLOCKS)];
+	uint32_t saved_regs[];
+};
+
 #if defined(ENABLE_DEBUG)
 static const char *const iap_error[] = {
 	"CMD_SUCCESS",
@@ -79,6 +133,8 @@ static const char *const iap_error[] = {
 #endif
 
 static bool lpc_flash_write(target_flash_s *tf, target_addr_t dest, const void *src, size_t len);
+static bool lpc_flash_prepare(target_flash_s *tf);
+static bool lpc_flash_done(target_flash_s *tf);
 
 lpc_flash_s *lpc_add_flash(
 	target_s *const target, const target_addr_t addr, const size_t length, const size_t write_size)
@@ -94,6 +150,8 @@ lpc_flash_s *lpc_add_flash(
 	flash->length = length;
 	flash->erase = lpc_flash_erase;
 	flash->write = lpc_flash_write;
+	flash->prepare = lpc_flash_prepare;
+	flash->done = lpc_flash_done;
 	flash->erased = 0xff;
 	flash->writesize = write_size;
 	target_add_flash(target, flash);
@@ -144,6 +202,67 @@ static size_t lpc_iap_params(const iap_cmd_e cmd)
 	}
 }
 
+/*
+ * Run the target from the register state given until it halts again, and check that it did so on
+ * the breakpoint at halt_addr rather than due to a fault.
+ */
+static bool lpc_iap_execute(lpc_flash_s *const flash, const uint32_t *const regs, const uint32_t halt_addr,
+	const iap_cmd_e cmd, const bool full_erase)
+{
+	target_s *const target = flash->f.t;
+	target_regs_write(target, regs);
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	/* Start the target and wait for it to halt again */
+	target_halt_resume(target, false);
+	while (!target_halt_poll(target, NULL)) {
+		if (full_erase)
+			target_print_progress(&timeout);
+		/* If after 500ms we've been unable to complete a PartID command, error out */
+		else if (cmd == IAP_CMD_PARTID && platform_timeout_is_expired(&timeout)) {
+			target_halt_request(target);
+			return false;
+		}
+	}
+
+	/* Check if a fault occured while executing the call */
+	uint32_t status = 0;
+	target_reg_read(target, REG_XPSR, &status, sizeof(status));
+	if (status & CORTEXM_XPSR_EXCEPTION_MASK) {
+		/*
+		 * Read back the program counter to determine the fault address
+		 * (cortexm_fault_unwind puts the frame back in registers for us)
+		 */
+		uint32_t fault_address = 0;
+		target_reg_read(target, REG_PC, &fault_address, sizeof(fault_address));
+		/* Set the thumb bit in the address appropriately */
+		if (status & CORTEXM_XPSR_THUMB)
+			fault_address |= 1U;
+
+		/* If the fault is not because of our break instruction at the end of the IAP sequence */
+		if (fault_address != (halt_addr | 1U)) {
+			DEBUG_WARN("%s: Failure due to fault (%" PRIu32 ")\n", __func__, status & CORTEXM_XPSR_EXCEPTION_MASK);
+			DEBUG_WARN("\t-> Fault at %08" PRIx32 "\n", fault_address);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void lpc_iap_report(const iap_result_s *const results)
+{
+/* This guard block deals with the fact iap_error is only defined when ENABLE_DEBUG is */
+#if defined(ENABLE_DEBUG)
+	if (results->return_code < ARRAY_LENGTH(iap_error))
+		DEBUG_INFO("%s: result %s, ", __func__, iap_error[results->return_code]);
+	else
+		DEBUG_INFO("%s: result %" PRIu32 ", ", __func__, results->return_code);
+#endif
+	DEBUG_INFO("return values: %08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %08" PRIx32 "\n", results->values[0],
+		results->values[1], results->values[2], results->values[3]);
+}
+
 iap_status_e lpc_iap_call(lpc_flash_s *const flash, iap_result_s *const result, iap_cmd_e cmd, ...)
 {
 	target_s *const target = flash->f.t;
@@ -152,10 +271,15 @@ iap_status_e lpc_iap_call(lpc_flash_s *const flash, iap_result_s *const result,
 	if (flash->wdt_kick)
 		flash->wdt_kick(target);
 
-	/* Save IAP RAM and target regsiters to restore after IAP call */
+	/*
+	 * Save IAP RAM and target regsiters to restore after IAP call,
+	 * unless a Flash session already did this for us
+	 */
+	const bool save_state = flash->session == NULL;
 	iap_frame_s saved_frame;
 	uint32_t saved_regs[target->regs_size / sizeof(uint32_t)];
-	lpc_save_state(target, flash->iap_ram, &saved_frame, saved_regs);
+	if (save_state)
+		lpc_save_state(target, flash->iap_ram, &saved_frame, saved_regs);
 
 	/* Set up our IAP frame with the break opcode and command to run */
 	iap_frame_s frame = {
@@ -198,49 +322,16 @@ iap_status_e lpc_iap_call(lpc_flash_s *const flash, iap_result_s *const result,
 	regs[REG_PC] = flash->iap_entry;
 	/* Finally set up xPSR to indicate a suitable instruction mode, no fault */
 	regs[REG_XPSR] = (flash->iap_entry & 1U) ? CORTEXM_XPSR_THUMB : 0U;
-	target_regs_write(target, regs);
 
 	/* Figure out if we're about to execute a mass erase or not */
 	const bool full_erase =
 		cmd == IAP_CMD_ERASE && lpc_is_full_erase(flash, frame.config.params[0], frame.config.params[1]);
 
-	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 500);
-	/* Start the target and wait for it to halt again */
-	target_halt_resume(target, false);
-	while (!target_halt_poll(target, NULL)) {
-		if (full_erase)
-			target_print_progress(&timeout);
-		/* If after 500ms we've been unable to complete a PartID command, error out */
-		else if (cmd == IAP_CMD_PARTID && platform_timeout_is_expired(&timeout)) {
-			target_halt_request(target);
-			/* Restore the original data in RAM and registers */
+	/* Run the call, and if it didn't make it back to our breakpoint, restore the original state and bail */
+	if (!lpc_iap_execute(flash, regs, flash->iap_ram, cmd, full_erase)) {
+		if (save_state)
 			lpc_restore_state(target, flash->iap_ram, &saved_frame, saved_regs);
-			return IAP_STATUS_INVALID_COMMAND;
-		}
-	}
-
-	/* Check if a fault occured while executing the call */
-	uint32_t status = 0;
-	target_reg_read(target, REG_XPSR, &status, sizeof(status));
-	if (status & CORTEXM_XPSR_EXCEPTION_MASK) {
-		/*
-		 * Read back the program counter to determine the fault address
-		 * (cortexm_fault_unwind puts the frame back in registers for us)
-		 */
-		uint32_t fault_address = 0;
-		target_reg_read(target, REG_PC, &fault_address, sizeof(fault_address));
-		/* Set the thumb bit in the address appropriately */
-		if (status & CORTEXM_XPSR_THUMB)
-			fault_address |= 1U;
-
-		/* If the fault is not because of our break instruction at the end of the IAP sequence */
-		if (fault_address != (flash->iap_ram | 1U)) {
-			DEBUG_WARN("%s: Failure due to fault (%" PRIu32 ")\n", __func__, status & CORTEXM_XPSR_EXCEPTION_MASK);
-			DEBUG_WARN("\t-> Fault at %08" PRIx32 "\n", fault_address);
-			lpc_restore_state(target, flash->iap_ram, &saved_frame, saved_regs);
-			return IAP_STATUS_INVALID_COMMAND;
-		}
+		return IAP_STATUS_INVALID_COMMAND;
 	}
 
 	/* Copy back just the results */
@@ -248,25 +339,135 @@ iap_status_e lpc_iap_call(lpc_flash_s *const flash, iap_result_s *const result,
 	target_mem_read(target, &results, iap_results_addr, sizeof(iap_result_s));
 
 	/* Restore the original data in RAM and registers */
-	lpc_restore_state(target, flash->iap_ram, &saved_frame, saved_regs);
+	if (save_state)
+		lpc_restore_state(target, flash->iap_ram, &saved_frame, saved_regs);
 
 	/* If the user expected a result, set the result (16 bytes). */
 	if (result != NULL)
 		*result = results;
 
-/* This guard block deals with the fact iap_error is only defined when ENABLE_DEBUG is */
-#if defined(ENABLE_DEBUG)
-	if (results.return_code < ARRAY_LENGTH(iap_error))
-		DEBUG_INFO("%s: result %s, ", __func__, iap_error[results.return_code]);
-	else
-		DEBUG_INFO("%s: result %" PRIu32 ", ", __func__, results.return_code);
-#endif
-	DEBUG_INFO("return values: %08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %08" PRIx32 "\n", results.values[0],
-		results.values[1], results.values[2], results.values[3]);
-
+	lpc_iap_report(&results);
 	return results.return_code;
 }
 
+/* Run the chain of prepare and program calls for all blocks currently staged in the session */
+static bool lpc_iap_session_flush(lpc_flash_s *const flash)
+{
+	lpc_iap_session_s *const session = flash->session;
+	if (!session || !session->queued)
+		return true;
+	target_s *const target = flash->f.t;
+	const size_t calls = 2U * session->queued;
+	session->queued = 0;
+
+	/* Poke the WDT before running the chain, if it is on */
+	if (flash->wdt_kick)
+		flash->wdt_kick(target);
+
+	const uint32_t chain_addr = flash->iap_ram + LPC_IAP_CHAIN_OFFSET;
+	target_mem_write(target, chain_addr, session->chain, calls * sizeof(iap_call_s));
+
+	uint32_t regs[target->regs_size / sizeof(uint32_t)];
+	memset(regs, 0, target->regs_size);
+	/* The trampoline takes the IAP entrypoint (thumb mode), the chain and its length in r0-r2 */
+	regs[0] = flash->iap_entry | 1U;
+	regs[1] = chain_addr;
+	regs[2] = calls;
+	regs[REG_MSP] = flash->iap_msp;
+	regs[REG_LR] = (flash->iap_ram + LPC_IAP_TRAMPOLINE_BREAK) | 1U;
+	regs[REG_PC] = flash->iap_ram + LPC_IAP_TRAMPOLINE_OFFSET;
+	regs[REG_XPSR] = CORTEXM_XPSR_THUMB;
+
+	DEBUG_INFO("%s: running %zu IAP calls\n", __func__, calls);
+	if (!lpc_iap_execute(flash, regs, flash->iap_ram + LPC_IAP_TRAMPOLINE_BREAK, IAP_CMD_PROGRAM, false))
+		return false;
+
+	/* Read back the chain and check every call ran and succeeded */
+	target_mem_read(target, session->chain, chain_addr, calls * sizeof(iap_call_s));
+	for (size_t i = 0; i < calls; ++i) {
+		const iap_call_s *const call = &session->chain[i];
+		if (call->result.return_code != IAP_STATUS_CMD_SUCCESS) {
+			DEBUG_ERROR("%s: cmd %" PRIu32 " for %08" PRIx32 " failed\n", __func__, call->config.command,
+				call->config.params[0]);
+			lpc_iap_report(&call->result);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Stage a block into target RAM and queue the prepare and program calls needed to write it */
+static bool lpc_iap_session_queue(lpc_flash_s *const flash, const target_addr_t dest, const void *const src,
+	const size_t len)
+{
+	lpc_iap_session_s *const session = flash->session;
+	const uint32_t sector = lpc_sector_for_addr(flash, dest);
+	const uint32_t bufaddr = session->stage_addr + session->queued * flash->f.writesize;
+	target_mem_write(flash->f.t, bufaddr, src, len);
+
+	/* Set the result codes to something notable so we can tell if a call didn't run */
+	iap_call_s *const calls = &session->chain[2U * session->queued];
+	calls[0] = (iap_call_s){
+		.config = {.command = IAP_CMD_PREPARE, .params = {sector, sector, flash->bank}},
+		.result = {.return_code = IAP_CMD_PREPARE},
+	};
+	calls[1] = (iap_call_s){
+		.config = {.command = IAP_CMD_PROGRAM, .params = {dest, bufaddr, len, CPU_CLK_KHZ}},
+		.result = {.return_code = IAP_CMD_PROGRAM},
+	};
+
+	if (++session->queued == session->slots)
+		return lpc_iap_session_flush(flash);
+	return true;
+}
+
+static bool lpc_flash_prepare(target_flash_s *const tf)
+{
+	lpc_flash_s *const flash = (lpc_flash_s *)tf;
+	target_s *const target = tf->t;
+	lpc_iap_session_s *const session = calloc(1, sizeof(*session) + target->regs_size);
+	if (!session) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+
+	/* Work out how many write blocks we can stage between the control area and the IAP stack */
+	const uint32_t ram_size = flash->iap_msp - flash->iap_ram;
+	for (size_t slots = LPC_IAP_SESSION_MAX_BLOCKS; slots; --slots) {
+		const uint32_t stage_offset = ALIGN(LPC_IAP_CONTROL_SIZE(slots), 4U);
+		if (stage_offset + slots * tf->writesize + LPC_IAP_STACK_RESERVE <= ram_size) {
+			session->slots = slots;
+			session->stage_addr = flash->iap_ram + stage_offset;
+			break;
+		}
+	}
+
+	/* Save IAP RAM and target registers once for the whole session */
+	target_mem_read(target, session->saved_ram, flash->iap_ram, LPC_IAP_CONTROL_SIZE(session->slots));
+	target_regs_read(target, session->saved_regs);
+	if (session->slots)
+		target_mem_write(
+			target, flash->iap_ram + LPC_IAP_TRAMPOLINE_OFFSET, lpc_iap_trampoline, sizeof(lpc_iap_trampoline));
+	flash->session = session;
+	return true;
+}
+
+static bool lpc_flash_done(target_flash_s *const tf)
+{
+	lpc_flash_s *const flash = (lpc_flash_s *)tf;
+	lpc_iap_session_s *const session = flash->session;
+	if (!session)
+		return true;
+	const bool result = lpc_iap_session_flush(flash);
+
+	/* Restore the original data in RAM and registers */
+	target_mem_write(tf->t, flash->iap_ram, session->saved_ram, LPC_IAP_CONTROL_SIZE(session->slots));
+	target_regs_write(tf->t, session->saved_regs);
+	flash->session = NULL;
+	free(session);
+	return result;
+}
+
 #define LPX80X_SECTOR_SIZE 0x400U
 #define LPX80X_PAGE_SIZE   0x40U
 
@@ -313,16 +514,26 @@ bool lpc_flash_erase(target_flash_s *tf, target_addr_t addr, size_t len)
 static bool lpc_flash_write(target_flash_s *tf, target_addr_t dest, const void *src, size_t len)
 {
 	lpc_flash_s *f = (lpc_flash_s *)tf;
+	lpc_iap_session_s *const session = f->session;
+	/* Only LPC80x has reserved pages!*/
+	const bool whole_block = !f->reserved_pages || dest + len <= tf->length - len;
+	/* If we're in a Flash session with room to stage blocks, queue this one to be programmed in a batch */
+	if (session && session->slots && whole_block)
+		return lpc_iap_session_queue(f, dest, src, len);
+	/* Otherwise make sure any staged blocks are written before we reuse the staging area */
+	if (!lpc_iap_session_flush(f))
+		return false;
+
 	/* Prepare... */
 	const uint32_t sector = lpc_sector_for_addr(f, dest);
 	if (lpc_iap_call(f, NULL, IAP_CMD_PREPARE, sector, sector, f->bank) != IAP_STATUS_CMD_SUCCESS) {
 		DEBUG_ERROR("Prepare failed\n");
 		return false;
 	}
-	const uint32_t bufaddr = ALIGN(f->iap_ram + sizeof(iap_frame_s), 4);
+	const uint32_t bufaddr =
+		session && session->slots ? session->stage_addr : ALIGN(f->iap_ram + sizeof(iap_frame_s), 4);
 	target_mem_write(f->f.t, bufaddr, src, len);
-	/* Only LPC80x has reserved pages!*/
-	if (!f->reserved_pages || dest + len <= tf->length - len) {
+	if (whole_block) {
 		/*
 		 * Write payload to target ram,
 		 * set the destination address and program
@@ -76,6 +76,8 @@ typedef struct iap_result {
 /* CPU Frequency */
 #define CPU_CLK_KHZ 12000U
 
+typedef struct lpc_iap_session lpc_iap_session_s;
+
 typedef struct lpc_flash {
 	target_flash_s f;
 	uint8_t base_sector;
@@ -86,6 +88,8 @@ typedef struct lpc_flash {
 	uint32_t iap_entry;
 	uint32_t iap_ram;
 	uint32_t iap_msp;
+	/* State saved for the duration of a Flash prepare/done session, NULL outside of one */
+	lpc_iap_session_s *session;
 } lpc_flash_s;
 
 lpc_flash_s *lpc_add_flash(target_s *target, target_addr_t addr, size_t length, size_t write_size);
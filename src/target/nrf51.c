@@ -95,7 +95,9 @@ const command_s nrf51_read_cmd_list[] = {
 #define NRF51_FIELD_UNSPECIFIED (0xffffffffU)
 
 /* User Information Configuration Registers (UICR) */
-#define NRF51_UICR 0x10001000U
+#define NRF51_UICR         0x10001000U
+#define NRF51_UICR_CLENR0  0x10001000U
+#define NRF51_UICR_RBPCONF 0x10001004U
 
 /* Flash R/W Protection Register */
 #define NRF51_APPROTECT 0x10001208U
@@ -103,19 +105,50 @@ const command_s nrf51_read_cmd_list[] = {
 #define NRF51_PAGE_SIZE 1024U
 #define NRF52_PAGE_SIZE 4096U
 
+/*
+ * Flash stub layout in SRAM: the stub itself, followed by two write buffers so the next buffer
+ * can be loaded while the stub programs the current one, then room to keep the UICR in while
+ * ERASEALL runs. This fits in the 16KiB of SRAM on the smallest parts (nRF51822xxAA).
+ */
+#define NRF51_STUB_BASE         0x20000000U
+#define NRF51_STUB_BUFFER_BASE  (NRF51_STUB_BASE + 0x100U)
+#define NRF51_STUB_WRITE_SIZE   2048U
+#define NRF51_STUB_UICR_BASE    (NRF51_STUB_BUFFER_BASE + (2U * NRF51_STUB_WRITE_SIZE))
+#define NRF51_STUB_TIMEOUT_MS   5000U
+#define NRF51_STUB_EXIT_SUCCESS 0
+/* Stub modes, passed in r3 */
+#define NRF51_STUB_COPY         0U
+#define NRF51_STUB_SKIP_ERASED  1U
+
+static const uint16_t nrf51_flash_stub[] = {
+#include "flashstub/nrf51.stub"
+};
+
+typedef struct nrf51_flash {
+	target_flash_s f;
+	/* Erases are queued into this range so one covering the whole code region can use ERASEALL */
+	target_addr_t erase_begin;
+	size_t erase_length;
+	/* Which of the two stub buffers the next write goes into */
+	uint8_t stage_buffer;
+	/* Whether the stub is currently running a write */
+	bool stub_running;
+} nrf51_flash_s;
+
 static void nrf51_add_flash(target_s *t, uint32_t addr, size_t length, size_t erasesize)
 {
-	target_flash_s *f = calloc(1, sizeof(*f));
-	if (!f) { /* calloc failed: heap exhaustion */
+	nrf51_flash_s *nf = calloc(1, sizeof(*nf));
+	if (!nf) { /* calloc failed: heap exhaustion */
 		DEBUG_ERROR("calloc: failed in %s\n", __func__);
 		return;
 	}
 
+	target_flash_s *f = &nf->f;
 	f->start = addr;
 	f->length = length;
 	f->blocksize = erasesize;
-	/* Limit the write buffer size to 1k to help prevent probe memory exhaustion */
-	f->writesize = MIN(erasesize, 1024);
+	/* The stub takes several nRF51 pages at once, but never more than the region (the UICR is one page) */
+	f->writesize = MIN(length, NRF51_STUB_WRITE_SIZE);
 	f->erase = nrf51_flash_erase;
 	f->write = nrf51_flash_write;
 	f->prepare = nrf51_flash_prepare;
@@ -176,9 +209,29 @@ static bool nrf51_wait_ready(target_s *const t, platform_timeout_s *const timeou
 	return true;
 }
 
+/* Wait for any write the stub is running to complete */
+static bool nrf51_flash_stub_wait(nrf51_flash_s *const nf)
+{
+	if (!nf->stub_running)
+		return true;
+	nf->stub_running = false;
+	return cortexm_wait_stub(nf->f.t, NRF51_STUB_TIMEOUT_MS) == NRF51_STUB_EXIT_SUCCESS;
+}
+
+static bool nrf51_flash_run_stub(target_s *const t, const uint32_t dest, const uint32_t src, const size_t len,
+	const uint32_t mode)
+{
+	return cortexm_start_stub(t, NRF51_STUB_BASE, dest, src, len, mode) &&
+		cortexm_wait_stub(t, NRF51_STUB_TIMEOUT_MS) == NRF51_STUB_EXIT_SUCCESS;
+}
+
 static bool nrf51_flash_prepare(target_flash_s *f)
 {
 	target_s *t = f->t;
+	nrf51_flash_s *const nf = (nrf51_flash_s *)f;
+	nf->erase_length = 0U;
+	nf->stub_running = false;
+	nf->stage_buffer = 0U;
 	/* If there is a buffer allocated, we're in the Flash write phase, otherwise it's erase */
 	if (f->buf)
 		/* Enable write */
@@ -186,18 +239,12 @@ static bool nrf51_flash_prepare(target_flash_s *f)
 	else
 		/* Enable erase */
 		target_mem_write32(t, NRF51_NVMC_CONFIG, NRF51_NVMC_CONFIG_EEN);
-	return nrf51_wait_ready(t, NULL);
-}
-
-static bool nrf51_flash_done(target_flash_s *f)
-{
-	target_s *t = f->t;
-	/* Return to read-only */
-	target_mem_write32(t, NRF51_NVMC_CONFIG, NRF51_NVMC_CONFIG_REN);
-	return nrf51_wait_ready(t, NULL);
+	/* The stub is needed for writing, and to carry the UICR across an ERASEALL */
+	target_mem_write(t, NRF51_STUB_BASE, nrf51_flash_stub, sizeof(nrf51_flash_stub));
+	return !target_check_error(t) && nrf51_wait_ready(t, NULL);
 }
 
-static bool nrf51_flash_erase(target_flash_s *f, target_addr_t addr, size_t len)
+static bool nrf51_flash_erase_pages(target_flash_s *const f, const target_addr_t addr, const size_t len)
 {
 	target_s *t = f->t;
 
@@ -217,12 +264,108 @@ static bool nrf51_flash_erase(target_flash_s *f, target_addr_t addr, size_t len)
 	return true;
 }
 
+/*
+ * ERASEALL wipes the UICR along with the code region, so copy the UICR out to SRAM
+ * beforehand and program it back afterwards. Any UICR erase requested alongside is
+ * done separately, and so still takes effect whichever order the two arrive in.
+ * The protection settings are left erased rather than restored, as is the code region 0
+ * size they apply to - putting them back would lock the part again straight after the
+ * erase that unlocked it. These are reserved words on the nRF52, so this is harmless there.
+ */
+static bool nrf51_flash_erase_all(target_s *const t)
+{
+	const target_flash_s *const uicr = target_flash_for_addr(t, NRF51_UICR);
+	const size_t uicr_length = uicr ? uicr->length : 0U;
+	if (uicr_length && !nrf51_flash_run_stub(t, NRF51_STUB_UICR_BASE, NRF51_UICR, uicr_length, NRF51_STUB_COPY))
+		return false;
+	if (uicr_length) {
+		/* Erased words are skipped by the stub, so blank these in the copy to leave them erased */
+		target_mem_write32(t, NRF51_STUB_UICR_BASE + (NRF51_UICR_CLENR0 - NRF51_UICR), 0xffffffffU);
+		target_mem_write32(t, NRF51_STUB_UICR_BASE + (NRF51_UICR_RBPCONF - NRF51_UICR), 0xffffffffU);
+		if (NRF51_APPROTECT - NRF51_UICR < uicr_length)
+			target_mem_write32(t, NRF51_STUB_UICR_BASE + (NRF51_APPROTECT - NRF51_UICR), 0xffffffffU);
+		if (target_check_error(t))
+			return false;
+	}
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	target_mem_write32(t, NRF51_NVMC_ERASEALL, 1);
+	if (!nrf51_wait_ready(t, &timeout))
+		return false;
+	if (!uicr_length)
+		return true;
+
+	target_mem_write32(t, NRF51_NVMC_CONFIG, NRF51_NVMC_CONFIG_WEN);
+	const bool result = nrf51_wait_ready(t, NULL) &&
+		nrf51_flash_run_stub(t, NRF51_UICR, NRF51_STUB_UICR_BASE, uicr_length, NRF51_STUB_SKIP_ERASED);
+	target_mem_write32(t, NRF51_NVMC_CONFIG, NRF51_NVMC_CONFIG_EEN);
+	return nrf51_wait_ready(t, NULL) && result;
+}
+
+/* Erase the pending range, with ERASEALL if it covers the whole code region and page by page otherwise */
+static bool nrf51_flash_erase_pending(nrf51_flash_s *const nf)
+{
+	if (!nf->erase_length)
+		return true;
+	target_flash_s *const f = &nf->f;
+	const target_addr_t begin = nf->erase_begin;
+	const size_t length = nf->erase_length;
+	nf->erase_length = 0U;
+
+	if (f->start == NRF51_UICR || begin != f->start || length < f->length)
+		return nrf51_flash_erase_pages(f, begin, length);
+	DEBUG_TARGET("nRF5x: promoting erase of the whole code region to ERASEALL\n");
+	return nrf51_flash_erase_all(f->t);
+}
+
+static bool nrf51_flash_done(target_flash_s *f)
+{
+	target_s *t = f->t;
+	nrf51_flash_s *const nf = (nrf51_flash_s *)f;
+	const bool result = nrf51_flash_erase_pending(nf) && nrf51_flash_stub_wait(nf);
+	/* Return to read-only */
+	target_mem_write32(t, NRF51_NVMC_CONFIG, NRF51_NVMC_CONFIG_REN);
+	return nrf51_wait_ready(t, NULL) && result;
+}
+
+/*
+ * Pages are queued up into a contiguous range and erased once the range is broken
+ * or the erase operation completes, so that whole code region erases can use ERASEALL
+ */
+static bool nrf51_flash_erase(target_flash_s *f, target_addr_t addr, size_t len)
+{
+	nrf51_flash_s *const nf = (nrf51_flash_s *)f;
+	if (nf->erase_length && addr == nf->erase_begin + nf->erase_length) {
+		nf->erase_length += len;
+		return true;
+	}
+
+	const bool result = nrf51_flash_erase_pending(nf);
+	nf->erase_begin = addr;
+	nf->erase_length = len;
+	return result;
+}
+
+/*
+ * Hand a buffer to the stub. The buffer is loaded into whichever stub buffer is free
+ * while the stub is still programming the previous one, then the stub is restarted on it.
+ * nrf51_flash_prepare() and nrf51_flash_done() top-and-tail this.
+ */
 static bool nrf51_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
 {
-	/* nrf51_flash_prepare() and nrf51_flash_done() top-and-tail this, just write the data to the target. */
 	target_s *t = f->t;
-	target_mem_write(t, dest, src, len);
-	return nrf51_wait_ready(t, NULL);
+	nrf51_flash_s *const nf = (nrf51_flash_s *)f;
+	const uint32_t buffer = NRF51_STUB_BUFFER_BASE + (nf->stage_buffer * NRF51_STUB_WRITE_SIZE);
+	target_mem_write(t, buffer, src, len);
+	if (target_check_error(t) || !nrf51_flash_stub_wait(nf))
+		return false;
+
+	if (!cortexm_start_stub(t, NRF51_STUB_BASE, dest, buffer, len, NRF51_STUB_SKIP_ERASED))
+		return false;
+	nf->stub_running = true;
+	nf->stage_buffer ^= 1U;
+	return true;
 }
 
 static bool nrf51_mass_erase(target_s *t)
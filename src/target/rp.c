@@ -56,6 +56,7 @@
 #define BOOTROM_MAGIC_MASK    0x00ffffffU
 #define BOOTROM_VERSION_SHIFT 24U
 #define RP_XIP_FLASH_BASE     0x10000000U
+#define RP_XIP_NOCACHE_BASE   0x13000000U
 #define RP_SRAM_BASE          0x20000000U
 #define RP_SRAM_SIZE          0x42000U
 
@@ -160,14 +161,72 @@
 #define MAX_FLASH                (16U * 1024U * 1024U)
 #define MAX_WRITE_CHUNK          0x1000U
 
+/* Default bootrom flash_range_erase() block size and command, for 64KiB block erases, if SFDP offers nothing larger */
+#define RP_FLASH_BLOCK_ERASE_SIZE FLASHSIZE_64K_BLOCK
+#define RP_FLASH_BLOCK_ERASE_CMD  0xd8U
+
+/*
+ * Layout of the Flash stub in SRAM: the stub's code, its parameter block,
+ * then two staging buffers the size of a Flash write so one can be filled while
+ * the other is being programmed. The stack goes at the top of SRAM as usual.
+ */
+#define RP_STUB_ADDR              RP_SRAM_BASE
+#define RP_STUB_PARAMS_ADDR       (RP_SRAM_BASE + 0x40U)
+#define RP_STUB_BUFFER_ADDR       (RP_SRAM_BASE + 0x100U)
+#define RP_STUB_STACK_TOP         (RP_SRAM_BASE + RP_SRAM_SIZE)
+
+/*
+ * Limits on how long the bootrom routines get before we give up on the stub, from the worst case
+ * timings of typical QSPI parts (W25Q series: 2s per 64KiB block erase, 400ms per 4KiB sector,
+ * 3ms per 256 byte page program) plus a fixed allowance for the call overheads
+ */
+#define RP_STUB_TIMEOUT_MS              500U
+#define RP_STUB_BLOCK_ERASE_TIMEOUT_MS  2000U
+#define RP_STUB_SECTOR_ERASE_TIMEOUT_MS 400U
+#define RP_STUB_PAGE_PROGRAM_TIMEOUT_MS 3U
+#define RP_FLASH_PAGE_SIZE              256U
+
 typedef struct rp_priv {
 	uint16_t rom_reset_usb_boot;
+	uint16_t rom_flash_exit_xip;
+	uint16_t rom_flash_range_erase;
+	uint16_t rom_flash_range_program;
 	uint32_t ssi_enabled;
 	uint32_t ctrl0;
 	uint32_t ctrl1;
 	uint32_t xpi_ctrl0;
+	/* Which of the two staging buffers the next Flash write goes into */
+	uint8_t stage_buffer;
+	/* Whether the Flash stub is currently running on the target, and how long it has to complete */
+	bool stub_running;
+	uint32_t stub_timeout_ms;
+	platform_timeout_s stub_deadline;
+	/* Set when a read through the XIP window could not wait for the stub, and reported by rp_check_error() */
+	bool mem_read_failed;
+	/* The Cortex-M memory read and error check routines, for reads that don't need the XIP window */
+	void (*mem_read)(target_s *target, void *dest, target_addr_t src, size_t len);
+	bool (*check_error)(target_s *target);
 } rp_priv_s;
 
+/*
+ * Thumb stub that calls the bootrom flash_exit_xip() then a Flash operation with up to 4 arguments.
+ * On entry r0 points to a parameter block of {flash_exit_xip, function, arg0, arg1, arg2, arg3}
+ */
+static const uint16_t rp_flash_stub[] = {
+	0x4607U,              /* mov r7, r0 */
+	0x6838U,              /* ldr r0, [r7, #0] */
+	0x4780U,              /* blx r0 */
+	0x68b8U,              /* ldr r0, [r7, #8] */
+	0x68f9U,              /* ldr r1, [r7, #12] */
+	0x693aU,              /* ldr r2, [r7, #16] */
+	0x697bU,              /* ldr r3, [r7, #20] */
+	0x687cU,              /* ldr r4, [r7, #4] */
+	0x47a0U,              /* blx r4 */
+	ARM_THUMB_BREAKPOINT, /* bkpt */
+};
+
+#define RP_STUB_BREAKPOINT_ADDR (RP_STUB_ADDR + sizeof(rp_flash_stub) - 2U)
+
 static bool rp_cmd_erase_sector(target_s *target, int argc, const char **argv);
 static bool rp_cmd_reset_usb_boot(target_s *target, int argc, const char **argv);
 
@@ -194,6 +253,15 @@ static void rp_flash_exit_xip(target_s *target);
 static void rp_flash_enter_xip(target_s *target);
 static void rp_flash_connect_internal(target_s *target);
 static void rp_flash_flush_cache(target_s *target);
+static void rp_flash_init_spi(target_s *target);
+static void rp_spi_chip_select(target_s *target, uint32_t state);
+
+static bool rp_flash_erase(target_flash_s *flash, target_addr_t addr, size_t length);
+static bool rp_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t length);
+static bool rp_flash_done(target_flash_s *flash);
+static bool rp_flash_stub_finish(target_s *target);
+static void rp_mem_read(target_s *target, void *dest, target_addr_t src, size_t len);
+static bool rp_check_error(target_s *target);
 
 static void rp_add_flash(target_s *target)
 {
@@ -204,9 +272,18 @@ static void rp_add_flash(target_s *target)
 	rp_flash_exit_xip(target);
 	rp_spi_config(target);
 
-	bmp_spi_add_flash(
+	spi_flash_s *const spi_flash = bmp_spi_add_flash(
 		target, RP_XIP_FLASH_BASE, rp_get_flash_length(target), rp_spi_read, rp_spi_write, rp_spi_run_command);
 
+	/* If the bootrom provides the Flash routines we need, program and erase via a stub that calls them */
+	const rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	if (spi_flash && priv->rom_flash_exit_xip && priv->rom_flash_range_erase && priv->rom_flash_range_program) {
+		target_flash_s *const flash = &spi_flash->flash;
+		flash->erase = rp_flash_erase;
+		flash->write = rp_flash_write;
+		flash->done = rp_flash_done;
+	}
+
 	rp_spi_restore(target);
 	if (por_state)
 		rp_flash_flush_cache(target);
@@ -240,6 +317,11 @@ bool rp_probe(target_s *target)
 	target->attach = rp_attach;
 	target->enter_flash_mode = rp_flash_prepare;
 	target->exit_flash_mode = rp_flash_resume;
+	/* Hook memory reads so the Flash can still be read via the XIP window while in Flash mode */
+	priv_storage->mem_read = target->mem_read;
+	target->mem_read = rp_mem_read;
+	priv_storage->check_error = target->check_error;
+	target->check_error = rp_check_error;
 	target_add_commands(target, rp_cmd_list, target->driver);
 	return true;
 }
@@ -269,18 +351,25 @@ static bool rp_read_rom_func_table(target_s *const target)
 	/* We have to do a 32-bit read here but the pointer contained is only 16-bit. */
 	const uint16_t table_offset = target_mem_read32(target, BOOTROM_FUNC_TABLE_ADDR) & 0x0000ffffU;
 	uint16_t table[RP_MAX_TABLE_SIZE];
-	if (target_mem_read(target, table, table_offset, RP_MAX_TABLE_SIZE))
+	if (target_mem_read(target, table, table_offset, sizeof(table)))
 		return false;
 
 	for (size_t i = 0; i < RP_MAX_TABLE_SIZE; i += 2U) {
 		const uint16_t tag = table[i];
 		const uint16_t addr = table[i + 1U];
-		if (tag == BOOTROM_FUNC_TABLE_TAG('U', 'B')) {
+		/* The table is terminated by a 0 tag */
+		if (!tag)
+			break;
+		if (tag == BOOTROM_FUNC_TABLE_TAG('U', 'B'))
 			priv->rom_reset_usb_boot = addr;
-			return true;
-		}
+		else if (tag == BOOTROM_FUNC_TABLE_TAG('E', 'X'))
+			priv->rom_flash_exit_xip = addr;
+		else if (tag == BOOTROM_FUNC_TABLE_TAG('R', 'E'))
+			priv->rom_flash_range_erase = addr;
+		else if (tag == BOOTROM_FUNC_TABLE_TAG('R', 'P'))
+			priv->rom_flash_range_program = addr;
 	}
-	return false;
+	return priv->rom_reset_usb_boot != 0U;
 }
 
 static void rp_spi_config(target_s *const target)
@@ -320,21 +409,182 @@ static bool rp_flash_prepare(target_s *const target)
 	rp_flash_exit_xip(target);
 	/* Configure the SPI controller for our use */
 	rp_spi_config(target);
+	/* Load the Flash stub into SRAM - the core is reset on leaving Flash mode, so we don't preserve SRAM */
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	target_mem_write(target, RP_STUB_ADDR, rp_flash_stub, sizeof(rp_flash_stub));
+	priv->stage_buffer = 0U;
+	priv->stub_running = false;
 	return true;
 }
 
 static bool rp_flash_resume(target_s *const target)
 {
 	DEBUG_TARGET("%s\n", __func__);
+	/* Make sure the stub is done with the Flash */
+	const bool result = rp_flash_stub_finish(target);
 	/* Put the SPI controller back how it was when we entered Flash mode */
 	rp_spi_restore(target);
 	/* Flush the cache and resume XIP */
 	rp_flash_flush_cache(target);
 	rp_flash_enter_xip(target);
 	target_mem_write32(target, CORTEXM_AIRCR, CORTEXM_AIRCR_VECTKEY | CORTEXM_AIRCR_SYSRESETREQ);
+	return result;
+}
+
+/* Start the Flash stub running the bootrom routine at function with the arguments given */
+static void rp_flash_stub_start(target_s *const target, const uint32_t timeout_ms, const uint16_t function,
+	const uint32_t arg0, const uint32_t arg1, const uint32_t arg2, const uint32_t arg3)
+{
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	const uint32_t params[6] = {priv->rom_flash_exit_xip, function, arg0, arg1, arg2, arg3};
+	target_mem_write(target, RP_STUB_PARAMS_ADDR, params, sizeof(params));
+
+	uint32_t regs[target->regs_size / sizeof(uint32_t)];
+	memset(regs, 0, target->regs_size);
+	regs[0] = RP_STUB_PARAMS_ADDR;
+	regs[REG_MSP] = RP_STUB_STACK_TOP;
+	regs[REG_LR] = RP_STUB_BREAKPOINT_ADDR | 1U;
+	regs[REG_PC] = RP_STUB_ADDR;
+	regs[REG_XPSR] = CORTEXM_XPSR_THUMB;
+	target_regs_write(target, regs);
+	target_halt_resume(target, false);
+	priv->stub_running = true;
+	priv->stub_timeout_ms = timeout_ms;
+	platform_timeout_set(&priv->stub_deadline, timeout_ms);
+}
+
+/* Wait for the Flash stub to complete, and check it stopped on its breakpoint rather than faulting */
+static bool rp_flash_stub_finish(target_s *const target)
+{
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	if (!priv->stub_running)
+		return true;
+	priv->stub_running = false;
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	while (!target_halt_poll(target, NULL)) {
+		/* If the bootrom routine hangs (Flash not responding, bad XIP state) stop it rather than wait forever */
+		if (platform_timeout_is_expired(&priv->stub_deadline)) {
+			DEBUG_ERROR("%s: Flash stub did not complete within %" PRIu32 "ms\n", __func__, priv->stub_timeout_ms);
+			target_halt_request(target);
+			return false;
+		}
+		target_print_progress(&timeout);
+	}
+
+	uint32_t pc = 0;
+	target_reg_read(target, REG_PC, &pc, sizeof(pc));
+	if (pc != RP_STUB_BREAKPOINT_ADDR) {
+		DEBUG_ERROR("%s: Flash stub stopped at %08" PRIx32 "\n", __func__, pc);
+		return false;
+	}
 	return true;
 }
 
+/* Erase the pending range with the bootrom, which uses block erases where it can and sector erases for the rest */
+static bool rp_flash_erase_pending(target_flash_s *const flash)
+{
+	target_s *const target = flash->t;
+	const rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	spi_flash_s *const spi_flash = (spi_flash_s *)flash;
+	const size_t length = spi_flash->erase_pending_length;
+	spi_flash->erase_pending_length = 0U;
+	if (!rp_flash_stub_finish(target))
+		return false;
+	/* The erase types from SFDP are largest first, so use the largest one if it beats a sector erase */
+	const spi_erase_type_s *const block_erase = &spi_flash->erase_types[0];
+	const bool sfdp_block = block_erase->size > FLASHSIZE_4K_SECTOR;
+	const uint32_t block_size = sfdp_block ? block_erase->size : RP_FLASH_BLOCK_ERASE_SIZE;
+	/* The bootrom erases whole blocks where it can and falls back on sectors for the remainder */
+	const uint32_t timeout_ms = RP_STUB_TIMEOUT_MS + (length / block_size) * RP_STUB_BLOCK_ERASE_TIMEOUT_MS +
+		((length % block_size) / FLASHSIZE_4K_SECTOR) * RP_STUB_SECTOR_ERASE_TIMEOUT_MS;
+	rp_flash_stub_start(target, timeout_ms, priv->rom_flash_range_erase, spi_flash->erase_pending_begin, length,
+		block_size, sfdp_block ? block_erase->opcode : RP_FLASH_BLOCK_ERASE_CMD);
+	return rp_flash_stub_finish(target);
+}
+
+/*
+ * Sectors are handed to us one at a time, so accumulate them into a contiguous pending range and only
+ * erase it when the range is broken or the erase operation completes, which lets block erases happen
+ */
+static bool rp_flash_erase(target_flash_s *const flash, const target_addr_t addr, const size_t length)
+{
+	spi_flash_s *const spi_flash = (spi_flash_s *)flash;
+	const target_addr_t offset = addr - flash->start;
+	if (spi_flash->erase_pending_length &&
+		offset == spi_flash->erase_pending_begin + spi_flash->erase_pending_length) {
+		spi_flash->erase_pending_length += length;
+		return true;
+	}
+
+	bool result = true;
+	if (spi_flash->erase_pending_length)
+		result = rp_flash_erase_pending(flash);
+	spi_flash->erase_pending_begin = offset;
+	spi_flash->erase_pending_length = length;
+	return result;
+}
+
+static bool rp_flash_write(
+	target_flash_s *const flash, const target_addr_t dest, const void *const src, const size_t length)
+{
+	target_s *const target = flash->t;
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	/* Stage the data into the buffer the stub isn't using, which we can do while the core runs */
+	const uint32_t buffer = RP_STUB_BUFFER_ADDR + (priv->stage_buffer * flash->writesize);
+	target_mem_write(target, buffer, src, length);
+	/* Then wait for the previous block to be programmed and start on this one */
+	if (!rp_flash_stub_finish(target))
+		return false;
+	const uint32_t pages = (length + RP_FLASH_PAGE_SIZE - 1U) / RP_FLASH_PAGE_SIZE;
+	const uint32_t timeout_ms = RP_STUB_TIMEOUT_MS + pages * RP_STUB_PAGE_PROGRAM_TIMEOUT_MS;
+	rp_flash_stub_start(target, timeout_ms, priv->rom_flash_range_program, dest - flash->start, buffer, length, 0U);
+	priv->stage_buffer ^= 1U;
+	return true;
+}
+
+static bool rp_flash_done(target_flash_s *const flash)
+{
+	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
+	if (spi_flash->erase_pending_length)
+		return rp_flash_erase_pending(flash);
+	return rp_flash_stub_finish(flash->t);
+}
+
+/*
+ * In Flash mode the SSI is in serial mode and the XIP window is unusable, so to serve reads of the Flash
+ * switch back to XIP mode for the duration and read via the uncached alias so we never see stale cache lines
+ */
+static void rp_mem_read(target_s *const target, void *const dest, const target_addr_t src, const size_t len)
+{
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	if (!target->flash_mode || src < RP_XIP_FLASH_BASE || src >= RP_XIP_FLASH_BASE + MAX_FLASH) {
+		priv->mem_read(target, dest, src, len);
+		return;
+	}
+
+	/* Make sure the last block written has landed first, failing the read if the stub didn't complete */
+	if (!rp_flash_stub_finish(target)) {
+		memset(dest, 0xff, len);
+		priv->mem_read_failed = true;
+		return;
+	}
+	rp_spi_chip_select(target, RP_GPIO_QSPI_CS_DRIVE_NORMAL);
+	rp_flash_enter_xip(target);
+	priv->mem_read(target, dest, RP_XIP_NOCACHE_BASE + (src - RP_XIP_FLASH_BASE), len);
+	/* Put the SSI back in serial mode for the SPI Flash routines */
+	rp_flash_init_spi(target);
+}
+
+static bool rp_check_error(target_s *const target)
+{
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	const bool mem_read_failed = priv->mem_read_failed;
+	priv->mem_read_failed = false;
+	return priv->check_error(target) || mem_read_failed;
+}
+
 static void rp_spi_chip_select(target_s *const target, const uint32_t state)
 {
 	const uint32_t value = target_mem_read32(target, RP_GPIO_QSPI_CS_CTRL);
@@ -648,6 +898,8 @@ static bool rp_cmd_erase_sector(target_s *target, int argc, const char **argv)
 	bool result = true; /* catch false returns with &= */
 	result &= rp_flash_prepare(target);
 	result &= flash->erase(flash, start, length);
+	/* Erases are coalesced until the operation is done, so flush it before leaving Flash mode */
+	result &= rp_flash_done(flash);
 	result &= rp_flash_resume(target);
 	return result;
 }
@@ -40,11 +40,12 @@
 #include "target.h"
 #include "target_internal.h"
 #include "cortexm.h"
+#include "samd.h"
 
+static bool samd_flash_prepare(target_flash_s *f);
 static bool samd_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool samd_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
-/* NB: This is not marked static on purpose as it's used by samx5x.c. */
-bool samd_mass_erase(target_s *t);
+static bool samd_flash_done(target_flash_s *f);
 
 static bool samd_cmd_lock_flash(target_s *t, int argc, const char **argv);
 static bool samd_cmd_unlock_flash(target_s *t, int argc, const char **argv);
@@ -71,6 +72,19 @@ const command_s samd_cmd_list[] = {
 #define SAMD_ROW_SIZE  256U
 #define SAMD_PAGE_SIZE 64U
 
+/*
+ * Flash stub layout in SRAM: the stub itself, followed by two write buffers so the
+ * next buffer can be loaded while the stub programs the current one. The write size
+ * is chosen so this fits in the 4KiB of SRAM on the smallest parts (SAM D09).
+ */
+#define SAMD_SRAM_BASE         0x20000000U
+#define SAMD_STUB_BUFFER_BASE  (SAMD_SRAM_BASE + 0x100U)
+#define SAMD_STUB_WRITE_SIZE   1024U
+#define SAMD_STUB_TIMEOUT_MS   5000U
+/* Worst case time for a single row erase, which erase timeouts are scaled by */
+#define SAMD_ROW_ERASE_TIME_MS 6U
+#define SAMD_STUB_EXIT_SUCCESS 0
+
 /* -------------------------------------------------------------------------- */
 /* Non-Volatile Memory Controller (NVMC) Registers */
 /* -------------------------------------------------------------------------- */
@@ -470,21 +484,57 @@ samd_descr_s samd_parse_device_id(uint32_t did)
 	return samd;
 }
 
-static void samd_add_flash(target_s *t, uint32_t addr, size_t length)
+static const uint16_t samd_flash_stub[] = {
+#include "flashstub/samd.stub"
+};
+
+typedef struct samd_flash {
+	target_flash_s f;
+	/* Flash stub to use for this Flash, which depends on the NVMCTRL version */
+	const uint16_t *stub;
+	size_t stub_size;
+	/* Which of the two stub buffers the next write goes into */
+	uint8_t stage_buffer;
+	/* Whether the stub is currently running a write */
+	bool stub_running;
+	/* Contiguous range of rows waiting to be erased */
+	target_addr_t erase_begin;
+	size_t erase_length;
+} samd_flash_s;
+
+/*
+ * Adds a Flash region programmed via the given NVMCTRL stub. The stub's erase mode is used for erases
+ * unless the caller replaces the erase routine on the returned Flash.
+ */
+target_flash_s *samd_add_stub_flash(target_s *const t, const uint32_t addr, const size_t length,
+	const size_t blocksize, const size_t writesize, const uint16_t *const stub, const size_t stub_size)
 {
-	target_flash_s *f = calloc(1, sizeof(*f));
-	if (!f) { /* calloc failed: heap exhaustion */
+	samd_flash_s *flash = calloc(1, sizeof(*flash));
+	if (!flash) { /* calloc failed: heap exhaustion */
 		DEBUG_ERROR("calloc: failed in %s\n", __func__);
-		return;
+		return NULL;
 	}
 
+	target_flash_s *const f = &flash->f;
 	f->start = addr;
 	f->length = length;
-	f->blocksize = SAMD_ROW_SIZE;
+	f->blocksize = blocksize;
+	f->prepare = samd_flash_prepare;
 	f->erase = samd_flash_erase;
 	f->write = samd_flash_write;
-	f->writesize = SAMD_PAGE_SIZE;
+	f->done = samd_flash_done;
+	f->writesize = writesize;
+	f->erased = 0xffU;
+	flash->stub = stub;
+	flash->stub_size = stub_size;
 	target_add_flash(t, f);
+	return f;
+}
+
+static void samd_add_flash(target_s *t, uint32_t addr, size_t length)
+{
+	samd_add_stub_flash(
+		t, addr, length, SAMD_ROW_SIZE, SAMD_STUB_WRITE_SIZE, samd_flash_stub, sizeof(samd_flash_stub));
 }
 
 #define SAMD_VARIANT_STR_LENGTH 60U
@@ -570,20 +620,6 @@ bool samd_probe(target_s *t)
 	return true;
 }
 
-/* Temporary (until next reset) flash memory locking */
-static void samd_lock_current_address(target_s *t)
-{
-	/* Issue the lock command */
-	target_mem_write32(t, SAMD_NVMC_CTRLA, SAMD_CTRLA_CMD_KEY | SAMD_CTRLA_CMD_LOCK);
-}
-
-/* Temporary (until next reset) flash memory unlocking */
-static void samd_unlock_current_address(target_s *t)
-{
-	/* Issue the unlock command */
-	target_mem_write32(t, SAMD_NVMC_CTRLA, SAMD_CTRLA_CMD_KEY | SAMD_CTRLA_CMD_UNLOCK);
-}
-
 static bool samd_wait_nvm_ready(target_s *t)
 {
 	/* Poll for NVM Ready */
@@ -608,56 +644,95 @@ static bool samd_wait_dsu_ready(target_s *const t, uint32_t *const result, platf
 	return true;
 }
 
-/* Erase flash row by row */
-static bool samd_flash_erase(target_flash_s *const f, const target_addr_t addr, const size_t len)
+/* Wait for any write the stub is running to complete */
+static bool samd_flash_stub_wait(samd_flash_s *const flash)
 {
-	target_s *t = f->t;
-	for (size_t offset = 0; offset < len; offset += f->blocksize) {
-		/*
-		 * Write address of first word in row to erase it
-		 * Must be shifted right for 16-bit address, see Datasheet §20.8.8 Address
-		 */
-		target_mem_write32(t, SAMD_NVMC_ADDRESS, (addr + offset) >> 1U);
+	if (!flash->stub_running)
+		return true;
+	flash->stub_running = false;
+	return cortexm_wait_stub(flash->f.t, SAMD_STUB_TIMEOUT_MS) == SAMD_STUB_EXIT_SUCCESS;
+}
 
-		/* Unlock */
-		samd_unlock_current_address(t);
+/*
+ * Erase the pending range of rows in one go using the stub. A whole device's worth of rows
+ * can take longer than the usual stub timeout, so the timeout grows with the number of rows.
+ */
+static bool samd_flash_erase_pending(samd_flash_s *const flash)
+{
+	if (!flash->erase_length)
+		return true;
+	target_s *const t = flash->f.t;
+	const size_t length = flash->erase_length;
+	flash->erase_length = 0U;
+	const uint32_t timeout = SAMD_STUB_TIMEOUT_MS + (length / SAMD_ROW_SIZE) * SAMD_ROW_ERASE_TIME_MS;
+	return samd_flash_stub_wait(flash) && cortexm_start_stub(t, SAMD_SRAM_BASE, flash->erase_begin, 0U, length, 0U) &&
+		cortexm_wait_stub(t, timeout) == SAMD_STUB_EXIT_SUCCESS;
+}
 
-		/* Issue the erase command */
-		target_mem_write32(t, SAMD_NVMC_CTRLA, SAMD_CTRLA_CMD_KEY | SAMD_CTRLA_CMD_ERASEROW);
-		if (!samd_wait_nvm_ready(t))
+static bool samd_flash_prepare(target_flash_s *const f)
+{
+	samd_flash_s *const flash = (samd_flash_s *)f;
+	target_s *const t = f->t;
+	/* The stub needs the core halted to run, and Flash mode may not have left it that way */
+	target_halt_request(t);
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	while (target_halt_poll(t, NULL) == TARGET_HALT_RUNNING) {
+		if (platform_timeout_is_expired(&timeout))
 			return false;
-
-		/* Lock */
-		samd_lock_current_address(t);
 	}
 
-	return true;
+	target_mem_write(t, SAMD_SRAM_BASE, flash->stub, flash->stub_size);
+	flash->stage_buffer = 0U;
+	flash->stub_running = false;
+	flash->erase_length = 0U;
+	return !target_check_error(t);
 }
 
 /*
- * Write flash page by page
+ * Rows are queued up into a contiguous range and erased by a single stub run
+ * once the range is broken or the erase operation completes
  */
-static bool samd_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
+static bool samd_flash_erase(target_flash_s *const f, const target_addr_t addr, const size_t len)
 {
-	target_s *t = f->t;
-
-	/* Write within a single page. This may be part or all of the page */
-	target_mem_write(t, dest, src, len);
+	samd_flash_s *const flash = (samd_flash_s *)f;
+	if (flash->erase_length && addr == flash->erase_begin + flash->erase_length) {
+		flash->erase_length += len;
+		return true;
+	}
 
-	/* Unlock */
-	samd_unlock_current_address(t);
+	const bool result = samd_flash_erase_pending(flash);
+	flash->erase_begin = addr;
+	flash->erase_length = len;
+	return result;
+}
 
-	/* Issue the write page command */
-	target_mem_write32(t, SAMD_NVMC_CTRLA, SAMD_CTRLA_CMD_KEY | SAMD_CTRLA_CMD_WRITEPAGE);
-	if (!samd_wait_nvm_ready(t))
+/*
+ * Hand a buffer of pages to the stub. The buffer is loaded into whichever stub buffer is free
+ * while the stub is still programming the previous one, then the stub is restarted on it.
+ */
+static bool samd_flash_write(target_flash_s *const f, const target_addr_t dest, const void *const src, const size_t len)
+{
+	samd_flash_s *const flash = (samd_flash_s *)f;
+	target_s *const t = f->t;
+	const uint32_t buffer = SAMD_STUB_BUFFER_BASE + (flash->stage_buffer * f->writesize);
+	target_mem_write(t, buffer, src, len);
+	if (target_check_error(t) || !samd_flash_stub_wait(flash))
 		return false;
 
-	/* Lock */
-	samd_lock_current_address(t);
-
+	if (!cortexm_start_stub(t, SAMD_SRAM_BASE, dest, buffer, len, 0U))
+		return false;
+	flash->stub_running = true;
+	flash->stage_buffer ^= 1U;
 	return true;
 }
 
+static bool samd_flash_done(target_flash_s *const f)
+{
+	samd_flash_s *const flash = (samd_flash_s *)f;
+	return samd_flash_erase_pending(flash) && samd_flash_stub_wait(flash);
+}
+
 /* Uses the Device Service Unit to erase the entire flash */
 bool samd_mass_erase(target_s *t)
 {
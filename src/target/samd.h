@@ -0,0 +1,30 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2014  Richard Meadows <richardeoin>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TARGET_SAMD_H
+#define TARGET_SAMD_H
+
+#include "target_internal.h"
+
+/* The SAM D1x/2x support shared with the SAM D5x/E5x driver in samx5x.c */
+bool samd_mass_erase(target_s *t);
+target_flash_s *samd_add_stub_flash(target_s *t, uint32_t addr, size_t length, size_t blocksize, size_t writesize,
+	const uint16_t *stub, size_t stub_size);
+
+#endif /* TARGET_SAMD_H */
@@ -39,9 +39,9 @@
 #include "target.h"
 #include "target_internal.h"
 #include "cortexm.h"
+#include "samd.h"
 
 static bool samx5x_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
-static bool samx5x_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
 static bool samx5x_cmd_lock_flash(target_s *t, int argc, const char **argv);
 static bool samx5x_cmd_unlock_flash(target_s *t, int argc, const char **argv);
 static bool samx5x_cmd_unlock_bootprot(target_s *t, int argc, const char **argv);
@@ -52,7 +52,6 @@ static bool samx5x_cmd_ssb(target_s *t, int argc, const char **argv);
 static bool samx5x_cmd_update_user_word(target_s *t, int argc, const char **argv);
 
 /* (The SAM D1x/2x implementation of erase_all is reused as it's identical)*/
-bool samd_mass_erase(target_s *t);
 #define samx5x_mass_erase samd_mass_erase
 
 #ifdef SAMX5X_EXTRA_CMDS
@@ -86,6 +85,8 @@ const command_s samx5x_cmd_list[] = {
 /* Non-Volatile Memory Controller (NVMC) Parameters */
 #define SAMX5X_PAGE_SIZE  UINT32_C(512)
 #define SAMX5X_BLOCK_SIZE (SAMX5X_PAGE_SIZE * 16U)
+/* Amount of data handed to the Flash stub at a time */
+#define SAMX5X_STUB_WRITE_SIZE (SAMX5X_PAGE_SIZE * 4U)
 
 /* Non-Volatile Memory Controller (NVMC) Registers */
 #define SAMX5X_NVMC         0x41004000U
@@ -293,21 +294,18 @@ samx5x_descr_s samx5x_parse_device_id(uint32_t did)
 	return samd;
 }
 
-static void samx5x_add_flash(target_s *t, uint32_t addr, size_t length, size_t erase_block_size, size_t write_page_size)
+static const uint16_t samx5x_flash_stub[] = {
+#include "flashstub/samx5x.stub"
+};
+
+static void samx5x_add_flash(target_s *t, uint32_t addr, size_t length, size_t erase_block_size, size_t write_size)
 {
-	target_flash_s *f = calloc(1, sizeof(*f));
-	if (!f) { /* calloc failed: heap exhaustion */
-		DEBUG_INFO("calloc: failed in %s\n", __func__);
+	target_flash_s *f =
+		samd_add_stub_flash(t, addr, length, erase_block_size, write_size, samx5x_flash_stub, sizeof(samx5x_flash_stub));
+	if (!f)
 		return;
-	}
-
-	f->start = addr;
-	f->length = length;
-	f->blocksize = erase_block_size;
+	/* Block erases are few and slow enough that they stay host-driven, which also checks BOOTPROT and RUNLOCK */
 	f->erase = samx5x_flash_erase;
-	f->write = samx5x_flash_write;
-	f->writesize = write_page_size;
-	target_add_flash(t, f);
 }
 
 #define SAMX5X_VARIANT_STR_LENGTH 60U
@@ -363,15 +361,15 @@ bool samx5x_probe(target_s *t)
 	default:
 	case 18:
 		target_add_ram(t, 0x20000000, 0x20000);
-		samx5x_add_flash(t, 0x00000000, 0x40000, SAMX5X_BLOCK_SIZE, SAMX5X_PAGE_SIZE);
+		samx5x_add_flash(t, 0x00000000, 0x40000, SAMX5X_BLOCK_SIZE, SAMX5X_STUB_WRITE_SIZE);
 		break;
 	case 19:
 		target_add_ram(t, 0x20000000, 0x30000);
-		samx5x_add_flash(t, 0x00000000, 0x80000, SAMX5X_BLOCK_SIZE, SAMX5X_PAGE_SIZE);
+		samx5x_add_flash(t, 0x00000000, 0x80000, SAMX5X_BLOCK_SIZE, SAMX5X_STUB_WRITE_SIZE);
 		break;
 	case 20:
 		target_add_ram(t, 0x20000000, 0x40000);
-		samx5x_add_flash(t, 0x00000000, 0x100000, SAMX5X_BLOCK_SIZE, SAMX5X_PAGE_SIZE);
+		samx5x_add_flash(t, 0x00000000, 0x100000, SAMX5X_BLOCK_SIZE, SAMX5X_STUB_WRITE_SIZE);
 		break;
 	}
 
@@ -503,46 +501,6 @@ static bool samx5x_flash_erase(target_flash_s *f, target_addr_t addr, size_t len
 	return true;
 }
 
-/* Write flash page by page */
-static bool samx5x_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
-{
-	target_s *t = f->t;
-	const uint16_t errs = samx5x_read_nvm_error(t);
-	if (errs) {
-		DEBUG_INFO(NVM_ERROR_BITS_MSG, "write", dest, (uint32_t)len);
-		samx5x_print_nvm_error(errs);
-		samx5x_clear_nvm_error(t);
-	}
-
-	bool error = false;
-	/* Unlock */
-	target_mem_write32(t, SAMX5X_NVMC_ADDRESS, dest);
-	samx5x_unlock_current_address(t);
-
-	/* Write within a single page. This may be part or all of the page */
-	target_mem_write(t, dest, src, len);
-
-	/* Issue the write page command */
-	target_mem_write32(t, SAMX5X_NVMC_CTRLB, SAMX5X_CTRLB_CMD_KEY | SAMX5X_CTRLB_CMD_WRITEPAGE);
-
-	/* Poll for NVM Ready */
-	while ((target_mem_read32(t, SAMX5X_NVMC_STATUS) & SAMX5X_STATUS_READY) == 0) {
-		if (target_check_error(t) || samx5x_check_nvm_error(t)) {
-			error = true;
-			break;
-		}
-	}
-
-	if (error || target_check_error(t) || samx5x_check_nvm_error(t)) {
-		DEBUG_ERROR("Error writing flash page at 0x%08" PRIx32 " (len 0x%08" PRIx32 ")\n", dest, (uint32_t)len);
-		return false;
-	}
-
-	/* Lock */
-	samx5x_lock_current_address(t);
-	return true;
-}
-
 /**
  * Erase and write the NVM user page
  */
@@ -65,24 +65,64 @@ static inline size_t sfdp_memory_density_to_capacity_bits(const uint8_t *const d
 		return SFDP_DENSITY_VALUE(density) + 1U;
 }
 
+static const uint32_t sfdp_erase_time_units_ms[4] = {1U, 16U, 128U, 1000U};
+static const uint32_t sfdp_chip_erase_time_units_ms[4] = {16U, 256U, 4000U, 64000U};
+
+/* Insert an erase type into the list, keeping it ordered largest first */
+static void sfdp_insert_erase_type(spi_erase_type_s *const erase_types, const spi_erase_type_s *const erase_type)
+{
+	size_t index = SFDP_ERASE_TYPES - 1U;
+	for (; index > 0U && erase_types[index - 1U].size < erase_type->size; --index)
+		erase_types[index] = erase_types[index - 1U];
+	erase_types[index] = *erase_type;
+}
+
 static spi_parameters_s sfdp_read_basic_parameter_table(
 	target_s *const target, const uint32_t address, const size_t length, const spi_read_func spi_read)
 {
 	sfdp_basic_parameter_table_s parameter_table;
+	memset(&parameter_table, 0, sizeof(parameter_table));
 	const size_t table_length = MIN(sizeof(sfdp_basic_parameter_table_s), length);
 	spi_read(target, SPI_FLASH_CMD_READ_SFDP, address, &parameter_table, table_length);
+	/* The timing information and page size were only added in JESD216A, so check the table has them */
+	const bool has_timings = table_length >= offsetof(sfdp_basic_parameter_table_s, programming_and_chip_erase_timing) +
+			sizeof(programming_and_chip_erase_timing_s);
 
 	spi_parameters_s result;
+	memset(&result, 0, sizeof(result));
 	result.capacity = sfdp_memory_density_to_capacity_bits(parameter_table.memory_density) >> 3U;
 	for (size_t i = 0; i < SFDP_ERASE_TYPES; ++i) {
-		erase_parameters_s *erase_type = &parameter_table.erase_types[i];
-		if (erase_type->opcode == parameter_table.sector_erase_opcode) {
+		const erase_parameters_s *const erase_type = &parameter_table.erase_types[i];
+		/* An erase size exponent of 0 indicates the erase type is not present */
+		if (!erase_type->erase_size_exponent)
+			continue;
+		const uint32_t erase_time_ms = SFDP_ERASE_TIME_COUNT(parameter_table.erase_timing, i) *
+			sfdp_erase_time_units_ms[SFDP_ERASE_TIME_UNITS(parameter_table.erase_timing, i)];
+		const spi_erase_type_s entry = {
+			.size = SFDP_ERASE_SIZE(erase_type),
+			.typical_time_ms = has_timings ? erase_time_ms : 0U,
+			.opcode = erase_type->opcode,
+		};
+		DEBUG_INFO("Erase type %zu: %" PRIu32 " bytes, opcode 0x%02x, typically %" PRIu32 "ms\n", i + 1U, entry.size,
+			entry.opcode, entry.typical_time_ms);
+		sfdp_insert_erase_type(result.erase_types, &entry);
+		if (erase_type->opcode == parameter_table.sector_erase_opcode && !result.sector_size) {
 			result.sector_erase_opcode = erase_type->opcode;
-			result.sector_size = SFDP_ERASE_SIZE(erase_type);
-			break;
+			result.sector_size = entry.size;
 		}
 	}
-	result.page_size = SFDP_PAGE_SIZE(parameter_table);
+	/* If the 4KiB erase opcode didn't match any erase type, use the smallest erase type as the sector size */
+	for (size_t i = SFDP_ERASE_TYPES; i > 0U && !result.sector_size; --i) {
+		const spi_erase_type_s *const erase_type = &result.erase_types[i - 1U];
+		result.sector_erase_opcode = erase_type->opcode;
+		result.sector_size = erase_type->size;
+	}
+	if (has_timings) {
+		result.page_size = SFDP_PAGE_SIZE(parameter_table);
+		result.chip_erase_time_ms = SFDP_CHIP_ERASE_TIME_COUNT(parameter_table) *
+			sfdp_chip_erase_time_units_ms[SFDP_CHIP_ERASE_TIME_UNITS(parameter_table)];
+	} else
+		result.page_size = 256U;
 	return result;
 }
 
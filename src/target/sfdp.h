@@ -46,11 +46,24 @@ typedef struct spi_flash_id {
 	uint8_t capacity;
 } spi_flash_id_s;
 
+#define SFDP_ERASE_TYPES 4U
+
+typedef struct spi_erase_type {
+	/* Size of the region erased by this opcode, 0 if this erase type is not available */
+	uint32_t size;
+	/* Typical time for the erase to complete, 0 if not known */
+	uint32_t typical_time_ms;
+	uint8_t opcode;
+} spi_erase_type_s;
+
 typedef struct spi_parameters {
 	uint32_t page_size;
 	uint32_t sector_size;
 	size_t capacity;
 	uint8_t sector_erase_opcode;
+	/* Available erase types, ordered largest first */
+	spi_erase_type_s erase_types[SFDP_ERASE_TYPES];
+	uint32_t chip_erase_time_ms;
 } spi_parameters_s;
 
 typedef void (*spi_read_func)(target_s *target, uint16_t command, target_addr_t address, void *buffer, size_t length);
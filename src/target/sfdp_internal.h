@@ -52,11 +52,20 @@
 #define SFDP_DENSITY_VALUE(density) \
 	((((density)[3] & 0x7fU) << 24U) | ((density)[2] << 16U) | ((density)[1] << 8U) | (density)[0])
 
-#define SFDP_ERASE_TYPES            4U
 #define SFDP_ERASE_SIZE(erase_type) (1U << ((erase_type)->erase_size_exponent))
 #define SFDP_PAGE_SIZE(parameter_table) \
 	(1U << ((parameter_table).programming_and_chip_erase_timing.programming_timing_ratio_and_page_size >> 4U))
 
+/* Typical erase timings are a 5-bit count and 2-bit units field per erase type, starting at bit 4 */
+#define SFDP_ERASE_TIME_SHIFT(type)       (4U + ((type)*7U))
+#define SFDP_ERASE_TIME_COUNT(timing, type) ((((timing) >> SFDP_ERASE_TIME_SHIFT(type)) & 0x1fU) + 1U)
+#define SFDP_ERASE_TIME_UNITS(timing, type) (((timing) >> (SFDP_ERASE_TIME_SHIFT(type) + 5U)) & 0x03U)
+/* The typical chip erase time is in the top byte of the programming and chip erase timings */
+#define SFDP_CHIP_ERASE_TIME_COUNT(parameter_table) \
+	(((parameter_table).programming_and_chip_erase_timing.erase_timings[2] & 0x1fU) + 1U)
+#define SFDP_CHIP_ERASE_TIME_UNITS(parameter_table) \
+	(((parameter_table).programming_and_chip_erase_timing.erase_timings[2] >> 5U) & 0x03U)
+
 typedef struct sfdp_header {
 	char magic[4];
 	uint8_t version_minor;
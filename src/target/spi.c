@@ -34,8 +34,12 @@
 #include "spi.h"
 #include "sfdp.h"
 
+/* Longest we sleep between status polls, so progress is still reported to GDB regularly */
+#define SPI_FLASH_MAX_POLL_INTERVAL_MS 100U
+
 static bool bmp_spi_flash_erase(target_flash_s *flash, target_addr_t addr, size_t length);
 static bool bmp_spi_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t length);
+static bool bmp_spi_flash_done(target_flash_s *flash);
 
 #if PC_HOSTED == 0
 static void bmp_spi_setup_xfer(
@@ -105,6 +109,30 @@ static inline uint8_t bmp_spi_read_status(target_s *const target, const spi_flas
 	return status;
 }
 
+/*
+ * Wait for the Flash to finish an operation. Rather than hammering the status register, sleep
+ * through most of the operation's typical time and then poll at a fraction of it until done
+ */
+static void bmp_spi_wait_ready(target_s *const target, const spi_flash_s *const flash, const uint32_t typical_time_ms)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	uint32_t initial_delay = typical_time_ms - (typical_time_ms / 4U);
+	while (initial_delay) {
+		const uint32_t delay = MIN(initial_delay, SPI_FLASH_MAX_POLL_INTERVAL_MS);
+		platform_delay(delay);
+		initial_delay -= delay;
+		target_print_progress(&timeout);
+	}
+
+	const uint32_t poll_interval = MIN(typical_time_ms / 16U, SPI_FLASH_MAX_POLL_INTERVAL_MS);
+	while (bmp_spi_read_status(target, flash) & SPI_FLASH_STATUS_BUSY) {
+		if (poll_interval)
+			platform_delay(poll_interval);
+		target_print_progress(&timeout);
+	}
+}
+
 spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin, const size_t length,
 	const spi_read_func spi_read, const spi_write_func spi_write, const spi_run_command_func spi_run_command)
 {
@@ -115,12 +143,15 @@ spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin
 	}
 
 	spi_parameters_s spi_parameters;
-	if (!sfdp_read_parameters(target, &spi_parameters, spi_read)) {
+	if (!sfdp_read_parameters(target, &spi_parameters, spi_read) || !spi_parameters.sector_size) {
 		/* SFDP readout failed, so make some assumptions and hope for the best. */
+		memset(&spi_parameters, 0, sizeof(spi_parameters));
 		spi_parameters.page_size = 256U;
 		spi_parameters.sector_size = 4096U;
 		spi_parameters.capacity = length;
 		spi_parameters.sector_erase_opcode = SPI_FLASH_OPCODE_SECTOR_ERASE;
+		spi_parameters.erase_types[0].size = spi_parameters.sector_size;
+		spi_parameters.erase_types[0].opcode = SPI_FLASH_OPCODE_SECTOR_ERASE;
 	}
 	DEBUG_INFO("Flash size: %" PRIu32 "MiB\n", (uint32_t)spi_parameters.capacity / (1024U * 1024U));
 
@@ -130,11 +161,14 @@ spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin
 	flash->blocksize = spi_parameters.sector_size;
 	flash->write = bmp_spi_flash_write;
 	flash->erase = bmp_spi_flash_erase;
+	flash->done = bmp_spi_flash_done;
 	flash->erased = 0xffU;
 	target_add_flash(target, flash);
 
 	spi_flash->page_size = spi_parameters.page_size;
 	spi_flash->sector_erase_opcode = spi_parameters.sector_erase_opcode;
+	memcpy(spi_flash->erase_types, spi_parameters.erase_types, sizeof(spi_flash->erase_types));
+	spi_flash->chip_erase_time_ms = spi_parameters.chip_erase_time_ms;
 	spi_flash->read = spi_read;
 	spi_flash->write = spi_write;
 	spi_flash->run_command = spi_run_command;
@@ -144,10 +178,8 @@ spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin
 /* Note: These routines assume that the first Flash registered on the target is a SPI Flash device */
 bool bmp_spi_mass_erase(target_s *const target)
 {
-	/* Extract the Flash structure and set up timeouts */
+	/* Extract the Flash structure */
 	const spi_flash_s *const flash = (spi_flash_s *)target->flash;
-	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 500);
 	DEBUG_TARGET("Running %s\n", __func__);
 	/* Go into Flash mode and tell the Flash to enable writing */
 	target->enter_flash_mode(target);
@@ -159,29 +191,88 @@ bool bmp_spi_mass_erase(target_s *const target)
 
 	/* Execute a full chip erase and wait for the operatoin to complete */
 	flash->run_command(target, SPI_FLASH_CMD_CHIP_ERASE, 0U);
-	while (bmp_spi_read_status(target, flash) & SPI_FLASH_STATUS_BUSY)
-		target_print_progress(&timeout);
+	bmp_spi_wait_ready(target, flash, flash->chip_erase_time_ms);
 
 	/* Finally, leave Flash mode to conclude business */
 	return target->exit_flash_mode(target);
 }
 
-static bool bmp_spi_flash_erase(target_flash_s *const flash, const target_addr_t addr, const size_t length)
+/* Pick the largest erase type that fits both the alignment of the address and the length left to erase */
+static const spi_erase_type_s *bmp_spi_erase_type_for(
+	const spi_flash_s *const spi_flash, const target_addr_t addr, const size_t length)
+{
+	for (size_t i = 0; i < SFDP_ERASE_TYPES; ++i) {
+		const spi_erase_type_s *const erase_type = &spi_flash->erase_types[i];
+		if (erase_type->size && erase_type->size <= length && !(addr & (erase_type->size - 1U)))
+			return erase_type;
+	}
+	return NULL;
+}
+
+/* Erase the pending range, using a chip erase if it covers the whole device */
+static bool bmp_spi_flash_erase_pending(target_flash_s *const flash)
 {
-	(void)length;
 	target_s *const target = flash->t;
-	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
-	spi_flash->run_command(target, SPI_FLASH_CMD_WRITE_ENABLE, 0U);
-	if (!(bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_WRITE_ENABLED))
-		return false;
+	spi_flash_s *const spi_flash = (spi_flash_s *)flash;
+	target_addr_t addr = spi_flash->erase_pending_begin;
+	size_t length = spi_flash->erase_pending_length;
+	spi_flash->erase_pending_length = 0U;
+
+	const bool whole_chip = addr == 0U && length >= flash->length;
+	while (length) {
+		const spi_erase_type_s *const erase_type = bmp_spi_erase_type_for(spi_flash, addr, length);
+		if (!erase_type && !whole_chip)
+			return false;
 
-	spi_flash->run_command(
-		target, SPI_FLASH_CMD_SECTOR_ERASE | SPI_FLASH_OPCODE(spi_flash->sector_erase_opcode), addr - flash->start);
-	while (bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_BUSY)
-		continue;
+		spi_flash->run_command(target, SPI_FLASH_CMD_WRITE_ENABLE, 0U);
+		if (!(bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_WRITE_ENABLED))
+			return false;
+
+		if (whole_chip) {
+			DEBUG_TARGET("%s: chip erase\n", __func__);
+			spi_flash->run_command(target, SPI_FLASH_CMD_CHIP_ERASE, 0U);
+			bmp_spi_wait_ready(target, spi_flash, spi_flash->chip_erase_time_ms);
+			break;
+		}
+
+		spi_flash->run_command(target, SPI_FLASH_CMD_SECTOR_ERASE | SPI_FLASH_OPCODE(erase_type->opcode), addr);
+		bmp_spi_wait_ready(target, spi_flash, erase_type->typical_time_ms);
+		addr += erase_type->size;
+		length -= erase_type->size;
+	}
 	return true;
 }
 
+/*
+ * Sector erases are accumulated into a contiguous pending range and only issued when the range
+ * is broken or the erase operation completes, so they can be coalesced into the largest erases available
+ */
+static bool bmp_spi_flash_erase(target_flash_s *const flash, const target_addr_t addr, const size_t length)
+{
+	spi_flash_s *const spi_flash = (spi_flash_s *)flash;
+	const target_addr_t offset = addr - flash->start;
+	if (spi_flash->erase_pending_length &&
+		offset == spi_flash->erase_pending_begin + spi_flash->erase_pending_length) {
+		spi_flash->erase_pending_length += length;
+		return true;
+	}
+
+	bool result = true;
+	if (spi_flash->erase_pending_length)
+		result = bmp_spi_flash_erase_pending(flash);
+	spi_flash->erase_pending_begin = offset;
+	spi_flash->erase_pending_length = length;
+	return result;
+}
+
+static bool bmp_spi_flash_done(target_flash_s *const flash)
+{
+	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
+	if (!spi_flash->erase_pending_length)
+		return true;
+	return bmp_spi_flash_erase_pending(flash);
+}
+
 static bool bmp_spi_flash_write(
 	target_flash_s *const flash, const target_addr_t dest, const void *const src, const size_t length)
 {
@@ -39,6 +39,7 @@
 #include "general.h"
 #include "target_internal.h"
 #include "spi_types.h"
+#include "sfdp.h"
 
 #define SPI_FLASH_OPCODE_MASK      0x00ffU
 #define SPI_FLASH_OPCODE(x)        ((x)&SPI_FLASH_OPCODE_MASK)
@@ -70,7 +71,6 @@
 #define SPI_FLASH_STATUS_BUSY          0x01U
 #define SPI_FLASH_STATUS_WRITE_ENABLED 0x02U
 
-typedef void (*spi_read_func)(target_s *target, uint16_t command, target_addr_t address, void *buffer, size_t length);
 typedef void (*spi_write_func)(
 	target_s *target, uint16_t command, target_addr_t address, const void *buffer, size_t length);
 typedef void (*spi_run_command_func)(target_s *target, uint16_t command, target_addr_t address);
@@ -79,6 +79,12 @@ typedef struct spi_flash {
 	target_flash_s flash;
 	uint32_t page_size;
 	uint8_t sector_erase_opcode;
+	/* Erase types available, largest first, and the typical chip erase time */
+	spi_erase_type_s erase_types[SFDP_ERASE_TYPES];
+	uint32_t chip_erase_time_ms;
+	/* Contiguous range of sectors waiting to be erased, relative to the start of the Flash */
+	target_addr_t erase_pending_begin;
+	size_t erase_pending_length;
 
 	spi_read_func read;
 	spi_write_func write;
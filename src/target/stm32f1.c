@@ -48,8 +48,10 @@ const command_s stm32f1_cmd_list[] = {
 	{NULL, NULL, NULL},
 };
 
+static bool stm32f1_flash_prepare(target_flash_s *flash);
 static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len);
 static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
+static bool stm32f1_flash_done(target_flash_s *flash);
 static bool stm32f1_mass_erase(target_s *target);
 
 /* Flash Program ad Erase Controller Register Map */
@@ -109,19 +111,46 @@ static bool stm32f1_mass_erase(target_s *target);
 #define DBGMCU_IDCODE_MM32L0 0x40013400U
 #define DBGMCU_IDCODE_MM32F3 0x40007080U
 
+/*
+ * Flash stub layout in SRAM: the stub itself, followed by two page sized write buffers
+ * so the next page can be loaded while the stub programs the current one.
+ */
+#define STM32F1_STUB_BASE          0x20000000U
+#define STM32F1_STUB_BUFFER_OFFSET 0x100U
+#define STM32F1_STUB_BUFFER_BASE   (STM32F1_STUB_BASE + STM32F1_STUB_BUFFER_OFFSET)
+#define STM32F1_STUB_TIMEOUT_MS    5000U
+#define STM32F1_STUB_EXIT_SUCCESS  0
+
+static const uint16_t stm32f1_flash_stub[] = {
+#include "flashstub/stm32f1.stub"
+};
+
+typedef struct stm32f1_flash {
+	target_flash_s f;
+	/* Whether the stub and its buffers fit in this part's SRAM, and so are in use for writes */
+	bool use_stub;
+	/* Which of the two stub buffers the next write goes into */
+	uint8_t stage_buffer;
+	/* Whether the stub is currently running a write */
+	bool stub_running;
+} stm32f1_flash_s;
+
 static void stm32f1_add_flash(target_s *target, uint32_t addr, size_t length, size_t erasesize)
 {
-	target_flash_s *flash = calloc(1, sizeof(*flash));
-	if (!flash) { /* calloc failed: heap exhaustion */
+	stm32f1_flash_s *sf = calloc(1, sizeof(*sf));
+	if (!sf) { /* calloc failed: heap exhaustion */
 		DEBUG_ERROR("calloc: failed in %s\n", __func__);
 		return;
 	}
 
+	target_flash_s *flash = &sf->f;
 	flash->start = addr;
 	flash->length = length;
 	flash->blocksize = erasesize;
+	flash->prepare = stm32f1_flash_prepare;
 	flash->erase = stm32f1_flash_erase;
 	flash->write = stm32f1_flash_write;
+	flash->done = stm32f1_flash_done;
 	flash->writesize = erasesize;
 	flash->erased = 0xff;
 	target_add_flash(target, flash);
@@ -651,6 +680,46 @@ static uint32_t stm32f1_bank_offset_for(target_addr_t addr)
 	return FLASH_BANK1_OFFSET;
 }
 
+/* The stub and both its buffers have to fit in the SRAM the part was registered with */
+static bool stm32f1_flash_stub_fits(const target_flash_s *const flash)
+{
+	for (const target_ram_s *ram = flash->t->ram; ram; ram = ram->next) {
+		if (ram->start == STM32F1_STUB_BASE)
+			return ram->length >= STM32F1_STUB_BUFFER_OFFSET + (2U * flash->writesize);
+	}
+	return false;
+}
+
+/* Wait for any write the stub is running to complete */
+static bool stm32f1_flash_stub_wait(stm32f1_flash_s *const sf)
+{
+	if (!sf->stub_running)
+		return true;
+	sf->stub_running = false;
+	return cortexm_wait_stub(sf->f.t, STM32F1_STUB_TIMEOUT_MS) == STM32F1_STUB_EXIT_SUCCESS;
+}
+
+static bool stm32f1_flash_prepare(target_flash_s *const flash)
+{
+	target_s *const target = flash->t;
+	stm32f1_flash_s *const sf = (stm32f1_flash_s *)flash;
+	sf->stub_running = false;
+	sf->use_stub = false;
+	if (flash->operation != FLASH_OPERATION_WRITE || !stm32f1_flash_stub_fits(flash))
+		return true;
+
+	/* The stub can't unlock the FPEC itself, so make sure every bank this Flash covers is unlocked */
+	const target_addr_t end = flash->start + flash->length - 1U;
+	if ((target->part_id == 0x430U && end >= FLASH_BANK_SPLIT && !stm32f1_flash_unlock(target, FLASH_BANK2_OFFSET)) ||
+		(flash->start < FLASH_BANK_SPLIT && !stm32f1_flash_unlock(target, FLASH_BANK1_OFFSET)))
+		return false;
+
+	target_mem_write(target, STM32F1_STUB_BASE, stm32f1_flash_stub, sizeof(stm32f1_flash_stub));
+	sf->stage_buffer = 0U;
+	sf->use_stub = !target_check_error(target);
+	return sf->use_stub;
+}
+
 static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len)
 {
 	target_s *target = flash->t;
@@ -688,8 +757,34 @@ static size_t stm32f1_bank1_length(target_addr_t addr, size_t len)
 	return len;
 }
 
+/*
+ * Hand a page to the stub. The page is loaded into whichever stub buffer is free
+ * while the stub is still programming the previous one, then the stub is restarted on it.
+ * Pages never straddle the bank split, so each one goes to a single bank.
+ */
+static bool stm32f1_flash_stub_write(stm32f1_flash_s *const sf, const target_addr_t dest, const void *const src,
+	const size_t len)
+{
+	target_s *const target = sf->f.t;
+	const uint32_t bank_offset = target->part_id == 0x430U ? stm32f1_bank_offset_for(dest) : FLASH_BANK1_OFFSET;
+	const uint32_t buffer = STM32F1_STUB_BUFFER_BASE + (sf->stage_buffer * sf->f.writesize);
+	target_mem_write(target, buffer, src, len);
+	if (target_check_error(target) || !stm32f1_flash_stub_wait(sf))
+		return false;
+
+	if (!cortexm_start_stub(target, STM32F1_STUB_BASE, dest, buffer, len, FPEC_BASE + bank_offset))
+		return false;
+	sf->stub_running = true;
+	sf->stage_buffer ^= 1U;
+	return true;
+}
+
 static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len)
 {
+	stm32f1_flash_s *const sf = (stm32f1_flash_s *)flash;
+	if (sf->use_stub)
+		return stm32f1_flash_stub_write(sf, dest, src, len);
+
 	target_s *target = flash->t;
 	const size_t offset = stm32f1_bank1_length(dest, len);
 
@@ -722,6 +817,14 @@ static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const
 	return true;
 }
 
+static bool stm32f1_flash_done(target_flash_s *const flash)
+{
+	stm32f1_flash_s *const sf = (stm32f1_flash_s *)flash;
+	const bool result = stm32f1_flash_stub_wait(sf);
+	sf->use_stub = false;
+	return result;
+}
+
 static bool stm32f1_mass_erase_bank(
 	target_s *const target, const uint32_t bank_offset, platform_timeout_s *const timeout)
 {
@@ -40,6 +40,7 @@
 #include "target_internal.h"
 #include "cortexm.h"
 #include "stm32_common.h"
+#include "crc32.h"
 
 #define FLASH_ACR       0x00U
 #define FLASH_KEYR      0x04U
@@ -51,6 +52,8 @@
 #define FLASH_OPTSR_CUR 0x1cU
 #define FLASH_OPTSR     0x20U
 #define FLASH_CRCCR     0x50U
+#define FLASH_CRCSADDR  0x54U
+#define FLASH_CRCEADDR  0x58U
 #define FLASH_CRCDATA   0x5cU
 
 /* Flash Program and Erase Controller Register Map */
@@ -126,6 +129,10 @@
 #define STM32H74xxG_FLASH_SIZE      0x00100000U
 #define NUM_SECTOR_PER_BANK         8U
 #define FLASH_SECTOR_SIZE           0x20000U
+/* Flash is programmed and CRC'd in units of 256-bit Flash words */
+#define FLASH_WORD_SIZE 32U
+/* Length of Flash at the end of each range used to check the CRC engine against the software CRC32 */
+#define STM32H7_CRC_CHECK_LENGTH 256U
 
 #define ID_STM32H74x 0x4500U /* RM0433, RM0399 */
 #define ID_STM32H7Bx 0x4800U /* RM0455 */
@@ -135,10 +142,22 @@ typedef struct stm32h7_flash {
 	target_flash_s target_flash;
 	align_e psize;
 	uint32_t regbase;
+	/* Bitmap of the sectors in this bank waiting to be erased */
+	uint8_t erase_pending;
+	/* Whether a sector erase has been started on this bank and not yet seen to complete */
+	bool erase_running;
 } stm32h7_flash_s;
 
+typedef enum stm32h7_crc_engine {
+	STM32H7_CRC_ENGINE_UNCHECKED,
+	STM32H7_CRC_ENGINE_MATCHES,
+	STM32H7_CRC_ENGINE_MISMATCHED,
+} stm32h7_crc_engine_e;
+
 typedef struct stm32h7_priv {
 	uint32_t dbg_cr;
+	/* Whether the Flash CRC engine is known to compute the same CRC32 as GDB */
+	stm32h7_crc_engine_e crc_engine;
 } stm32h7_priv_s;
 
 /* static bool stm32h7_cmd_option(target_s *t, int argc, const char **argv); */
@@ -160,7 +179,11 @@ static bool stm32h7_attach(target_s *target);
 static void stm32h7_detach(target_s *target);
 static bool stm32h7_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len);
 static bool stm32h7_flash_write(target_flash_s *target_flash, target_addr_t dest, const void *src, size_t len);
+static bool stm32h7_flash_done(target_flash_s *target_flash);
+static bool stm32h7_flash_poll(target_flash_s *target_flash);
+static bool stm32h7_exit_flash_mode(target_s *target);
 static bool stm32h7_mass_erase(target_s *target);
+static bool stm32h7_mem_crc32(target_s *target, uint32_t *crc, target_addr_t base, size_t len);
 
 static void stm32h7_add_flash(target_s *target, uint32_t addr, size_t length, size_t blocksize)
 {
@@ -176,6 +199,8 @@ static void stm32h7_add_flash(target_s *target, uint32_t addr, size_t length, si
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32h7_flash_erase;
 	target_flash->write = stm32h7_flash_write;
+	target_flash->done = stm32h7_flash_done;
+	target_flash->poll = stm32h7_flash_poll;
 	target_flash->writesize = 2048;
 	target_flash->erased = 0xffU;
 	if (addr < STM32H7_FLASH_BANK2_BASE)
@@ -195,6 +220,8 @@ bool stm32h7_probe(target_s *target)
 	target->attach = stm32h7_attach;
 	target->detach = stm32h7_detach;
 	target->mass_erase = stm32h7_mass_erase;
+	target->exit_flash_mode = stm32h7_exit_flash_mode;
+	target->mem_crc32 = stm32h7_mem_crc32;
 	target_add_commands(target, stm32h7_cmd_list, target->driver);
 
 	/* Save private storage */
@@ -302,36 +329,137 @@ static bool stm32h7_flash_unlock(target_s *const target, const uint32_t addr)
 	return !(target_mem_read32(target, regbase + FLASH_CR) & FLASH_CR_LOCK);
 }
 
-static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_t addr, const size_t len)
+/* Start erasing the next pending sector in a bank, returning false if there are none left */
+static bool stm32h7_flash_erase_next(target_s *const target, stm32h7_flash_s *const flash)
 {
-	target_s *target = target_flash->t;
-	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
-	/* Unlock the Flash */
-	if (!stm32h7_flash_unlock(target, addr))
+	if (!flash->erase_pending)
 		return false;
-	/* We come out of reset with HSI 64 MHz. Adapt FLASH_ACR.*/
-	target_mem_write32(target, flash->regbase + FLASH_ACR, 0);
-	addr &= (NUM_SECTOR_PER_BANK * FLASH_SECTOR_SIZE) - 1U;
-	const size_t end_sector = (addr + len - 1U) / FLASH_SECTOR_SIZE;
-	const align_e psize = flash->psize;
-	const uint32_t reg_base = flash->regbase;
-
-	for (size_t begin_sector = addr / FLASH_SECTOR_SIZE; begin_sector <= end_sector; ++begin_sector) {
-		/* Erase the current Flash sector */
-		const uint32_t ctrl = (psize * FLASH_CR_PSIZE16) | FLASH_CR_SER | (begin_sector * FLASH_CR_SNB_1);
-		target_mem_write32(target, reg_base + FLASH_CR, ctrl);
-		target_mem_write32(target, reg_base + FLASH_CR, ctrl | FLASH_CR_START);
+	const uint32_t sector = (uint32_t)__builtin_ctz(flash->erase_pending);
+	flash->erase_pending &= ~(1U << sector);
 
-		/* Wait for the operation to complete and report errors */
-		DEBUG_INFO("Erasing, ctrl = %08" PRIx32 " status = %08" PRIx32 "\n",
-			target_mem_read32(target, reg_base + FLASH_CR), target_mem_read32(target, reg_base + FLASH_SR));
+	/* Erase the sector */
+	const uint32_t ctrl = (flash->psize * FLASH_CR_PSIZE16) | FLASH_CR_SER | (sector * FLASH_CR_SNB_1);
+	target_mem_write32(target, flash->regbase + FLASH_CR, ctrl);
+	target_mem_write32(target, flash->regbase + FLASH_CR, ctrl | FLASH_CR_START);
+	DEBUG_INFO("Erasing, ctrl = %08" PRIx32 " status = %08" PRIx32 "\n",
+		target_mem_read32(target, flash->regbase + FLASH_CR), target_mem_read32(target, flash->regbase + FLASH_SR));
+	return true;
+}
 
-		if (!stm32h7_flash_busy_wait(target, reg_base))
+/*
+ * Check on the erases queued on a bank without waiting: start the bank on its queue if it is idle,
+ * and move it on to the next sector each time one completes. Returns false if the bank reports an error.
+ */
+static bool stm32h7_flash_erase_poll(target_s *const target, stm32h7_flash_s *const flash)
+{
+	if (!flash->erase_running) {
+		if (!flash->erase_pending)
+			return true;
+		/* Unlock the Flash */
+		if (!stm32h7_flash_unlock(target, flash->target_flash.start)) {
+			flash->erase_pending = 0U;
 			return false;
+		}
+		/* We come out of reset with HSI 64 MHz. Adapt FLASH_ACR.*/
+		target_mem_write32(target, flash->regbase + FLASH_ACR, 0);
+		flash->erase_running = stm32h7_flash_erase_next(target, flash);
+		return true;
+	}
+
+	const uint32_t status = target_mem_read32(target, flash->regbase + FLASH_SR);
+	if ((status & FLASH_SR_ERROR_MASK) || target_check_error(target)) {
+		DEBUG_ERROR("%s: error status %08" PRIx32 "\n", __func__, status);
+		target_mem_write32(target, flash->regbase + FLASH_CCR, status & FLASH_SR_ERROR_MASK);
+		flash->erase_pending = 0U;
+		flash->erase_running = false;
+		return false;
+	}
+	if (!(status & (FLASH_SR_BSY | FLASH_SR_QW)))
+		flash->erase_running = stm32h7_flash_erase_next(target, flash);
+	return true;
+}
+
+/*
+ * Run the erases queued on both banks until the given bank (or both, if NULL) has none left.
+ * The two FPECs erase independently, so keep both busy and poll them together rather than
+ * erasing one sector at a time. The other bank's erases carry on in the background after
+ * we return, and are moved along by stm32h7_flash_poll() while this bank is programmed.
+ */
+static bool stm32h7_flash_erase_wait(target_s *const target, const stm32h7_flash_s *const until)
+{
+	stm32h7_flash_s *banks[2] = {NULL, NULL};
+	for (target_flash_s *target_flash = target->flash; target_flash; target_flash = target_flash->next) {
+		if (target_flash->erase == stm32h7_flash_erase) {
+			stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+			banks[flash->regbase == FPEC1_BASE ? 0U : 1U] = flash;
+		}
+	}
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	bool result = true;
+	while (true) {
+		bool busy = false;
+		for (size_t bank = 0; bank < 2U; ++bank) {
+			stm32h7_flash_s *const flash = banks[bank];
+			if (!flash)
+				continue;
+			result &= stm32h7_flash_erase_poll(target, flash);
+			if (!until || flash == until)
+				busy |= flash->erase_running || flash->erase_pending;
+		}
+		if (!result || !busy)
+			break;
+		target_print_progress(&timeout);
+	}
+
+	/* On failure, drop whatever was left queued */
+	if (!result) {
+		for (size_t bank = 0; bank < 2U; ++bank) {
+			if (banks[bank])
+				banks[bank]->erase_pending = 0U;
+		}
 	}
+	return result;
+}
+
+/* Sector erases are only queued here, and get run in the background ahead of the writes to their bank */
+static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_t addr, const size_t len)
+{
+	stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	addr &= (NUM_SECTOR_PER_BANK * FLASH_SECTOR_SIZE) - 1U;
+	const size_t end_sector = (addr + len - 1U) / FLASH_SECTOR_SIZE;
+	for (size_t sector = addr / FLASH_SECTOR_SIZE; sector <= end_sector; ++sector)
+		flash->erase_pending |= 1U << sector;
 	return true;
 }
 
+static bool stm32h7_flash_poll(target_flash_s *const target_flash)
+{
+	return stm32h7_flash_erase_poll(target_flash->t, (stm32h7_flash_s *)target_flash);
+}
+
+/*
+ * The erase operation is left open past target_flash_erase() as we have a poll hook, so this runs once
+ * the bank is about to be written, or on target_flash_complete() if no write follows. Either way its
+ * erases have to be finished now, while the other bank's carry on in the background.
+ */
+static bool stm32h7_flash_done(target_flash_s *const target_flash)
+{
+	if (target_flash->operation != FLASH_OPERATION_ERASE)
+		return true;
+	return stm32h7_flash_erase_wait(target_flash->t, (const stm32h7_flash_s *)target_flash);
+}
+
+static bool stm32h7_exit_flash_mode(target_s *const target)
+{
+	/* Every bank's erases should have been finished by their done() already, but make sure */
+	const bool result = stm32h7_flash_erase_wait(target, NULL);
+	/* Reset the target to a known state as we would without this hook */
+	target_reset(target);
+	return result;
+}
+
 static bool stm32h7_flash_write(
 	target_flash_s *const target_flash, const target_addr_t dest, const void *const src, const size_t len)
 {
@@ -450,14 +578,16 @@ static bool stm32h7_uid(target_s *target, int argc, const char **argv)
 	return true;
 }
 
-static bool stm32h7_crc_bank(target_s *target, uint32_t addr)
+/* Run the Flash CRC engine on a bank, either over the whole bank or over the range set in CRCSADDR/CRCEADDR */
+static bool stm32h7_crc_run(target_s *const target, const uint32_t addr, const bool all_bank)
 {
 	const uint32_t reg_base = stm32h7_flash_bank_base(addr);
 	if (!stm32h7_flash_unlock(target, addr))
 		return false;
 
 	target_mem_write32(target, reg_base + FLASH_CR, FLASH_CR_CRC_EN);
-	const uint32_t crc_ctrl = FLASH_CRCCR_CRC_BURST_3 | FLASH_CRCCR_CLEAN_CRC | FLASH_CRCCR_ALL_BANK;
+	const uint32_t crc_ctrl =
+		FLASH_CRCCR_CRC_BURST_3 | FLASH_CRCCR_CLEAN_CRC | (all_bank ? FLASH_CRCCR_ALL_BANK : 0U);
 	target_mem_write32(target, reg_base + FLASH_CRCCR, crc_ctrl);
 	target_mem_write32(target, reg_base + FLASH_CRCCR, crc_ctrl | FLASH_CRCCR_START_CRC);
 	uint32_t status = FLASH_SR_CRC_BUSY;
@@ -478,6 +608,63 @@ static bool stm32h7_crc_bank(target_s *target, uint32_t addr)
 	return true;
 }
 
+static bool stm32h7_crc_bank(target_s *const target, const uint32_t addr)
+{
+	return stm32h7_crc_run(target, addr, true);
+}
+
+/* Compute the CRC32 of a Flash word aligned range within a single bank using the Flash CRC engine */
+static bool stm32h7_crc_range(target_s *const target, uint32_t *const crc, const target_addr_t base, const size_t len)
+{
+	const uint32_t reg_base = stm32h7_flash_bank_base(base);
+	/* The end address is that of the last 32-bit word included in the CRC */
+	target_mem_write32(target, reg_base + FLASH_CRCSADDR, base);
+	target_mem_write32(target, reg_base + FLASH_CRCEADDR, base + len - 4U);
+	const bool result = !target_check_error(target) && stm32h7_crc_run(target, base, false);
+	if (result)
+		*crc = target_mem_read32(target, reg_base + FLASH_CRCDATA);
+	target_mem_write32(target, reg_base + FLASH_CR, 0);
+	return result && !target_check_error(target);
+}
+
+/*
+ * Fast path for GDB's qCRC (compare-sections) over Flash. The engine works a bank at a time
+ * on Flash words, so only ranges within one bank with Flash word alignment are handled.
+ * Every request first has the engine CRC the slice at the end of the range and checks that
+ * against the software CRC32 of the same slice, so we only ever answer with a CRC that GDB
+ * will agree with. Anything going wrong hands the request back to the software CRC32.
+ */
+static bool stm32h7_mem_crc32(target_s *const target, uint32_t *const crc, const target_addr_t base, const size_t len)
+{
+	stm32h7_priv_s *const priv = (stm32h7_priv_s *)target->target_storage;
+	target_flash_s *const flash = target_flash_for_addr(target, base);
+	if (priv->crc_engine == STM32H7_CRC_ENGINE_MISMATCHED || !flash || flash->erase != stm32h7_flash_erase || !len ||
+		len > flash->length - (base - flash->start) || (base | len) & (FLASH_WORD_SIZE - 1U))
+		return false;
+
+	const size_t check_length = MIN(len, STM32H7_CRC_CHECK_LENGTH);
+	const target_addr_t check_base = base + len - check_length;
+	uint32_t engine_crc = 0;
+	uint32_t software_crc = 0;
+	if (!stm32h7_crc_range(target, &engine_crc, check_base, check_length) ||
+		!generic_crc32(target, &software_crc, check_base, check_length))
+		return false;
+	if (engine_crc != software_crc) {
+		DEBUG_WARN("Flash CRC engine does not match the software CRC32, no longer using it\n");
+		priv->crc_engine = STM32H7_CRC_ENGINE_MISMATCHED;
+		return false;
+	}
+	if (priv->crc_engine == STM32H7_CRC_ENGINE_UNCHECKED) {
+		DEBUG_INFO("Flash CRC engine matches the software CRC32\n");
+		priv->crc_engine = STM32H7_CRC_ENGINE_MATCHES;
+	}
+	if (check_length == len) {
+		*crc = engine_crc;
+		return true;
+	}
+	return stm32h7_crc_range(target, crc, base, len);
+}
+
 static bool stm32h7_crc(target_s *target, int argc, const char **argv)
 {
 	(void)argc;
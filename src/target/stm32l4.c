@@ -58,8 +58,10 @@ static bool stm32l4_cmd_option(target_s *t, int argc, const char **argv);
 
 static bool stm32l4_attach(target_s *t);
 static void stm32l4_detach(target_s *t);
+static bool stm32l4_flash_prepare(target_flash_s *f);
 static bool stm32l4_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool stm32l4_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
+static bool stm32l4_flash_done(target_flash_s *f);
 static bool stm32l4_mass_erase(target_s *t);
 
 const command_s stm32l4_cmd_list[] = {
@@ -139,11 +141,41 @@ const command_s stm32l4_cmd_list[] = {
 #define STM32L4_FLASH_SIZE_REG 0x1fff75e0U
 #define STM32L5_FLASH_SIZE_REG 0x0bfa05e0U
 
+#define STM32L4_RCC_BASE      0x40021000U
+#define STM32WX_RCC_BASE      0x58000000U
+#define RCC_CR(base)          ((base) + 0x00U)
+#define RCC_CFGR(base)        ((base) + 0x08U)
+#define RCC_CR_MSIRDY         (1U << 1U)
+#define RCC_CR_MSIRGSEL       (1U << 3U)
+#define RCC_CR_MSIRANGE_SHIFT 4U
+#define RCC_CR_MSIRANGE_MASK  (0xfU << RCC_CR_MSIRANGE_SHIFT)
+#define RCC_CR_MSIRANGE_8MHZ  7U
+#define RCC_CR_MSIRANGE_16MHZ 8U
+#define RCC_CFGR_SWS_MASK     (3U << 2U)
+#define RCC_CFGR_SWS_MSI      (0U << 2U)
+#define RCC_CFGR_SWS_HSI16    (1U << 2U)
+#define RCC_CFGR_HPRE_MASK    (0xfU << 4U)
+
 #define STM32L5_RCC_APB1ENR1       0x50021058U
 #define STM32L5_RCC_APB1ENR1_PWREN (1U << 28U)
 #define STM32L5_PWR_CR1            0x50007000U
 #define STM32L5_PWR_CR1_VOS        (3U << 9U)
 
+/*
+ * Flash stub layout in SRAM: the stub itself, followed by two write buffers so the
+ * next buffer can be loaded while the stub programs the current one. This fits in
+ * the 12KiB of SRAM1 on the smallest parts (STM32WB1x).
+ */
+#define STM32L4_STUB_BASE         0x20000000U
+#define STM32L4_STUB_BUFFER_BASE  (STM32L4_STUB_BASE + 0x100U)
+#define STM32L4_STUB_WRITE_SIZE   2048U
+#define STM32L4_STUB_TIMEOUT_MS   5000U
+#define STM32L4_STUB_EXIT_SUCCESS 0
+
+/* Fast programming row sizes: 32 double words on the L4, L4+ and G4, 64 on the WB and WL */
+#define STM32L4_FAST_ROW_SIZE 256U
+#define STM32WX_FAST_ROW_SIZE 512U
+
 #define DUAL_BANK     0x80U
 #define RAM_COUNT_MSK 0x07U
 
@@ -194,6 +226,17 @@ typedef struct stm32l4_device_info {
 typedef struct stm32l4_flash {
 	target_flash_s f;
 	uint32_t bank1_start;
+	/* Erases are queued into this range so a whole bank can be mass erased in one go */
+	target_addr_t erase_begin;
+	size_t erase_length;
+	/* Whether the bank has been mass erased since it was last written, which fast programming needs */
+	bool bank_erased;
+	/* Fast programming row size for the current write operation, 0 for standard programming */
+	uint16_t row_size;
+	/* Which of the two stub buffers the next write goes into */
+	uint8_t stage_buffer;
+	/* Whether the stub is currently running a write */
+	bool stub_running;
 } stm32l4_flash_s;
 
 typedef struct stm32l4_priv {
@@ -253,6 +296,10 @@ static const uint32_t stm32wb_flash_regs_map[FLASH_REGS_COUNT] = {
 	STM32L4_FLASH_SIZE_REG,    /* FLASHSIZE */
 };
 
+static const uint16_t stm32l4_flash_stub[] = {
+#include "flashstub/stm32l4.stub"
+};
+
 static stm32l4_device_info_s const stm32l4_device_info[] = {
 	{
 		.device_id = ID_STM32L41,
@@ -475,9 +522,11 @@ static void stm32l4_add_flash(
 	f->start = addr;
 	f->length = length;
 	f->blocksize = blocksize;
+	f->prepare = stm32l4_flash_prepare;
 	f->erase = stm32l4_flash_erase;
 	f->write = stm32l4_flash_write;
-	f->writesize = 2048;
+	f->done = stm32l4_flash_done;
+	f->writesize = STM32L4_STUB_WRITE_SIZE;
 	f->erased = 0xffU;
 	sf->bank1_start = bank1_start;
 	target_add_flash(t, f);
@@ -689,18 +738,126 @@ static bool stm32l4_flash_busy_wait(target_s *const t, platform_timeout_s *timeo
 	return true;
 }
 
-static bool stm32l4_flash_erase(target_flash_s *const f, const target_addr_t addr, const size_t len)
+static bool stm32l4_cmd_erase(target_s *const t, const uint32_t action)
 {
-	target_s *t = f->t;
-	const stm32l4_flash_s *const sf = (stm32l4_flash_s *)f;
+	stm32l4_flash_unlock(t);
+	/* Erase time is 25 ms. Timeout logic shouldn't get fired.*/
+	/* Flash erase action start instruction */
+	stm32l4_flash_write32(t, FLASH_CR, action);
+	stm32l4_flash_write32(t, FLASH_CR, action | FLASH_CR_STRT);
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	/* Wait for completion or an error */
+	return stm32l4_flash_busy_wait(t, &timeout);
+}
+
+static bool stm32l4_mass_erase(target_s *const t)
+{
+	return stm32l4_cmd_erase(t, FLASH_CR_MER1 | FLASH_CR_MER2);
+}
+
+static bool stm32l4_flash_stub_supported(const target_s *const t)
+{
+	/* The L5's FPEC has a different register layout and no fast programming, so it is driven from here */
+	const stm32l4_priv_s *const priv = (const stm32l4_priv_s *)t->target_storage;
+	return priv->device->family != STM32L4_FAMILY_L55x;
+}
+
+/*
+ * Fast programming needs HCLK at 8MHz or more, but the parts running from MSI come out of reset at 4MHz.
+ * Entering Flash mode resets the target, so step MSI up to 16MHz, which all of these parts run at without
+ * Flash wait states in the reset voltage range, and leave the reset on exiting Flash mode to put it back.
+ */
+static bool stm32l4_flash_fast_clock(target_s *const t)
+{
+	const stm32l4_priv_s *const priv = (const stm32l4_priv_s *)t->target_storage;
+	const stm32l4_family_e family = priv->device->family;
+	const bool is_wx = family == STM32L4_FAMILY_WBxx || family == STM32L4_FAMILY_WLxx;
+	const uint32_t rcc_base = is_wx ? STM32WX_RCC_BASE : STM32L4_RCC_BASE;
+
+	const uint32_t cfgr = target_mem_read32(t, RCC_CFGR(rcc_base));
+	if (cfgr & RCC_CFGR_HPRE_MASK)
+		return false;
+	if ((cfgr & RCC_CFGR_SWS_MASK) == RCC_CFGR_SWS_HSI16)
+		return true;
+	if ((cfgr & RCC_CFGR_SWS_MASK) != RCC_CFGR_SWS_MSI)
+		return false;
+
+	const uint32_t ctrl = target_mem_read32(t, RCC_CR(rcc_base));
+	/* The WB has no range select bit and always runs MSI at the range given in RCC_CR */
+	const bool range_selected = family == STM32L4_FAMILY_WBxx || (ctrl & RCC_CR_MSIRGSEL);
+	if (range_selected && (ctrl & RCC_CR_MSIRANGE_MASK) >> RCC_CR_MSIRANGE_SHIFT >= RCC_CR_MSIRANGE_8MHZ)
+		return true;
+
+	const uint32_t range_select = family == STM32L4_FAMILY_WBxx ? 0U : RCC_CR_MSIRGSEL;
+	target_mem_write32(t, RCC_CR(rcc_base),
+		(ctrl & ~RCC_CR_MSIRANGE_MASK) | (RCC_CR_MSIRANGE_16MHZ << RCC_CR_MSIRANGE_SHIFT) | range_select);
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 10);
+	while (!(target_mem_read32(t, RCC_CR(rcc_base)) & RCC_CR_MSIRDY)) {
+		if (target_check_error(t) || platform_timeout_is_expired(&timeout))
+			return false;
+	}
+	return true;
+}
+
+static uint16_t stm32l4_flash_fast_row_size(const target_s *const t)
+{
+	const stm32l4_priv_s *const priv = (const stm32l4_priv_s *)t->target_storage;
+	const stm32l4_family_e family = priv->device->family;
+	if (family == STM32L4_FAMILY_WBxx || family == STM32L4_FAMILY_WLxx)
+		return STM32WX_FAST_ROW_SIZE;
+	return STM32L4_FAST_ROW_SIZE;
+}
+
+/* Wait for any write the stub is running to complete */
+static bool stm32l4_flash_stub_wait(stm32l4_flash_s *const sf)
+{
+	if (!sf->stub_running)
+		return true;
+	sf->stub_running = false;
+	return cortexm_wait_stub(sf->f.t, STM32L4_STUB_TIMEOUT_MS) == STM32L4_STUB_EXIT_SUCCESS;
+}
+
+static bool stm32l4_flash_prepare(target_flash_s *const f)
+{
+	target_s *const t = f->t;
+	stm32l4_flash_s *const sf = (stm32l4_flash_s *)f;
+	sf->erase_length = 0U;
+	sf->stub_running = false;
 
 	/* STM32WBXX ERRATA ES0394 2.2.9: OPTVERR flag is always set after system reset */
 	stm32l4_flash_write32(t, FLASH_SR, stm32l4_flash_read32(t, FLASH_SR));
 
-	/* Unlock the Flash and wait for the operation to complete, reporting any errors */
+	/* Unlock the Flash and wait for any operation in progress to complete, reporting any errors */
 	stm32l4_flash_unlock(t);
 	if (!stm32l4_flash_busy_wait(t, NULL))
 		return false;
+	if (f->operation != FLASH_OPERATION_WRITE || !stm32l4_flash_stub_supported(t))
+		return true;
+
+	/* The stub needs the core halted to run, and Flash mode may not have left it that way */
+	target_halt_request(t);
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	while (target_halt_poll(t, NULL) == TARGET_HALT_RUNNING) {
+		if (platform_timeout_is_expired(&timeout))
+			return false;
+	}
+
+	target_mem_write(t, STM32L4_STUB_BASE, stm32l4_flash_stub, sizeof(stm32l4_flash_stub));
+	sf->stage_buffer = 0U;
+	/* Fast programming is only allowed into a bank that has just been mass erased */
+	sf->row_size = sf->bank_erased && stm32l4_flash_fast_clock(t) ? stm32l4_flash_fast_row_size(t) : 0U;
+	DEBUG_TARGET("stm32l4: %s programming\n", sf->row_size ? "fast" : "standard");
+	return !target_check_error(t);
+}
+
+static bool stm32l4_flash_erase_pages(target_flash_s *const f, const target_addr_t addr, const size_t len)
+{
+	target_s *t = f->t;
+	const stm32l4_flash_s *const sf = (stm32l4_flash_s *)f;
 
 	/* Erase the requested chunk of flash, one page at a time. */
 	for (size_t offset = 0; offset < len; offset += f->blocksize) {
@@ -719,33 +876,86 @@ static bool stm32l4_flash_erase(target_flash_s *const f, const target_addr_t add
 	return true;
 }
 
-static bool stm32l4_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
+/* Erase the pending range, as a bank mass erase if it covers the whole bank and page by page otherwise */
+static bool stm32l4_flash_erase_pending(stm32l4_flash_s *const sf)
 {
-	target_s *t = f->t;
-	stm32l4_flash_write32(t, FLASH_CR, FLASH_CR_PG);
-	target_mem_write(t, dest, src, len);
+	if (!sf->erase_length)
+		return true;
+	target_flash_s *const f = &sf->f;
+	const target_addr_t begin = sf->erase_begin;
+	const size_t length = sf->erase_length;
+	sf->erase_length = 0U;
+
+	if (begin != f->start || length < f->length) {
+		sf->bank_erased = false;
+		return stm32l4_flash_erase_pages(f, begin, length);
+	}
 
-	/* Wait for completion or an error */
-	return stm32l4_flash_busy_wait(t, NULL);
+	/* A Flash without a second bank spans the whole array, which needs both banks' erase bits */
+	uint32_t action = FLASH_CR_MER1 | FLASH_CR_MER2;
+	if (sf->bank1_start != UINT32_MAX)
+		action = f->start >= sf->bank1_start ? FLASH_CR_MER2 : FLASH_CR_MER1;
+	sf->bank_erased = stm32l4_cmd_erase(f->t, action);
+	return sf->bank_erased;
 }
 
-static bool stm32l4_cmd_erase(target_s *const t, const uint32_t action)
+/*
+ * Pages are queued up into a contiguous range and erased once the range is broken
+ * or the erase operation completes, so that whole banks can be mass erased instead
+ */
+static bool stm32l4_flash_erase(target_flash_s *const f, const target_addr_t addr, const size_t len)
 {
-	stm32l4_flash_unlock(t);
-	/* Erase time is 25 ms. Timeout logic shouldn't get fired.*/
-	/* Flash erase action start instruction */
-	stm32l4_flash_write32(t, FLASH_CR, action);
-	stm32l4_flash_write32(t, FLASH_CR, action | FLASH_CR_STRT);
+	stm32l4_flash_s *const sf = (stm32l4_flash_s *)f;
+	if (sf->erase_length && addr == sf->erase_begin + sf->erase_length) {
+		sf->erase_length += len;
+		return true;
+	}
 
-	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 500);
-	/* Wait for completion or an error */
-	return stm32l4_flash_busy_wait(t, &timeout);
+	const bool result = stm32l4_flash_erase_pending(sf);
+	sf->erase_begin = addr;
+	sf->erase_length = len;
+	return result;
 }
 
-static bool stm32l4_mass_erase(target_s *const t)
+/*
+ * Hand a buffer to the stub. The buffer is loaded into whichever stub buffer is free
+ * while the stub is still programming the previous one, then the stub is restarted on it.
+ */
+static bool stm32l4_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
 {
-	return stm32l4_cmd_erase(t, FLASH_CR_MER1 | FLASH_CR_MER2);
+	target_s *t = f->t;
+	if (!stm32l4_flash_stub_supported(t)) {
+		stm32l4_flash_write32(t, FLASH_CR, FLASH_CR_PG);
+		target_mem_write(t, dest, src, len);
+
+		/* Wait for completion or an error */
+		return stm32l4_flash_busy_wait(t, NULL);
+	}
+
+	stm32l4_flash_s *const sf = (stm32l4_flash_s *)f;
+	const uint32_t buffer = STM32L4_STUB_BUFFER_BASE + (sf->stage_buffer * f->writesize);
+	target_mem_write(t, buffer, src, len);
+	if (target_check_error(t) || !stm32l4_flash_stub_wait(sf))
+		return false;
+
+	/* The stub takes the FPEC base with the fast programming row size packed into its low bits */
+	const stm32l4_priv_s *const priv = (const stm32l4_priv_s *)t->target_storage;
+	const uint32_t fpec_base = priv->device->flash_regs_map[FLASH_SR] - 0x10U;
+	if (!cortexm_start_stub(t, STM32L4_STUB_BASE, dest, buffer, len, fpec_base | sf->row_size))
+		return false;
+	sf->stub_running = true;
+	sf->stage_buffer ^= 1U;
+	return true;
+}
+
+static bool stm32l4_flash_done(target_flash_s *const f)
+{
+	stm32l4_flash_s *const sf = (stm32l4_flash_s *)f;
+	const bool result = stm32l4_flash_erase_pending(sf) && stm32l4_flash_stub_wait(sf);
+	/* Once written, the bank has to be mass erased again before it can be fast programmed */
+	if (f->operation == FLASH_OPERATION_WRITE)
+		sf->bank_erased = false;
+	return result;
 }
 
 static bool stm32l4_cmd_erase_bank1(target_s *const t, const int argc, const char **const argv)
@@ -21,6 +21,8 @@
 #include "general.h"
 #include "target_internal.h"
 #include "gdb_packet.h"
+#include "stats.h"
+#include "crc32.h"
 
 #include <stdarg.h>
 #include <unistd.h>
@@ -327,6 +329,14 @@ void target_regs_write(target_s *t, const void *data)
 	}
 }
 
+bool target_mem_crc32(target_s *t, uint32_t *crc, target_addr_t base, size_t len)
+{
+	/* Use the target's own CRC engine if it has one and can handle this range */
+	if (t->mem_crc32 && t->mem_crc32(t, crc, base, len))
+		return true;
+	return generic_crc32(t, crc, base, len);
+}
+
 /* Halt/resume functions */
 void target_reset(target_s *t)
 {
@@ -342,6 +352,7 @@ void target_halt_request(target_s *t)
 
 target_halt_reason_e target_halt_poll(target_s *t, target_addr_t *watch)
 {
+	stats_increment(STATS_HALT_POLLS);
 	if (t->halt_poll)
 		return t->halt_poll(t, watch);
 	/* XXX: Is this actually the desired fallback behaviour? */
@@ -352,6 +363,8 @@ void target_halt_resume(target_s *t, bool step)
 {
 	if (t->halt_resume)
 		t->halt_resume(t, step);
+	/* Whatever resumed the target, poll it quickly again to begin with */
+	platform_pace_restart();
 }
 
 /* Command line for semihosting get_cmdline */
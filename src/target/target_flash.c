@@ -37,6 +37,7 @@
 
 #include "general.h"
 #include "target_internal.h"
+#include "stats.h"
 
 static bool flash_done(target_flash_s *flash);
 
@@ -134,6 +135,18 @@ static bool flash_done(target_flash_s *flash)
 	return result;
 }
 
+/*
+ * Finish an erase operation. Flash with background work (a poll hook) keeps the operation open instead,
+ * so its erases can run on while other Flash is erased or written. It then gets finished by the next
+ * operation on that Flash, or by target_flash_complete() if nothing else touches it.
+ */
+static bool flash_erase_done(target_flash_s *const flash)
+{
+	if (flash->poll)
+		return true;
+	return flash_done(flash);
+}
+
 bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 {
 	if (!target_enter_flash_mode(target))
@@ -153,7 +166,7 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 
 		/* Terminate flash operations if we're not in the same target flash */
 		if (flash != active_flash) {
-			result &= flash_done(active_flash);
+			result &= flash_erase_done(active_flash);
 			active_flash = flash;
 		}
 
@@ -163,7 +176,12 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 		if (!flash_prepare(flash, FLASH_OPERATION_ERASE))
 			return false;
 
+		const uint32_t start_time = platform_time_ms();
 		result &= flash->erase(flash, local_start_addr, flash->blocksize);
+		const uint32_t erase_time = platform_time_ms() - start_time;
+		stats_increment(STATS_FLASH_ERASES);
+		stats_record(STATS_FLASH_ERASE_TIME, erase_time);
+		flash->erase_time += erase_time;
 		if (!result) {
 			DEBUG_ERROR("Erase failed at %" PRIx32 "\n", local_start_addr);
 			break;
@@ -173,7 +191,7 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 		addr = local_end_addr;
 	}
 	/* Issue flash done on last operation */
-	result &= flash_done(active_flash);
+	result &= flash_erase_done(active_flash);
 	return result;
 }
 
@@ -191,6 +209,20 @@ bool flash_buffer_alloc(target_flash_s *flash)
 	return true;
 }
 
+/*
+ * Give every other Flash on the target a chance to move its background work along, such as
+ * a second bank erasing ahead of the writes to it while the active bank is being programmed
+ */
+static bool flash_poll_others(const target_flash_s *const active_flash)
+{
+	bool result = true; /* Catch false returns with &= */
+	for (target_flash_s *flash = active_flash->t->flash; flash; flash = flash->next) {
+		if (flash != active_flash && flash->poll)
+			result &= flash->poll(flash);
+	}
+	return result;
+}
+
 static bool flash_buffered_flush(target_flash_s *flash)
 {
 	bool result = true; /* Catch false returns with &= */
@@ -205,8 +237,15 @@ static bool flash_buffered_flush(target_flash_s *flash)
 		const uint8_t *src = flash->buf + (aligned_addr - flash->buf_addr_base);
 		const uint32_t length = flash->buf_addr_high - aligned_addr;
 
-		for (size_t offset = 0; offset < length; offset += flash->writesize)
+		for (size_t offset = 0; offset < length; offset += flash->writesize) {
+			const uint32_t start_time = platform_time_ms();
 			result &= flash->write(flash, aligned_addr + offset, src + offset, flash->writesize);
+			const uint32_t write_time = platform_time_ms() - start_time;
+			stats_increment(STATS_FLASH_WRITES);
+			stats_record(STATS_FLASH_WRITE_TIME, write_time);
+			flash->write_time += write_time;
+			result &= flash_poll_others(flash);
+		}
 
 		flash->buf_addr_base = UINT32_MAX;
 		flash->buf_addr_low = UINT32_MAX;
@@ -312,6 +351,7 @@ bool target_flash_complete(target_s *target)
 		result &= flash_done(flash);
 	}
 
-	target_exit_flash_mode(target);
+	/* Leaving Flash mode can finish off work the drivers deferred, so its result counts too */
+	result &= target_exit_flash_mode(target);
 	return result;
 }
@@ -50,6 +50,7 @@ typedef bool (*flash_prepare_func)(target_flash_s *flash);
 typedef bool (*flash_erase_func)(target_flash_s *flash, target_addr_t addr, size_t len);
 typedef bool (*flash_write_func)(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 typedef bool (*flash_done_func)(target_flash_s *flash);
+typedef bool (*flash_poll_func)(target_flash_s *flash);
 
 struct target_flash {
 	target_s *t;                 /* Target this flash is attached to */
@@ -64,10 +65,13 @@ struct target_flash {
 	flash_erase_func erase;      /* Erase a range of flash */
 	flash_write_func write;      /* Write to flash */
 	flash_done_func done;        /* Finish flash operations */
+	flash_poll_func poll;        /* Move background work such as queued erases along, without blocking */
 	void *buf;                   /* Buffer for flash operations */
 	target_addr_t buf_addr_base; /* Address of block this buffer is for */
 	target_addr_t buf_addr_low;  /* Address of lowest byte written */
 	target_addr_t buf_addr_high; /* Address of highest byte written */
+	uint32_t erase_time;         /* Total time spent erasing this flash in ms, for `monitor stats` */
+	uint32_t write_time;         /* Total time spent writing this flash in ms, for `monitor stats` */
 	target_flash_s *next;        /* Next flash in list */
 };
 
@@ -111,6 +115,8 @@ struct target {
 	/* Memory access functions */
 	void (*mem_read)(target_s *target, void *dest, target_addr_t src, size_t len);
 	void (*mem_write)(target_s *target, target_addr_t dest, const void *src, size_t len);
+	/* Optional accelerated CRC32 of a memory range, returning false if the range can't be handled */
+	bool (*mem_crc32)(target_s *target, uint32_t *crc, target_addr_t base, size_t len);
 
 	/* Register access functions */
 	size_t regs_size;